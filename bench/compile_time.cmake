@@ -0,0 +1,52 @@
+# Measures how long it takes to compile bench/compile_unit.cpp with the
+# header-only library and against the compiled arg_core library.
+#
+# Expects COMPILER, COMPILER_ID, INCLUDE_DIR, SOURCE and OUTPUT_DIR to be set,
+# and optionally REPEAT (number of compilations per mode, 5 by default).
+
+if(NOT DEFINED REPEAT)
+    set(REPEAT 5)
+endif()
+
+if(COMPILER_ID STREQUAL MSVC)
+    set(flags /nologo /std:c++20 /EHsc /c "/I${INCLUDE_DIR}")
+    set(define /DARG_SEPARATE_COMPILATION)
+    set(output_flag /Fo)
+else()
+    set(flags -std=c++20 -c "-I${INCLUDE_DIR}")
+    set(define -DARG_SEPARATE_COMPILATION)
+    set(output_flag -o)
+endif()
+
+function(measure name)
+    set(total 0)
+    foreach(i RANGE 1 ${REPEAT})
+        string(TIMESTAMP start "%s%f")
+        execute_process(
+            COMMAND "${COMPILER}" ${flags} ${ARGN}
+                "${SOURCE}" "${output_flag}${OUTPUT_DIR}/${name}.o"
+            RESULT_VARIABLE result)
+        string(TIMESTAMP end "%s%f")
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "compilation failed for ${name}")
+        endif()
+        # Timestamps are in microseconds; drop the last three digits to get
+        # milliseconds, so the numbers fit into CMake's integer math.
+        string(LENGTH "${start}" length)
+        math(EXPR length "${length} - 3")
+        string(SUBSTRING "${start}" 0 ${length} start)
+        string(LENGTH "${end}" length)
+        math(EXPR length "${length} - 3")
+        string(SUBSTRING "${end}" 0 ${length} end)
+        math(EXPR total "${total} + ${end} - ${start}")
+    endforeach()
+    math(EXPR average "${total} / ${REPEAT}")
+    set(${name}_ms ${average} PARENT_SCOPE)
+    message(STATUS "${name}: ${average} ms per translation unit")
+endfunction()
+
+measure(header_only)
+measure(separate_compilation ${define})
+
+math(EXPR saved "${header_only_ms} - ${separate_compilation_ms}")
+message(STATUS "arg_core saves ${saved} ms per translation unit")
@@ -0,0 +1,41 @@
+// A typical translation unit that defines and parses a few options. The
+// compile time benchmark builds it with and without ARG_SEPARATE_COMPILATION.
+
+#include <arg/core.hpp>
+
+#include <string>
+
+int main(int argc, char** argv)
+{
+    auto parser = arg::Parser{};
+    parser.helpKeys("-h", "--help");
+    auto verbose = parser.multiFlag()
+        .keys("-v", "--verbose")
+        .help("be more verbose");
+    auto dryRun = parser.flag()
+        .keys("-n", "--dry-run")
+        .help("do not change anything");
+    auto threads = parser.option<int>()
+        .keys("-j", "--threads")
+        .defaultValue(4)
+        .help("number of worker threads");
+    auto name = parser.option<std::string>()
+        .keys("--name")
+        .markRequired()
+        .help("instance name");
+    auto ratio = parser.option<double>()
+        .keys("--ratio")
+        .help("sampling ratio");
+    auto tags = parser.multiOption<std::string>()
+        .keys("-t", "--tag")
+        .help("tags to attach");
+    auto input = parser.argument<std::string>()
+        .metavar("INPUT");
+    auto rest = parser.multiArgument<std::string>()
+        .metavar("FILE");
+    parser.parse(argc, argv);
+
+    return static_cast<int>(*verbose) + *dryRun + *threads +
+        static_cast<int>(name->size() + tags.vector().size() + input->size() +
+            rest.vector().size()) + static_cast<int>(*ratio);
+}
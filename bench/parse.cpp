@@ -0,0 +1,499 @@
+#include <arg/core.hpp>
+#include <arg/mapped.hpp>
+#include <arg/impl/shell.hpp>
+#include <generated/build_options.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+
+template <class F>
+double nanosecondsPerCall(size_t iterations, F&& f)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        f();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() /
+        static_cast<double>(iterations);
+}
+
+void benchParse(size_t optionCount, size_t argCount)
+{
+    auto parser = arg::Parser{};
+    std::vector<arg::Option<int>> options;
+    for (size_t i = 0; i < optionCount; i++) {
+        options.push_back(parser.option<int>()
+            .keys("--option-" + std::to_string(i)));
+    }
+    auto flags = parser.multiFlag().keys("-v");
+    auto values = parser.multiArgument<std::string>();
+
+    std::vector<std::string> args;
+    for (size_t i = 0; i < argCount; i++) {
+        switch (i % 4) {
+            case 0:
+                args.push_back("--option-" + std::to_string(i % optionCount));
+                args.push_back(std::to_string(i));
+                break;
+            case 1:
+                args.push_back(
+                    "--option-" + std::to_string(i % optionCount) + "=1");
+                break;
+            case 2: args.push_back("-vvv"); break;
+            case 3: args.push_back("value-" + std::to_string(i)); break;
+        }
+    }
+
+    auto ns = nanosecondsPerCall(200, [&] { parser.parse(args); });
+    std::cout << "parse: " << optionCount << " options, " << args.size() <<
+        " tokens: " << ns / 1000.0 << " us (" <<
+        ns / static_cast<double>(args.size()) << " ns/token)\n";
+}
+
+void benchDefinition(size_t optionCount)
+{
+    auto poolBefore = arg::internal::textPool().bytes();
+    auto parser = arg::Parser{};
+    std::vector<arg::Flag> flags;
+    flags.reserve(optionCount);
+
+    auto ns = nanosecondsPerCall(1, [&] {
+        for (size_t i = 0; i < optionCount; i++) {
+            auto name = "feature-" + std::to_string(i);
+            flags.push_back(parser.flag()
+                .keys("--enable-" + name, "--" + name)
+                .help("Enables a feature of the generated schema"));
+        }
+    });
+    auto poolBytes = arg::internal::textPool().bytes() - poolBefore;
+    std::cout << "define: " << optionCount << " flags: " <<
+        ns / 1e6 << " ms, text pool " <<
+        static_cast<double>(poolBytes) / static_cast<double>(optionCount) <<
+        " bytes/flag\n";
+}
+
+// Short command lines against a large schema, where building the key index
+// is most of the parse, with and without a parser image
+void benchImage(size_t optionCount)
+{
+    auto parser = arg::Parser{};
+    std::vector<arg::Flag> flags;
+    for (size_t i = 0; i < optionCount; i++) {
+        flags.push_back(parser.flag()
+            .keys("--flag-" + std::to_string(i))
+            .help("Enables a feature of the generated schema"));
+    }
+    auto args = std::vector<std::string>{"--flag-1", "--flag-2"};
+
+    auto indexed = nanosecondsPerCall(200, [&] { parser.parse(args); });
+    const auto image = parser.image();
+    parser.useImage(image);
+    auto mapped = nanosecondsPerCall(200, [&] { parser.parse(args); });
+    std::cout << "image: " << optionCount << " options, " << image.size() <<
+        " bytes: parse " << indexed / 1000.0 << " us indexed, " <<
+        mapped / 1000.0 << " us from image\n";
+}
+
+void benchHelp(size_t optionCount)
+{
+    auto parser = arg::Parser{};
+    parser.config.helpWidth = 100;
+    std::vector<arg::Flag> flags;
+    for (size_t i = 0; i < optionCount; i++) {
+        auto name = "feature-" + std::to_string(i);
+        flags.push_back(parser.flag()
+            .keys("--enable-" + name, "--" + name)
+            .section(i % 2 == 0 ? "even" : "odd")
+            .help("Enables a feature of the generated schema, which is "
+                "described at length so that the help text wraps"));
+    }
+
+    auto output = std::ostringstream{};
+    auto first = nanosecondsPerCall(1, [&] { parser.printHelp(output); });
+    auto again = nanosecondsPerCall(10, [&] {
+        output.str({});
+        parser.printHelp(output);
+    });
+    auto section = nanosecondsPerCall(10, [&] {
+        output.str({});
+        parser.printHelp(output, "odd");
+    });
+    std::cout << "help: " << optionCount << " options: " << first / 1e6 <<
+        " ms first, " << again / 1e6 << " ms cached, " << section / 1e6 <<
+        " ms one section\n";
+}
+
+// Reading every flag after a parse: one handle per flag against one bit per
+// flag in a set
+void benchFlags(size_t flagCount)
+{
+    auto parser = arg::Parser{};
+    auto set = arg::FlagSet{};
+    std::vector<arg::Flag> flags;
+    std::vector<std::string> args;
+    for (size_t i = 0; i < flagCount; i++) {
+        flags.push_back(parser.flag().keys("--flag-" + std::to_string(i)));
+        parser.flag(set).keys("--bit-" + std::to_string(i));
+        if (i % 8 == 0) {
+            args.push_back("--flag-" + std::to_string(i));
+            args.push_back("--bit-" + std::to_string(i));
+        }
+    }
+    parser.parse(args);
+
+    size_t count = 0;
+    auto handles = nanosecondsPerCall(100, [&] {
+        size_t local = 0;
+        for (const auto& flag : flags) {
+            local += flag ? 1 : 0;
+        }
+        count += local;
+    });
+    auto bits = nanosecondsPerCall(100, [&] {
+        const auto& bits = set.bits();
+        size_t local = 0;
+        for (size_t i = 0; i < bits.size(); i++) {
+            local += bits[i] ? 1 : 0;
+        }
+        count += local;
+    });
+    auto popcount = nanosecondsPerCall(100, [&] { count += set.count(); });
+    std::cout << "flags: " << flagCount << " flags, reading all: " <<
+        handles / 1000.0 << " us as handles, " << bits / 1000.0 <<
+        " us as bits, " << popcount / 1000.0 << " us counted (" <<
+        count / 300 << " set)\n";
+}
+
+void benchSplit(size_t argCount)
+{
+    std::string line;
+    for (size_t i = 0; i < argCount; i++) {
+        switch (i % 4) {
+            case 0: line += "--option-" + std::to_string(i) + " "; break;
+            case 1: line += "'a value with several spaces in it' "; break;
+            case 2: line += "\"double \\\"quoted\\\" value\" "; break;
+            case 3: line += "/some/fairly/long/path/to/a/file.txt "; break;
+        }
+    }
+
+    std::vector<std::string_view> tokens;
+    std::string scratch;
+    auto ns = nanosecondsPerCall(200, [&] {
+        tokens.clear();
+        scratch.clear();
+        arg::internal::splitCommandLine(line, tokens, scratch);
+    });
+    std::cout << "split: " << line.size() << " bytes, " << argCount <<
+        " tokens: " << ns / 1000.0 << " us (" <<
+        ns / static_cast<double>(line.size()) << " ns/byte)\n";
+}
+
+void benchList(size_t elementCount)
+{
+    auto parser = arg::Parser{};
+    auto ids = parser.listOption<uint64_t>().keys("--ids");
+
+    auto token = std::string{"--ids="};
+    for (size_t i = 0; i < elementCount; i++) {
+        token += std::to_string(i * 7919) + ",";
+    }
+    token.pop_back();
+    auto args = std::vector<std::string>{token};
+
+    auto ns = nanosecondsPerCall(20, [&] {
+        ids->clear();
+        parser.parse(args);
+    });
+    std::cout << "list: " << elementCount << " elements, " << token.size() <<
+        " bytes: " << ns / 1000.0 << " us (" <<
+        ns / static_cast<double>(elementCount) << " ns/element)\n";
+}
+
+// Parses a long string option with and without UTF-8 validation, so the
+// difference is the cost of validating
+void benchUtf8(size_t byteCount)
+{
+    auto value = std::string{};
+    while (value.size() < byteCount) {
+        value += "/srv/data/archive/2024/r\xc3\xa9sum\xc3\xa9s/";
+        value += "report-\xe2\x82\xac-final.txt:";
+    }
+    auto args = std::vector<std::string>{"--text", value};
+
+    auto time = [&args] (bool utf8) {
+        auto parser = arg::Parser{};
+        auto text = parser.option<std::string>().keys("--text");
+        if (utf8) {
+            text.utf8();
+        }
+        return nanosecondsPerCall(20, [&] {
+            parser.parse(args);
+        });
+    };
+    auto plain = time(false);
+    auto checked = time(true);
+    std::cout << "utf8: " << value.size() << " bytes: " << plain / 1000.0 <<
+        " us, validated " << checked / 1000.0 << " us (" <<
+        (checked - plain) / static_cast<double>(value.size()) <<
+        " ns/byte)\n";
+}
+
+// Startup with a large payload option: reading the file while parsing, as
+// a string option would, against recording the path and mapping the file
+// on first use
+void benchMapped(size_t byteCount)
+{
+    const auto path = (std::filesystem::temp_directory_path() /
+        "arg_bench_payload").string();
+    {
+        auto output = std::ofstream{path, std::ios::binary};
+        const auto block = std::string(1 << 16, 'x');
+        for (size_t size = 0; size < byteCount; size += block.size()) {
+            output << block;
+        }
+    }
+    const auto args = std::vector<std::string>{"--weights=@" + path};
+    size_t sink = 0;
+
+    auto stringParser = arg::Parser{};
+    auto text = stringParser.option<std::string>().keys("--weights");
+    auto read = nanosecondsPerCall(20, [&] {
+        stringParser.parse(args);
+        auto input = std::ifstream{text->substr(1), std::ios::binary};
+        auto contents = std::string{
+            std::istreambuf_iterator<char>{input},
+            std::istreambuf_iterator<char>{}};
+        sink += contents.size();
+    });
+
+    auto mappedParser = arg::Parser{};
+    auto weights = mappedParser.option<arg::MappedFile>().keys("--weights");
+    auto parsed = nanosecondsPerCall(20, [&] { mappedParser.parse(args); });
+    auto touched = nanosecondsPerCall(20, [&] {
+        mappedParser.parse(args);
+        sink += static_cast<size_t>(weights->data()[byteCount / 2]);
+    });
+    std::filesystem::remove(path);
+
+    if (sink == 0) {
+        std::cout << "mapped: nothing was read\n";
+    }
+    std::cout << "mapped: " << byteCount << " bytes: read at startup " <<
+        read / 1000.0 << " us, mapped " << parsed / 1000.0 <<
+        " us, mapped and touched " << touched / 1000.0 << " us\n";
+}
+
+// A typical command line, through the parser generated from schema.json and
+// through the same options defined at run time
+void benchGenerated()
+{
+    const auto args = std::vector<std::string_view>{
+        "-j8", "-k", "-vv", "-C", "build", "--target", "all", "-t", "install",
+        "-DFOO=1", "--define=BAR=2", "--seed", "42", "--color=true",
+        "--load-average", "2.5", "main.o", "util.o", "parse.o"};
+
+    auto parser = arg::Parser{};
+    auto verbose = parser.multiFlag().keys("-v", "--verbose");
+    auto quiet = parser.flag().keys("-q", "--quiet");
+    auto keepGoing = parser.flag().keys("-k", "--keep-going");
+    auto dryRun = parser.flag().keys("-n", "--dry-run");
+    auto jobs = parser.option<int>().keys("-j", "--jobs");
+    auto load = parser.option<double>().keys("-l", "--load-average");
+    auto directory = parser.option<std::string>().keys("-C", "--directory");
+    auto file = parser.option<std::string>().keys("-f", "--file");
+    auto target = parser.multiOption<std::string>().keys("-t", "--target");
+    auto define = parser.multiOption<std::string>().keys("-D", "--define");
+    auto seed = parser.option<unsigned>().keys("--seed");
+    auto color = parser.option<bool>().keys("--color");
+    auto inputs = parser.multiArgument<std::string>();
+    parser.helpKeys("-h", "--help");
+
+    const auto iterations = size_t{20'000};
+    auto runtime = nanosecondsPerCall(iterations, [&] {
+        target.vector().clear();
+        define.vector().clear();
+        inputs.vector().clear();
+        parser.parse(args);
+    });
+
+    size_t checksum = 0;
+    auto generated = nanosecondsPerCall(iterations, [&] {
+        auto options = bench::BuildOptions{};
+        auto help = std::string_view{};
+        auto errors = bench::BuildOptionsParser::tryParse(args, options, help);
+        checksum += errors.size() + options.inputs.size() + options.verbose;
+    });
+    if (checksum != iterations * 5) {
+        std::cout << "generated: unexpected result\n";
+    }
+    std::cout << "generated: " << args.size() << " tokens: runtime parser " <<
+        runtime / 1000.0 << " us, generated parser " << generated / 1000.0 <<
+        " us\n";
+}
+
+// Size of the .text section of an ELF file, or 0 if it cannot be read
+size_t textSize(const char* path)
+{
+    auto file = std::ifstream{path, std::ios::binary};
+    auto data = std::string{
+        std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+    auto read = [&data] (size_t offset, auto& value) {
+        if (offset + sizeof(value) > data.size()) {
+            return false;
+        }
+        std::memcpy(&value, data.data() + offset, sizeof(value));
+        return true;
+    };
+
+    // 64-bit little-endian ELF only
+    if (data.size() < 64 || data.compare(0, 4, "\x7f" "ELF") != 0 ||
+            data[4] != 2 || data[5] != 1) {
+        return 0;
+    }
+    uint64_t sections = 0;
+    uint16_t entrySize = 0;
+    uint16_t count = 0;
+    uint16_t names = 0;
+    if (!read(0x28, sections) || !read(0x3a, entrySize) ||
+            !read(0x3c, count) || !read(0x3e, names)) {
+        return 0;
+    }
+    uint64_t namesOffset = 0;
+    if (!read(sections + names * entrySize + 0x18, namesOffset)) {
+        return 0;
+    }
+    for (uint16_t i = 0; i < count; i++) {
+        auto header = sections + i * entrySize;
+        uint32_t name = 0;
+        uint64_t size = 0;
+        if (read(header, name) && read(header + 0x20, size) &&
+                data.compare(namesOffset + name, 6, ".text\0", 6) == 0) {
+            return size;
+        }
+    }
+    return 0;
+}
+
+// Inputs built to hit the slow paths of a parser, at two sizes each. With
+// parsing linear in the input, ns/byte stays the same as the size grows.
+void benchAdversarial(size_t byteCount)
+{
+    auto parser = arg::Parser{};
+    auto verbose = parser.multiFlag().keys("-v");
+    auto name = parser.option<std::string>().keys("-n", "--name");
+    auto modes = parser.multiOption<std::string>().keys("--mode")
+        .choices({{"fast", "fast"}, {"safe", "safe"}, {"slow", "slow"}});
+    auto rest = parser.multiArgument<std::string>();
+
+    auto shapes = std::vector<std::pair<
+        std::string_view, std::vector<std::string>(*)(size_t)>>{
+        {"pack", [] (size_t n) {
+            return std::vector<std::string>{"-" + std::string(n, 'v')};
+        }},
+        {"failing packs", [] (size_t n) {
+            return std::vector<std::string>(
+                n / 256, "-" + std::string(255, 'v') + "x");
+        }},
+        {"separators", [] (size_t n) {
+            return std::vector<std::string>{
+                "--name=" + std::string(n, '='),
+                "--" + std::string(n, 'x') + "=" + std::string(n, '='),
+                "-n" + std::string(n, '-'),
+                std::string(n, '-')};
+        }},
+        {"short tokens", [] (size_t n) {
+            auto args = std::vector<std::string>{};
+            for (size_t i = 0; i < n / 20; i++) {
+                args.insert(args.end(), {"-vv", "--mode=fast", "-n", "name"});
+            }
+            return args;
+        }},
+    };
+    for (const auto& [shape, make] : shapes) {
+        std::cout << "adversarial: " << shape;
+        auto separator = ": ";
+        for (auto size : {byteCount, 16 * byteCount}) {
+            const auto args = make(size);
+            auto bytes = size_t{0};
+            for (const auto& arg : args) {
+                bytes += arg.size();
+            }
+            auto ns = nanosecondsPerCall(10, [&] {
+                std::ignore = parser.tryParse(args);
+            });
+            std::cout << separator << bytes << " bytes " <<
+                ns / static_cast<double>(bytes) << " ns/byte";
+            separator = ", ";
+        }
+        std::cout << "\n";
+    }
+
+    // Options and constraints grow with the arguments
+    for (size_t count : {size_t{1} << 11, size_t{1} << 15}) {
+        auto wide = arg::Parser{};
+        auto args = std::vector<std::string>{};
+        for (size_t i = 0; i < count; i++) {
+            auto key = "--o" + std::to_string(i);
+            std::ignore = wide.flag().keys(key);
+            if (i > 0) {
+                wide.dependsOn(key, "--o" + std::to_string(i - 1));
+                wide.mutuallyExclusive(key, "--o0");
+                args.push_back(key);
+            }
+        }
+        auto ns = nanosecondsPerCall(10, [&] {
+            std::ignore = wide.tryParse(args);
+        });
+        std::cout << "adversarial: " << count << " options, " <<
+            2 * (count - 1) << " constraints: " << ns / 1000.0 << " us (" <<
+            ns / static_cast<double>(count) << " ns/option)\n";
+    }
+}
+
+void benchTypeSize()
+{
+    auto small = textSize(ARG_SIZE_SMALL);
+    auto large = textSize(ARG_SIZE_LARGE);
+    if (small == 0 || large == 0) {
+        std::cout << "code size: not available for this binary format\n";
+        return;
+    }
+    std::cout << "code size: " << small << " bytes of .text, " <<
+        static_cast<double>(large - small) / ARG_SIZE_ADDED_TYPES <<
+        " bytes per added value type\n";
+}
+
+} // namespace
+
+int main()
+{
+    benchParse(10, 100);
+    benchParse(100, 1'000);
+    benchParse(1'000, 10'000);
+    benchDefinition(60'000);
+    benchImage(10'000);
+    benchHelp(60'000);
+    benchFlags(20'000);
+    benchSplit(10'000);
+    benchList(200'000);
+    benchUtf8(1 << 24);
+    benchMapped(1 << 26);
+    benchGenerated();
+    benchAdversarial(1 << 16);
+    benchTypeSize();
+}
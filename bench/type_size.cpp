@@ -0,0 +1,76 @@
+// Uses ARG_SIZE_TYPES distinct value types with every kind of option and
+// argument. arg_bench compares the code size of builds with different
+// numbers of types to get the cost of one more type.
+
+#include <arg/core.hpp>
+
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace {
+
+template <int N>
+struct Id {
+    int value = 0;
+};
+
+} // namespace
+
+template <int N>
+struct arg::Converter<Id<N>> {
+    bool operator()(std::string_view input, Id<N>& id) const
+    {
+        return arg::internal::fromChars(input, id.value);
+    }
+};
+
+template <int N>
+struct arg::Formatter<Id<N>> {
+    bool operator()(const Id<N>& id, std::string& output) const
+    {
+        arg::internal::toChars(id.value, output);
+        return true;
+    }
+};
+
+namespace {
+
+// Literal keys, so that the program has no per-type code of its own
+constexpr const char* keys[][2] = {
+    {"--a", "--all-a"}, {"--b", "--all-b"}, {"--c", "--all-c"},
+    {"--d", "--all-d"}, {"--e", "--all-e"}, {"--f", "--all-f"},
+    {"--g", "--all-g"}, {"--h", "--all-h"}, {"--i", "--all-i"},
+};
+
+template <int N>
+int useType(arg::Parser& parser)
+{
+    static_assert(N < std::size(keys));
+    auto option = parser.option<Id<N>>().keys(keys[N][0]);
+    auto multiOption = parser.multiOption<Id<N>>().keys(keys[N][1]);
+    auto argument = parser.argument<Id<N>>();
+    auto multiArgument = parser.multiArgument<Id<N>>();
+    return option->value + static_cast<int>(
+        multiOption.vector().size() + multiArgument.vector().size()) +
+        argument->value;
+}
+
+template <int... N>
+int useTypes(arg::Parser& parser, std::integer_sequence<int, N...>)
+{
+    return (0 + ... + useType<N>(parser));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    auto parser = arg::Parser{};
+    auto verbose = parser.flag().keys("-v");
+    auto result =
+        useTypes(parser, std::make_integer_sequence<int, ARG_SIZE_TYPES>{});
+    parser.parse(argc, argv);
+    return result + *verbose;
+}
@@ -1,16 +1,38 @@
 #include <arg.hpp>
 
+#include <chrono>
 #include <iostream>
 #include <istream>
+#include <string_view>
 
 struct Point {
     int x;
     int y;
 };
 
-std::istream& operator>>(std::istream& input, Point& point)
+// Points are given as "X,Y"
+template <>
+struct arg::Converter<Point> {
+    bool operator()(std::string_view input, Point& point) const
+    {
+        auto comma = input.find(',');
+        if (comma == std::string_view::npos) {
+            return false;
+        }
+        return arg::read(input.substr(0, comma), point.x) &&
+            arg::read(input.substr(comma + 1), point.y);
+    }
+};
+
+struct Size {
+    int width;
+    int height;
+};
+
+// Types without a converter are read with operator>>
+std::istream& operator>>(std::istream& input, Size& size)
 {
-    return input >> point.x >> point.y;
+    return input >> size.width >> size.height;
 }
 
 int main(int argc, char* argv[])
@@ -27,6 +49,10 @@ int main(int argc, char* argv[])
         .keys("--string");
     auto p = parser.option<Point>()
         .keys("--point");
+    auto size = parser.option<Size>()
+        .keys("--size");
+    auto timeout = parser.option<std::chrono::milliseconds>()
+        .keys("--timeout");
     parser.parse(argc, argv);
 
     std::cout <<
@@ -34,5 +60,7 @@ int main(int argc, char* argv[])
         "unsigned long long: " << ull << "\n" <<
         "bool: " << b << "\n" <<
         "string: " << str << "\n" <<
-        "point: " << p->x << ", " << p->y << "\n";
+        "point: " << p->x << ", " << p->y << "\n" <<
+        "size: " << size->width << "x" << size->height << "\n" <<
+        "timeout: " << timeout->count() << "ms\n";
 }
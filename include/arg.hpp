@@ -1,5 +1,7 @@
 #pragma once
 
-#include <arg/adapters.hpp>
-#include <arg/arguments.hpp>
-#include <arg/parser.hpp>
+#include <arg/core.hpp>
+#include <arg/mapped.hpp>
+#include <arg/reload.hpp>
+#include <arg/schema.hpp>
+#include <arg/units.hpp>
@@ -1,32 +1,47 @@
 #pragma once
 
 #include "arg/arguments.hpp"
+#include "arg/blob.hpp"
+#include "arg/config.hpp"
+#include "arg/converters.hpp"
+#include "arg/formatters.hpp"
+#include "arg/impl/simd.hpp"
 
 #include <algorithm>
+#include <iterator>
+#include <cassert>
 #include <memory>
-#include <sstream>
-#include <stdexcept>
+#include <optional>
+#include <span>
+#include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 namespace arg {
 
+namespace internal {
+
 template <class T>
-bool read(std::string_view input, T& value)
+bool convert(std::string_view input, T& value, const Choices<T>* choices)
 {
-    auto stream = std::istringstream{std::string{input}};
-    stream >> value;
-    return !!stream;
+    if (choices) {
+        if (const T* choice = choices->find(input)) {
+            value = *choice;
+            return true;
+        }
+        return false;
+    }
+    return read(input, value);
 }
 
-inline bool read(std::string_view input, std::string& string)
+inline std::vector<std::string_view> choiceNames(const ChoiceTable* choices)
 {
-    auto stream = std::istringstream{std::string{input}};
-    // This is probably inefficient.
-    string = {std::istreambuf_iterator<char>(stream), {}};
-    return true;
+    return choices ? choices->names() : std::vector<std::string_view>{};
 }
 
+} // namespace internal
+
 class KeyAdapter {
 public:
     virtual ~KeyAdapter() = default;
@@ -34,29 +49,98 @@ public:
     [[nodiscard]] virtual bool hasArgument() const = 0;
     [[nodiscard]] virtual bool isRequired() const = 0;
     [[nodiscard]] virtual bool isSet() const = 0;
-    [[nodiscard]] virtual const std::vector<std::string>& keys() const = 0;
-    [[nodiscard]] virtual std::string metavar() const = 0;
-    [[nodiscard]] virtual const std::string& help() const = 0;
+    [[nodiscard]] virtual std::span<const std::string_view> keys() const = 0;
+    [[nodiscard]] virtual std::string_view metavar() const = 0;
+    [[nodiscard]] virtual std::string_view help() const = 0;
     [[nodiscard]] virtual bool multi() const = 0;
+    [[nodiscard]] virtual std::vector<std::string_view> choices() const = 0;
+
+    [[nodiscard]] virtual std::string_view section() const
+    {
+        return {};
+    }
 
     virtual void raise() = 0;
     virtual bool addValue(std::string_view) = 0;
 
+    // What the last parse gave, for Parser::toArgv: the number of values
+    // (or of times a flag was given), and the text of each value
+    [[nodiscard]] virtual size_t valueCount() const = 0;
+    virtual bool formatValue(size_t index, std::string& output) const = 0;
+
+    // Parse cache support: a name for the type of the stored value, and the
+    // value given on the last parse. Adapters that cannot be cached keep the
+    // defaults, which turn the cache off.
+    [[nodiscard]] virtual std::string_view valueType() const
+    {
+        return {};
+    }
+
+    // Size and alignment of the stored value, so that a cache written while
+    // the type had another layout is not read back
+    [[nodiscard]] virtual uint64_t valueLayout() const
+    {
+        return 0;
+    }
+
+    virtual bool save(internal::BlobWriter&) const
+    {
+        return false;
+    }
+
+    virtual bool load(internal::BlobReader&)
+    {
+        return false;
+    }
+
+    // Reads what load would, without storing anything, so that a cache entry
+    // is checked whole before any value changes
+    virtual bool check(internal::BlobReader&) const
+    {
+        return false;
+    }
+
+    // The value held now, given or not. Before a parse that is the default,
+    // which is part of the cache key.
+    virtual bool saveCurrent(internal::BlobWriter&) const
+    {
+        return false;
+    }
+
+    // For options whose value is a list: the element that the last failed
+    // addValue could not read, and its position in the list
+    struct Element {
+        size_t index = 0;
+        std::string_view text;
+    };
+
+    [[nodiscard]] virtual std::optional<Element> invalidElement() const
+    {
+        return std::nullopt;
+    }
+
+    // Whether values must be valid UTF-8. The parser checks them before
+    // addValue.
+    [[nodiscard]] virtual bool requiresUtf8() const
+    {
+        return false;
+    }
+
     [[nodiscard]] std::string firstKey() const
     {
-        return keys().empty() ? "<no key>" : keys().front();
+        return std::string{keys().empty() ? "<no key>" : keys().front()};
     }
 
     [[nodiscard]] std::string keyString() const
     {
-        std::ostringstream stream;
-        if (auto it = keys().begin(); it != keys().end()) {
-            stream << *it++;
-            for (; it != keys().end(); ++it) {
-                stream << ", " << *it;
+        std::string result;
+        for (const auto& key : keys()) {
+            if (!result.empty()) {
+                result += ", ";
             }
+            result += key;
         }
-        return stream.str();
+        return result;
     }
 
     [[nodiscard]] bool hasKey(std::string_view s) const
@@ -71,10 +155,62 @@ public:
 
     [[nodiscard]] virtual bool isRequired() const = 0;
     [[nodiscard]] virtual bool isSet() const = 0;
-    [[nodiscard]] virtual std::string metavar() const = 0;
-    [[nodiscard]] virtual const std::string& help() const = 0;
+    [[nodiscard]] virtual std::string_view metavar() const = 0;
+    [[nodiscard]] virtual std::string_view help() const = 0;
     [[nodiscard]] virtual bool multi() const = 0;
+    [[nodiscard]] virtual std::vector<std::string_view> choices() const = 0;
     virtual bool addValue(std::string_view) = 0;
+
+    // What the last parse gave, for Parser::toArgv: the number of values
+    // (or of times a flag was given), and the text of each value
+    [[nodiscard]] virtual size_t valueCount() const = 0;
+    virtual bool formatValue(size_t index, std::string& output) const = 0;
+
+    // Parse cache support: a name for the type of the stored value, and the
+    // value given on the last parse. Adapters that cannot be cached keep the
+    // defaults, which turn the cache off.
+    [[nodiscard]] virtual std::string_view valueType() const
+    {
+        return {};
+    }
+
+    // Size and alignment of the stored value, so that a cache written while
+    // the type had another layout is not read back
+    [[nodiscard]] virtual uint64_t valueLayout() const
+    {
+        return 0;
+    }
+
+    virtual bool save(internal::BlobWriter&) const
+    {
+        return false;
+    }
+
+    virtual bool load(internal::BlobReader&)
+    {
+        return false;
+    }
+
+    // Reads what load would, without storing anything, so that a cache entry
+    // is checked whole before any value changes
+    virtual bool check(internal::BlobReader&) const
+    {
+        return false;
+    }
+
+    // The value held now, given or not. Before a parse that is the default,
+    // which is part of the cache key.
+    virtual bool saveCurrent(internal::BlobWriter&) const
+    {
+        return false;
+    }
+
+    // Whether values must be valid UTF-8. The parser checks them before
+    // addValue.
+    [[nodiscard]] virtual bool requiresUtf8() const
+    {
+        return false;
+    }
 };
 
 class FlagAdapter : public KeyAdapter {
@@ -95,7 +231,7 @@ public:
 
     [[nodiscard]] bool isSet() const override
     {
-        throw std::logic_error{"FlagAdapter's isSet must not be called"};
+        internal::logicError("FlagAdapter's isSet must not be called");
     }
 
     void raise() override
@@ -103,32 +239,91 @@ public:
         _flag = true;
     }
 
+    [[nodiscard]] std::string_view valueType() const override
+    {
+        return "flag";
+    }
+
+    bool save(internal::BlobWriter& writer) const override
+    {
+        writer.put(stored());
+        return true;
+    }
+
+    bool load(internal::BlobReader& reader) override
+    {
+        bool value = false;
+        if (!reader.get(value)) {
+            return false;
+        }
+        if (value) {
+            raise();
+        }
+        return true;
+    }
+
+    bool check(internal::BlobReader& reader) const override
+    {
+        bool value = false;
+        return reader.get(value);
+    }
+
+    bool saveCurrent(internal::BlobWriter& writer) const override
+    {
+        return save(writer);
+    }
+
     bool addValue(std::string_view) override
     {
-        throw std::logic_error{"FlagAdapter's addValue must not be called"};
+        internal::logicError("FlagAdapter's addValue must not be called");
+    }
+
+    [[nodiscard]] size_t valueCount() const override
+    {
+        return stored() ? 1 : 0;
+    }
+
+    bool formatValue(size_t, std::string&) const override
+    {
+        internal::logicError("FlagAdapter's formatValue must not be called");
     }
 
-    [[nodiscard]] const std::vector<std::string>& keys() const override
+    [[nodiscard]] std::span<const std::string_view> keys() const override
     {
         return _flag.keys();
     }
 
-    [[nodiscard]] std::string metavar() const override
+    [[nodiscard]] std::string_view metavar() const override
     {
         return "";
     }
 
-    [[nodiscard]] const std::string& help() const override
+    [[nodiscard]] std::string_view help() const override
     {
         return _flag.help();
     }
 
+    [[nodiscard]] std::string_view section() const override
+    {
+        return _flag.section();
+    }
+
     [[nodiscard]] bool multi() const override
     {
         return false;
     }
 
-private:
+    [[nodiscard]] std::vector<std::string_view> choices() const override
+    {
+        return {};
+    }
+
+protected:
+    [[nodiscard]] virtual bool stored() const
+    {
+        return *_flag;
+    }
+
     Flag _flag;
 };
 
@@ -150,255 +345,1101 @@ public:
 
     [[nodiscard]] bool isSet() const override
     {
-        throw std::logic_error{"MultiFlagAdapter's isSet must not be called"};
+        internal::logicError("MultiFlagAdapter's isSet must not be called");
     }
 
     void raise() override
     {
-        _multiFlag = true;
+        ++*_multiFlag;
     }
 
-    bool addValue(std::string_view) override
+    [[nodiscard]] std::string_view valueType() const override
     {
-        throw std::logic_error{"MultiFlagAdapter's addValue must not be called"};
+        return "count";
     }
 
-    [[nodiscard]] const std::vector<std::string>& keys() const override
+    bool save(internal::BlobWriter& writer) const override
     {
-        return _multiFlag.keys();
+        writer.put(static_cast<uint64_t>(stored()));
+        return true;
     }
 
-    [[nodiscard]] std::string metavar() const override
+    bool load(internal::BlobReader& reader) override
     {
-        return "";
+        uint64_t count = 0;
+        if (!reader.get(count)) {
+            return false;
+        }
+        for (uint64_t i = 0; i < count; i++) {
+            raise();
+        }
+        return true;
     }
 
-    [[nodiscard]] const std::string& help() const override
+    bool check(internal::BlobReader& reader) const override
     {
-        return _multiFlag.help();
+        uint64_t count = 0;
+        return reader.get(count);
     }
 
-    [[nodiscard]] bool multi() const override
+    bool saveCurrent(internal::BlobWriter& writer) const override
     {
-        return true;
+        return save(writer);
     }
 
-private:
-    MultiFlag _multiFlag;
-};
-
-template <class T>
-class OptionAdapter : public KeyAdapter {
-public:
-    explicit OptionAdapter(Option<T>&& option)
-        : _option(std::move(option))
-    { }
+    bool addValue(std::string_view) override
+    {
+        internal::logicError("MultiFlagAdapter's addValue must not be called");
+    }
 
-    [[nodiscard]] bool hasArgument() const override
+    [[nodiscard]] size_t valueCount() const override
     {
-        return true;
+        return stored();
     }
 
-    [[nodiscard]] bool isRequired() const override
+    bool formatValue(size_t, std::string&) const override
     {
-        return _option.isRequired();
+        internal::logicError(
+            "MultiFlagAdapter's formatValue must not be called");
     }
 
-    [[nodiscard]] bool isSet() const override
+    [[nodiscard]] std::span<const std::string_view> keys() const override
     {
-        return _option.isSet();
+        return _multiFlag.keys();
     }
 
-    void raise() override
+    [[nodiscard]] std::string_view metavar() const override
     {
-        throw std::logic_error{"OptionAdapter's raise must not be called"};
+        return "";
     }
 
-    bool addValue(std::string_view s) override
+    [[nodiscard]] std::string_view help() const override
     {
-        auto value = T{};
-        if (read(s, value)) {
-            _option = std::move(value);
-            return true;
-        }
-        return false;
+        return _multiFlag.help();
     }
 
-    [[nodiscard]] const std::vector<std::string>& keys() const override
+    [[nodiscard]] std::string_view section() const override
     {
-        return _option.keys();
+        return _multiFlag.section();
     }
 
-    [[nodiscard]] std::string metavar() const override
+    [[nodiscard]] bool multi() const override
     {
-        return _option.metavar();
+        return true;
     }
 
-    [[nodiscard]] const std::string& help() const override
+    [[nodiscard]] std::vector<std::string_view> choices() const override
     {
-        return _option.help();
+        return {};
     }
 
-    [[nodiscard]] bool multi() const override
+protected:
+    [[nodiscard]] virtual size_t stored() const
     {
-        return false;
+        return *_multiFlag;
     }
 
-private:
-    Option<T> _option;
+    MultiFlag _multiFlag;
+};
+
+namespace internal {
+
+// What the adapters need to know about a value type, as functions over
+// type-erased pointers. They are the only code instantiated for each value
+// type; the adapters themselves are shared by all types.
+//
+// For the parse cache, values that can be copied as bytes only give their
+// size, and other storable values give save and load. Both are empty for
+// values the cache cannot store.
+struct ValueOps {
+    std::string_view (*name)();
+    bool (*read)(
+        std::string_view input, void* value, const ChoiceTable* choices);
+    bool (*format)(
+        const void* value, const ChoiceTable* choices, std::string& output);
+    uint64_t layout;
+    size_t bytes;
+    bool (*save)(BlobWriter& writer, const void* value);
+    bool (*load)(BlobReader& reader, void* value);
+    bool (*skip)(BlobReader& reader);
 };
 
+// The same for a std::vector of values. Elements are only reachable by
+// address when the cache can store them.
+struct ListOps {
+    const ValueOps* element;
+    std::string_view (*name)();
+    bool (*push)(
+        std::string_view input, void* values, const ChoiceTable* choices);
+    bool (*formatAt)(
+        const void* values,
+        size_t index,
+        const ChoiceTable* choices,
+        std::string& output);
+    size_t (*size)(const void* values);
+    void (*resize)(void* values, size_t size);
+    void* (*at)(void* values, size_t index);
+    bool storable;
+};
+
+// Reads a token with one value per delimited element into a list. Replaces
+// the list, or appends to it.
+using SplitFunction = bool (*)(
+    std::string_view input,
+    char delimiter,
+    void* values,
+    bool append,
+    std::optional<KeyAdapter::Element>& invalid);
+
 template <class T>
-class MultiOptionAdapter : public KeyAdapter {
-public:
-    explicit MultiOptionAdapter(MultiOption<T>&& multiOption)
-        : _multiOption(std::move(multiOption))
-    { }
+struct Thunks {
+    static const Choices<T>* typed(const ChoiceTable* choices)
+    {
+        return static_cast<const Choices<T>*>(choices);
+    }
 
-    [[nodiscard]] bool hasArgument() const override
+    static bool read(
+        std::string_view input, void* value, const ChoiceTable* choices)
     {
+        auto converted = T{};
+        if (!convert(input, converted, typed(choices))) {
+            return false;
+        }
+        *static_cast<T*>(value) = std::move(converted);
         return true;
     }
 
-    [[nodiscard]] bool isRequired() const override
+    static bool format(
+        const void* value, const ChoiceTable* choices, std::string& output)
     {
-        return false;
+        return internal::format(
+            *static_cast<const T*>(value), typed(choices), output);
     }
 
-    [[nodiscard]] bool isSet() const override
+    static bool save(BlobWriter& writer, const void* value)
     {
-        throw std::logic_error{"MultiOptionAdapter's isSet must not be called"};
+        writer.put(*static_cast<const T*>(value));
+        return true;
     }
 
-    void raise() override
+    static bool load(BlobReader& reader, void* value)
     {
-        throw std::logic_error{"MultiOptionAdapter's raise must not be called"};
+        return reader.get(*static_cast<T*>(value));
     }
 
-    bool addValue(std::string_view s) override
+    static bool skip(BlobReader& reader)
     {
         auto value = T{};
-        if (read(s, value)) {
-            _multiOption.push(std::move(value));
-            return true;
+        return reader.get(value);
+    }
+
+    static bool push(
+        std::string_view input, void* values, const ChoiceTable* choices)
+    {
+        auto converted = T{};
+        if (!convert(input, converted, typed(choices))) {
+            return false;
         }
-        return false;
+        static_cast<std::vector<T>*>(values)->push_back(std::move(converted));
+        return true;
     }
 
-    [[nodiscard]] const std::vector<std::string>& keys() const override
+    static bool formatAt(
+        const void* values,
+        size_t index,
+        const ChoiceTable* choices,
+        std::string& output)
     {
-        return _multiOption.keys();
+        const auto& vector = *static_cast<const std::vector<T>*>(values);
+        assert(index < vector.size());
+        const T& value = vector[index];
+        return internal::format(value, typed(choices), output);
     }
 
-    [[nodiscard]] std::string metavar() const override
+    static size_t size(const void* values)
     {
-        return _multiOption.metavar();
+        return static_cast<const std::vector<T>*>(values)->size();
     }
 
-    [[nodiscard]] const std::string& help() const override
+    static void resize(void* values, size_t size)
     {
-        return _multiOption.help();
+        static_cast<std::vector<T>*>(values)->resize(size);
     }
 
-    [[nodiscard]] bool multi() const override
+    static void* at(void* values, size_t index)
     {
-        return true;
+        auto& vector = *static_cast<std::vector<T>*>(values);
+        assert(index < vector.size());
+        return &vector[index];
     }
 
-private:
-    MultiOption<T> _multiOption;
+    // The delimiters are counted first, so that the list is allocated once
+    // and each element is read straight into its place
+    static bool split(
+        std::string_view input,
+        char delimiter,
+        void* values,
+        bool append,
+        std::optional<KeyAdapter::Element>& invalid)
+    {
+        auto elements = std::vector<T>{};
+        if (!input.empty()) {
+            elements.resize(simd::count(input, delimiter) + 1);
+        }
+
+        for (size_t i = 0; i < elements.size(); i++) {
+            auto end = simd::find(input, delimiter);
+            auto element = input.substr(0, end);
+            if (!arg::read(element, elements[i])) {
+                invalid = KeyAdapter::Element{i, element};
+                return false;
+            }
+            input.remove_prefix(
+                end == std::string_view::npos ? input.size() : end + 1);
+        }
+
+        auto& list = *static_cast<std::vector<T>*>(values);
+        if (!append) {
+            list = std::move(elements);
+            return true;
+        }
+        list.insert(
+            list.end(),
+            std::make_move_iterator(elements.begin()),
+            std::make_move_iterator(elements.end()));
+        return true;
+    }
 };
 
 template <class T>
-class ValueAdapter : public ArgumentAdapter {
-public:
-    explicit ValueAdapter(Value<T>&& value)
-        : _value(std::move(value))
-    { }
+constexpr ValueOps makeValueOps()
+{
+    auto ops = ValueOps{&typeName<T>, &Thunks<T>::read, &Thunks<T>::format,
+        layout<T>(), 0, nullptr, nullptr, nullptr};
+    if constexpr (Blittable<T>) {
+        ops.bytes = sizeof(T);
+    } else if constexpr (Storable<T>) {
+        ops.save = &Thunks<T>::save;
+        ops.load = &Thunks<T>::load;
+        ops.skip = &Thunks<T>::skip;
+    }
+    return ops;
+}
 
-    [[nodiscard]] bool isRequired() const override
-    {
-        return _value.isRequired();
+template <class T>
+constexpr ListOps makeListOps();
+
+template <class T>
+inline constexpr ValueOps valueOps = makeValueOps<T>();
+
+template <class T>
+inline constexpr ListOps listOps = makeListOps<T>();
+
+template <class T>
+constexpr ListOps makeListOps()
+{
+    auto ops = ListOps{&valueOps<T>, &typeName<std::vector<T>>,
+        &Thunks<T>::push, &Thunks<T>::formatAt, &Thunks<T>::size,
+        nullptr, nullptr, false};
+    if constexpr (Storable<std::vector<T>>) {
+        ops.resize = &Thunks<T>::resize;
+        ops.at = &Thunks<T>::at;
+        ops.storable = true;
     }
+    return ops;
+}
 
-    [[nodiscard]] bool isSet() const override
-    {
-        return _value.isSet();
+// Cache support shared by the adapters. Lists of values that can be copied
+// as bytes are copied as one block.
+inline bool isStorable(const ValueOps& ops)
+{
+    return ops.bytes > 0 || ops.save;
+}
+
+inline bool saveValue(BlobWriter& writer, const ValueOps& ops, void* value)
+{
+    if (ops.bytes > 0) {
+        writer.putBytes(value, ops.bytes);
+        return true;
     }
+    return ops.save && ops.save(writer, value);
+}
 
-    [[nodiscard]] std::string metavar() const override
-    {
-        return _value.metavar();
+inline bool loadValue(BlobReader& reader, const ValueOps& ops, void* value)
+{
+    if (ops.bytes > 0) {
+        return reader.getBytes(value, ops.bytes);
     }
+    return ops.load && ops.load(reader, value);
+}
 
-    [[nodiscard]] const std::string& help() const override
-    {
-        return _value.help();
+inline bool checkValue(BlobReader& reader, const ValueOps& ops)
+{
+    if (ops.bytes > 0) {
+        return reader.skip(ops.bytes);
     }
+    return ops.skip && ops.skip(reader);
+}
 
-    [[nodiscard]] bool multi() const override
-    {
+inline bool saveList(BlobWriter& writer, const ListOps& ops, void* values)
+{
+    if (!ops.storable) {
         return false;
     }
-
-    bool addValue(std::string_view s) override
-    {
-        auto value = T{};
-        if (read(s, value)) {
-            _value = std::move(value);
-            return true;
+    size_t size = ops.size(values);
+    writer.put(static_cast<uint64_t>(size));
+    if (size == 0) {
+        return true;
+    }
+    if (ops.element->bytes > 0) {
+        writer.putBytes(ops.at(values, 0), size * ops.element->bytes);
+        return true;
+    }
+    for (size_t i = 0; i < size; i++) {
+        if (!ops.element->save(writer, ops.at(values, i))) {
+            return false;
         }
+    }
+    return true;
+}
+
+// Appends the loaded values
+inline bool loadList(BlobReader& reader, const ListOps& ops, void* values)
+{
+    uint64_t count = 0;
+    if (!ops.storable || !reader.get(count) || reader.size() < count) {
         return false;
     }
+    if (count == 0) {
+        return true;
+    }
+    size_t first = ops.size(values);
+    ops.resize(values, first + count);
+    if (ops.element->bytes > 0) {
+        return reader.getBytes(
+            ops.at(values, first), count * ops.element->bytes);
+    }
+    for (size_t i = first; i < first + count; i++) {
+        if (!ops.element->load(reader, ops.at(values, i))) {
+            return false;
+        }
+    }
+    return true;
+}
 
-private:
-    Value<T> _value;
-};
+inline bool checkList(BlobReader& reader, const ListOps& ops)
+{
+    uint64_t count = 0;
+    if (!ops.storable || !reader.get(count) || reader.size() < count) {
+        return false;
+    }
+    if (ops.element->bytes > 0) {
+        return reader.skip(count * ops.element->bytes);
+    }
+    for (uint64_t i = 0; i < count; i++) {
+        if (!ops.element->skip(reader)) {
+            return false;
+        }
+    }
+    return true;
+}
 
-template <class T>
-class MultiValueAdapter : public ArgumentAdapter {
+// The adapters for handles of any value type. The typed constructors only
+// pick the operations for T. Subclasses that keep the value elsewhere
+// override target(), and isSet() with markSet().
+class AnyOptionAdapter : public KeyAdapter {
 public:
-    explicit MultiValueAdapter(MultiValue<T>&& multiValue)
-        : _multiValue(std::move(multiValue))
+    template <class T>
+    explicit AnyOptionAdapter(Option<T>&& option)
+        : _data(option._data)
+        , _value(&option._data->value)
+        , _ops(valueOps<T>)
     { }
 
+    [[nodiscard]] bool hasArgument() const override
+    {
+        return true;
+    }
+
     [[nodiscard]] bool isRequired() const override
     {
-        return false;
+        return _data->required;
     }
 
     [[nodiscard]] bool isSet() const override
     {
-        throw std::logic_error{"MultiValueAdapter's isSet must not be called"};
+        return _data->isSet;
     }
 
-    [[nodiscard]] std::string metavar() const override
+    void raise() override
     {
-        return _multiValue.metavar();
+        logicError("OptionAdapter's raise must not be called");
     }
 
-    [[nodiscard]] const std::string& help() const override
+    bool addValue(std::string_view s) override
     {
-        return _multiValue.help();
+        if (!_ops.read(s, target(), _data->choices)) {
+            return false;
+        }
+        markSet();
+        return true;
     }
 
-    [[nodiscard]] bool multi() const override
+    [[nodiscard]] size_t valueCount() const override
     {
-        return true;
+        return isSet() ? 1 : 0;
     }
 
-    bool addValue(std::string_view s) override
+    bool formatValue(size_t, std::string& output) const override
     {
-        auto value = T{};
-        if (read(s, value)) {
-            _multiValue.push(std::move(value));
-            return true;
+        return _ops.format(target(), _data->choices, output);
+    }
+
+    [[nodiscard]] std::string_view valueType() const override
+    {
+        return _ops.name();
+    }
+
+    [[nodiscard]] uint64_t valueLayout() const override
+    {
+        return _ops.layout;
+    }
+
+    bool save(BlobWriter& writer) const override
+    {
+        if (!isStorable(_ops)) {
+            return false;
+        }
+        writer.put(isSet());
+        return !isSet() || saveValue(writer, _ops, target());
+    }
+
+    bool load(BlobReader& reader) override
+    {
+        bool set = false;
+        if (!isStorable(_ops) || !reader.get(set)) {
+            return false;
+        }
+        if (set) {
+            if (!loadValue(reader, _ops, target())) {
+                return false;
+            }
+            markSet();
+        }
+        return true;
+    }
+
+    bool check(BlobReader& reader) const override
+    {
+        bool set = false;
+        if (!isStorable(_ops) || !reader.get(set)) {
+            return false;
+        }
+        return !set || checkValue(reader, _ops);
+    }
+
+    bool saveCurrent(BlobWriter& writer) const override
+    {
+        return saveValue(writer, _ops, target());
+    }
+
+    [[nodiscard]] std::span<const std::string_view> keys() const override
+    {
+        return _data->keys;
+    }
+
+    [[nodiscard]] std::string_view metavar() const override
+    {
+        return _data->metavar;
+    }
+
+    [[nodiscard]] std::string_view help() const override
+    {
+        return _data->help;
+    }
+
+    [[nodiscard]] std::string_view section() const override
+    {
+        return _data->section;
+    }
+
+    [[nodiscard]] bool requiresUtf8() const override
+    {
+        return _data->utf8;
+    }
+
+    [[nodiscard]] bool multi() const override
+    {
+        return false;
+    }
+
+    [[nodiscard]] std::vector<std::string_view> choices() const override
+    {
+        return choiceNames(_data->choices);
+    }
+
+protected:
+    [[nodiscard]] virtual void* target() const
+    {
+        return _value;
+    }
+
+    virtual void markSet()
+    {
+        _data->isSet = true;
+    }
+
+private:
+    std::shared_ptr<HandleData> _data;
+    void* _value;
+    const ValueOps& _ops;
+};
+
+class AnyListOptionAdapter : public KeyAdapter {
+public:
+    template <class T>
+    explicit AnyListOptionAdapter(ListOption<T>&& listOption)
+        : _data(listOption._data)
+        , _values(&listOption._data->value)
+        , _ops(listOps<T>)
+        , _split(&Thunks<T>::split)
+    { }
+
+    [[nodiscard]] bool hasArgument() const override
+    {
+        return true;
+    }
+
+    [[nodiscard]] bool isRequired() const override
+    {
+        return _data->required;
+    }
+
+    [[nodiscard]] bool isSet() const override
+    {
+        return _data->isSet;
+    }
+
+    void raise() override
+    {
+        logicError("ListOptionAdapter's raise must not be called");
+    }
+
+    // The first occurrence of the option replaces the default, later ones
+    // append to it
+    bool addValue(std::string_view s) override
+    {
+        if (!_split(s, _data->delimiter, target(), isSet(), _invalid)) {
+            return false;
+        }
+        markSet();
+        return true;
+    }
+
+    [[nodiscard]] std::optional<Element> invalidElement() const override
+    {
+        return _invalid;
+    }
+
+    [[nodiscard]] size_t valueCount() const override
+    {
+        return isSet() ? 1 : 0;
+    }
+
+    bool formatValue(size_t, std::string& output) const override
+    {
+        size_t size = _ops.size(target());
+        for (size_t i = 0; i < size; i++) {
+            if (i > 0) {
+                output += _data->delimiter;
+            }
+            if (!_ops.formatAt(target(), i, nullptr, output)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The delimiter changes how a token is read, so it is part of the type.
+    // The name is interned once per delimiter, not on every cached parse.
+    [[nodiscard]] std::string_view valueType() const override
+    {
+        if (_valueType.empty() || _typeDelimiter != _data->delimiter) {
+            _typeDelimiter = _data->delimiter;
+            _valueType = textPool().intern(
+                std::string{_ops.name()} + _typeDelimiter);
+        }
+        return _valueType;
+    }
+
+    [[nodiscard]] uint64_t valueLayout() const override
+    {
+        return _ops.element->layout;
+    }
+
+    bool save(BlobWriter& writer) const override
+    {
+        if (!_ops.storable) {
+            return false;
+        }
+        writer.put(isSet());
+        return !isSet() || saveList(writer, _ops, target());
+    }
+
+    bool load(BlobReader& reader) override
+    {
+        bool set = false;
+        if (!_ops.storable || !reader.get(set)) {
+            return false;
+        }
+        if (set) {
+            if (!isSet()) {
+                _ops.resize(target(), 0);
+            }
+            if (!loadList(reader, _ops, target())) {
+                return false;
+            }
+            markSet();
         }
+        return true;
+    }
+
+    bool check(BlobReader& reader) const override
+    {
+        bool set = false;
+        if (!_ops.storable || !reader.get(set)) {
+            return false;
+        }
+        return !set || checkList(reader, _ops);
+    }
+
+    bool saveCurrent(BlobWriter& writer) const override
+    {
+        return saveList(writer, _ops, target());
+    }
+
+    [[nodiscard]] std::span<const std::string_view> keys() const override
+    {
+        return _data->keys;
+    }
+
+    [[nodiscard]] std::string_view metavar() const override
+    {
+        return _data->metavar;
+    }
+
+    [[nodiscard]] std::string_view help() const override
+    {
+        return _data->help;
+    }
+
+    [[nodiscard]] std::string_view section() const override
+    {
+        return _data->section;
+    }
+
+    [[nodiscard]] bool requiresUtf8() const override
+    {
+        return _data->utf8;
+    }
+
+    [[nodiscard]] bool multi() const override
+    {
         return false;
     }
 
+    [[nodiscard]] std::vector<std::string_view> choices() const override
+    {
+        return {};
+    }
+
+protected:
+    [[nodiscard]] virtual void* target() const
+    {
+        return _values;
+    }
+
+    virtual void markSet()
+    {
+        _data->isSet = true;
+    }
+
 private:
-    MultiValue<T> _multiValue;
+    std::shared_ptr<HandleData> _data;
+    void* _values;
+    const ListOps& _ops;
+    SplitFunction _split;
+    std::optional<Element> _invalid;
+    mutable std::string_view _valueType;
+    mutable char _typeDelimiter = 0;
 };
 
+class AnyMultiOptionAdapter : public KeyAdapter {
+public:
+    template <class T>
+    explicit AnyMultiOptionAdapter(MultiOption<T>&& multiOption)
+        : _data(multiOption._data)
+        , _values(&multiOption._data->value)
+        , _ops(listOps<T>)
+    { }
+
+    [[nodiscard]] bool hasArgument() const override
+    {
+        return true;
+    }
+
+    [[nodiscard]] bool isRequired() const override
+    {
+        return false;
+    }
+
+    [[nodiscard]] bool isSet() const override
+    {
+        logicError("MultiOptionAdapter's isSet must not be called");
+    }
+
+    void raise() override
+    {
+        logicError("MultiOptionAdapter's raise must not be called");
+    }
+
+    bool addValue(std::string_view s) override
+    {
+        return _ops.push(s, target(), _data->choices);
+    }
+
+    [[nodiscard]] size_t valueCount() const override
+    {
+        return _ops.size(target());
+    }
+
+    bool formatValue(size_t index, std::string& output) const override
+    {
+        return _ops.formatAt(target(), index, _data->choices, output);
+    }
+
+    [[nodiscard]] std::string_view valueType() const override
+    {
+        return _ops.name();
+    }
+
+    [[nodiscard]] uint64_t valueLayout() const override
+    {
+        return _ops.element->layout;
+    }
+
+    bool save(BlobWriter& writer) const override
+    {
+        return saveList(writer, _ops, target());
+    }
+
+    bool load(BlobReader& reader) override
+    {
+        return loadList(reader, _ops, target());
+    }
+
+    bool check(BlobReader& reader) const override
+    {
+        return checkList(reader, _ops);
+    }
+
+    bool saveCurrent(BlobWriter& writer) const override
+    {
+        return save(writer);
+    }
+
+    [[nodiscard]] std::span<const std::string_view> keys() const override
+    {
+        return _data->keys;
+    }
+
+    [[nodiscard]] std::string_view metavar() const override
+    {
+        return _data->metavar;
+    }
+
+    [[nodiscard]] std::string_view help() const override
+    {
+        return _data->help;
+    }
+
+    [[nodiscard]] std::string_view section() const override
+    {
+        return _data->section;
+    }
+
+    [[nodiscard]] bool requiresUtf8() const override
+    {
+        return _data->utf8;
+    }
+
+    [[nodiscard]] bool multi() const override
+    {
+        return true;
+    }
+
+    [[nodiscard]] std::vector<std::string_view> choices() const override
+    {
+        return choiceNames(_data->choices);
+    }
+
+protected:
+    [[nodiscard]] virtual void* target() const
+    {
+        return _values;
+    }
+
+private:
+    std::shared_ptr<HandleData> _data;
+    void* _values;
+    const ListOps& _ops;
+};
+
+class AnyValueAdapter : public ArgumentAdapter {
+public:
+    template <class T>
+    explicit AnyValueAdapter(Value<T>&& value)
+        : _data(value._data)
+        , _value(&value._data->value)
+        , _ops(valueOps<T>)
+    { }
+
+    [[nodiscard]] bool isRequired() const override
+    {
+        return _data->required;
+    }
+
+    [[nodiscard]] bool isSet() const override
+    {
+        return _data->isSet;
+    }
+
+    [[nodiscard]] std::string_view metavar() const override
+    {
+        return _data->metavar;
+    }
+
+    [[nodiscard]] std::string_view help() const override
+    {
+        return _data->help;
+    }
+
+    [[nodiscard]] bool requiresUtf8() const override
+    {
+        return _data->utf8;
+    }
+
+    [[nodiscard]] bool multi() const override
+    {
+        return false;
+    }
+
+    [[nodiscard]] std::vector<std::string_view> choices() const override
+    {
+        return choiceNames(_data->choices);
+    }
+
+    bool addValue(std::string_view s) override
+    {
+        if (!_ops.read(s, target(), _data->choices)) {
+            return false;
+        }
+        markSet();
+        return true;
+    }
+
+    [[nodiscard]] size_t valueCount() const override
+    {
+        return isSet() ? 1 : 0;
+    }
+
+    bool formatValue(size_t, std::string& output) const override
+    {
+        return _ops.format(target(), _data->choices, output);
+    }
+
+    [[nodiscard]] std::string_view valueType() const override
+    {
+        return _ops.name();
+    }
+
+    [[nodiscard]] uint64_t valueLayout() const override
+    {
+        return _ops.layout;
+    }
+
+    bool save(BlobWriter& writer) const override
+    {
+        if (!isStorable(_ops)) {
+            return false;
+        }
+        writer.put(isSet());
+        return !isSet() || saveValue(writer, _ops, target());
+    }
+
+    bool load(BlobReader& reader) override
+    {
+        bool set = false;
+        if (!isStorable(_ops) || !reader.get(set)) {
+            return false;
+        }
+        if (set) {
+            if (!loadValue(reader, _ops, target())) {
+                return false;
+            }
+            markSet();
+        }
+        return true;
+    }
+
+    bool check(BlobReader& reader) const override
+    {
+        bool set = false;
+        if (!isStorable(_ops) || !reader.get(set)) {
+            return false;
+        }
+        return !set || checkValue(reader, _ops);
+    }
+
+    bool saveCurrent(BlobWriter& writer) const override
+    {
+        return saveValue(writer, _ops, target());
+    }
+
+protected:
+    [[nodiscard]] virtual void* target() const
+    {
+        return _value;
+    }
+
+    virtual void markSet()
+    {
+        _data->isSet = true;
+    }
+
+private:
+    std::shared_ptr<HandleData> _data;
+    void* _value;
+    const ValueOps& _ops;
+};
+
+class AnyMultiValueAdapter : public ArgumentAdapter {
+public:
+    template <class T>
+    explicit AnyMultiValueAdapter(MultiValue<T>&& multiValue)
+        : _data(multiValue._data)
+        , _values(&multiValue._data->value)
+        , _ops(listOps<T>)
+    { }
+
+    [[nodiscard]] bool isRequired() const override
+    {
+        return false;
+    }
+
+    [[nodiscard]] bool isSet() const override
+    {
+        logicError("MultiValueAdapter's isSet must not be called");
+    }
+
+    [[nodiscard]] std::string_view metavar() const override
+    {
+        return _data->metavar;
+    }
+
+    [[nodiscard]] std::string_view help() const override
+    {
+        return _data->help;
+    }
+
+    [[nodiscard]] bool requiresUtf8() const override
+    {
+        return _data->utf8;
+    }
+
+    [[nodiscard]] bool multi() const override
+    {
+        return true;
+    }
+
+    [[nodiscard]] std::vector<std::string_view> choices() const override
+    {
+        return choiceNames(_data->choices);
+    }
+
+    bool addValue(std::string_view s) override
+    {
+        return _ops.push(s, target(), _data->choices);
+    }
+
+    [[nodiscard]] size_t valueCount() const override
+    {
+        return _ops.size(target());
+    }
+
+    bool formatValue(size_t index, std::string& output) const override
+    {
+        return _ops.formatAt(target(), index, _data->choices, output);
+    }
+
+    [[nodiscard]] std::string_view valueType() const override
+    {
+        return _ops.name();
+    }
+
+    [[nodiscard]] uint64_t valueLayout() const override
+    {
+        return _ops.element->layout;
+    }
+
+    bool save(BlobWriter& writer) const override
+    {
+        return saveList(writer, _ops, target());
+    }
+
+    bool load(BlobReader& reader) override
+    {
+        return loadList(reader, _ops, target());
+    }
+
+    bool check(BlobReader& reader) const override
+    {
+        return checkList(reader, _ops);
+    }
+
+    bool saveCurrent(BlobWriter& writer) const override
+    {
+        return save(writer);
+    }
+
+protected:
+    [[nodiscard]] virtual void* target() const
+    {
+        return _values;
+    }
+
+private:
+    std::shared_ptr<HandleData> _data;
+    void* _values;
+    const ListOps& _ops;
+};
+
+} // namespace internal
+
+// The adapter of each handle type is the same class for all value types
+template <class T>
+using OptionAdapter = internal::AnyOptionAdapter;
+
+template <class T>
+using ListOptionAdapter = internal::AnyListOptionAdapter;
+
+template <class T>
+using MultiOptionAdapter = internal::AnyMultiOptionAdapter;
+
+template <class T>
+using ValueAdapter = internal::AnyValueAdapter;
+
+template <class T>
+using MultiValueAdapter = internal::AnyMultiValueAdapter;
+
 } // namespace arg
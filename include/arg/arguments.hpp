@@ -1,8 +1,14 @@
 #pragma once
 
+#include "arg/choices.hpp"
+#include "arg/converters.hpp"
+#include "arg/text.hpp"
+
+#include <concepts>
 #include <istream>
 #include <memory>
 #include <ostream>
+#include <span>
 #include <string>
 #include <string_view>
 #include <type_traits>
@@ -11,31 +17,84 @@
 
 namespace arg {
 
+namespace internal {
+
+class AnyOptionAdapter;
+class AnyListOptionAdapter;
+class AnyMultiOptionAdapter;
+class AnyValueAdapter;
+class AnyMultiValueAdapter;
+
+// The state of a handle that does not depend on its value type. Adapters
+// only see this part and a pointer to the value, so they are shared by all
+// value types.
+struct HandleData {
+    std::span<const std::string_view> keys;
+    std::string_view help;
+    std::string_view section;
+    std::string_view metavar = "VALUE";
+    const ChoiceTable* choices = nullptr;
+    char delimiter = ',';
+    bool utf8 = false;
+    bool required = false;
+    bool hasDefault = false;
+    bool isSet = false;
+};
+
+template <class T>
+concept Text = std::same_as<T, std::string> || PathLike<T>;
+
+// Holds a value of type V, and the choices for its elements of type T
+template <class V, class T = V>
+struct HandleValue : HandleData {
+    std::unique_ptr<const Choices<T>> ownedChoices;
+    V value = V{};
+};
+
+} // namespace internal
+
 class Flag {
 public:
     template <class... Args>
+    requires (sizeof...(Args) > 0)
     Flag keys(Args&&... args)
     {
-        _data->keys = {std::forward<Args>(args)...};
+        _data->keys = internal::internKeys(std::forward<Args>(args)...);
+        internal::schemaChanged();
         return *this;
     }
 
-    [[nodiscard]] const std::vector<std::string>& keys() const
+    [[nodiscard]] std::span<const std::string_view> keys() const
     {
         return _data->keys;
     }
 
     Flag help(std::string_view s)
     {
-        _data->help = s;
+        _data->help = internal::textPool().intern(s);
+        internal::schemaChanged();
         return *this;
     }
 
-    [[nodiscard]] const std::string& help() const
+    [[nodiscard]] std::string_view help() const
     {
         return _data->help;
     }
 
+    // Help lists options by section, and --help=section lists only the
+    // options of one. Options without a section come first.
+    Flag section(std::string_view s)
+    {
+        _data->section = internal::textPool().intern(s);
+        internal::schemaChanged();
+        return *this;
+    }
+
+    [[nodiscard]] std::string_view section() const
+    {
+        return _data->section;
+    }
+
     bool operator*() const
     {
         return _data->value;
@@ -59,8 +118,9 @@ public:
 
 private:
     struct Data {
-        std::vector<std::string> keys;
-        std::string help;
+        std::span<const std::string_view> keys;
+        std::string_view help;
+        std::string_view section;
         bool value = false;
     };
 
@@ -80,28 +140,43 @@ inline std::istream& operator>>(std::istream& input, Flag& flag)
 class MultiFlag {
 public:
     template <class... Args>
+    requires (sizeof...(Args) > 0)
     MultiFlag keys(Args&&... args)
     {
-        _data->keys = {std::forward<Args>(args)...};
+        _data->keys = internal::internKeys(std::forward<Args>(args)...);
+        internal::schemaChanged();
         return *this;
     }
 
-    [[nodiscard]] const std::vector<std::string>& keys() const
+    [[nodiscard]] std::span<const std::string_view> keys() const
     {
         return _data->keys;
     }
 
     MultiFlag help(std::string_view s)
     {
-        _data->help = s;
+        _data->help = internal::textPool().intern(s);
+        internal::schemaChanged();
         return *this;
     }
 
-    [[nodiscard]] const std::string& help() const
+    [[nodiscard]] std::string_view help() const
     {
         return _data->help;
     }
 
+    MultiFlag section(std::string_view s)
+    {
+        _data->section = internal::textPool().intern(s);
+        internal::schemaChanged();
+        return *this;
+    }
+
+    [[nodiscard]] std::string_view section() const
+    {
+        return _data->section;
+    }
+
     size_t operator*() const
     {
         return _data->count;
@@ -125,8 +200,9 @@ public:
 
 private:
     struct Data {
-        std::vector<std::string> keys;
-        std::string help;
+        std::span<const std::string_view> keys;
+        std::string_view help;
+        std::string_view section;
         size_t count = 0;
     };
 
@@ -147,42 +223,85 @@ template <class T>
 class Option {
 public:
     template <class... Args>
+    requires (sizeof...(Args) > 0)
     Option keys(Args&&... args)
     {
-        _data->keys = {std::forward<Args>(args)...};
+        _data->keys = internal::internKeys(std::forward<Args>(args)...);
+        internal::schemaChanged();
         return *this;
     }
 
-    [[nodiscard]] const std::vector<std::string>& keys() const
+    [[nodiscard]] std::span<const std::string_view> keys() const
     {
         return _data->keys;
     }
 
     Option help(std::string_view s)
     {
-        _data->help = s;
+        _data->help = internal::textPool().intern(s);
+        internal::schemaChanged();
         return *this;
     }
 
-    [[nodiscard]] const std::string& help() const
+    [[nodiscard]] std::string_view help() const
     {
         return _data->help;
     }
 
+    Option section(std::string_view s)
+    {
+        _data->section = internal::textPool().intern(s);
+        internal::schemaChanged();
+        return *this;
+    }
+
+    [[nodiscard]] std::string_view section() const
+    {
+        return _data->section;
+    }
+
     Option metavar(std::string_view s)
     {
-        _data->metavar = s;
+        _data->metavar = internal::textPool().intern(s);
+        internal::schemaChanged();
+        return *this;
+    }
+
+    // Values that are not valid UTF-8 are rejected, and the error tells the
+    // offset of the first invalid byte
+    Option utf8() requires internal::Text<T>
+    {
+        _data->utf8 = true;
         return *this;
     }
 
-    [[nodiscard]] const std::string& metavar() const
+    [[nodiscard]] std::string_view metavar() const
     {
         return _data->metavar;
     }
 
+    Option choices(Choices<T> choices)
+    {
+        if (_data->metavar == "VALUE") {
+            _data->metavar =
+                internal::textPool().intern("{" + choices.join(",") + "}");
+        }
+        _data->ownedChoices =
+            std::make_unique<const Choices<T>>(std::move(choices));
+        _data->choices = _data->ownedChoices.get();
+        internal::schemaChanged();
+        return *this;
+    }
+
+    [[nodiscard]] const Choices<T>* choices() const
+    {
+        return _data->ownedChoices.get();
+    }
+
     Option markRequired()
     {
         _data->required = true;
+        internal::schemaChanged();
         return *this;
     }
 
@@ -194,9 +313,16 @@ public:
     Option defaultValue(T&& value)
     {
         _data->value = std::forward<T>(value);
+        _data->hasDefault = true;
         return *this;
     }
 
+    // Whether defaultValue was called
+    [[nodiscard]] bool hasDefault() const
+    {
+        return _data->hasDefault;
+    }
+
     [[nodiscard]] bool isSet() const
     {
         return _data->isSet;
@@ -235,14 +361,9 @@ public:
     }
 
 private:
-    struct Data {
-        std::vector<std::string> keys;
-        std::string help;
-        std::string metavar = "VALUE";
-        bool required = false;
-        T value = T{};
-        bool isSet = false;
-    };
+    friend class internal::AnyOptionAdapter;
+
+    using Data = internal::HandleValue<T>;
 
     std::shared_ptr<Data> _data = std::make_shared<Data>();
 };
@@ -263,81 +384,118 @@ template <class T>
 class MultiOption {
 public:
     template <class... Args>
+    requires (sizeof...(Args) > 0)
     MultiOption keys(Args&&... args)
     {
-        _data->keys = {std::forward<Args>(args)...};
+        _data->keys = internal::internKeys(std::forward<Args>(args)...);
+        internal::schemaChanged();
         return *this;
     }
 
-    [[nodiscard]] const std::vector<std::string>& keys() const
+    [[nodiscard]] std::span<const std::string_view> keys() const
     {
         return _data->keys;
     }
 
     MultiOption help(std::string_view s)
     {
-        _data->help = s;
+        _data->help = internal::textPool().intern(s);
+        internal::schemaChanged();
+        return *this;
+    }
+
+    MultiOption section(std::string_view s)
+    {
+        _data->section = internal::textPool().intern(s);
+        internal::schemaChanged();
         return *this;
     }
 
+    [[nodiscard]] std::string_view section() const
+    {
+        return _data->section;
+    }
+
     MultiOption metavar(std::string_view s)
     {
-        _data->metavar = s;
+        _data->metavar = internal::textPool().intern(s);
+        internal::schemaChanged();
         return *this;
     }
 
-    [[nodiscard]] const std::string& metavar() const
+    MultiOption utf8() requires internal::Text<T>
+    {
+        _data->utf8 = true;
+        return *this;
+    }
+
+    [[nodiscard]] std::string_view metavar() const
     {
         return _data->metavar;
     }
 
-    [[nodiscard]] const std::string& help() const
+    MultiOption choices(Choices<T> choices)
+    {
+        if (_data->metavar == "VALUE") {
+            _data->metavar =
+                internal::textPool().intern("{" + choices.join(",") + "}");
+        }
+        _data->ownedChoices =
+            std::make_unique<const Choices<T>>(std::move(choices));
+        _data->choices = _data->ownedChoices.get();
+        internal::schemaChanged();
+        return *this;
+    }
+
+    [[nodiscard]] const Choices<T>* choices() const
+    {
+        return _data->ownedChoices.get();
+    }
+
+    [[nodiscard]] std::string_view help() const
     {
         return _data->help;
     }
 
     auto begin() const
     {
-        return _data->values.begin();
+        return _data->value.begin();
     }
 
     auto begin()
     {
-        return _data->values.begin();
+        return _data->value.begin();
     }
 
     auto end() const
     {
-        return _data->values.end();
+        return _data->value.end();
     }
 
     auto end()
     {
-        return _data->values.end();
+        return _data->value.end();
     }
 
     void push(T&& value)
     {
-        _data->values.push_back(std::forward<T>(value));
+        _data->value.push_back(std::forward<T>(value));
     }
 
     const std::vector<T>& vector() const
     {
-        return _data->values;
+        return _data->value;
     }
 
     std::vector<T>& vector()
     {
-        return _data->values;
+        return _data->value;
     }
 
 private:
-    struct Data {
-        std::vector<std::string> keys;
-        std::string help;
-        std::string metavar = "VALUE";
-        std::vector<T> values;
-    };
+    friend class internal::AnyMultiOptionAdapter;
+
+    using Data = internal::HandleValue<std::vector<T>, T>;
 
     std::shared_ptr<Data> _data = std::make_shared<Data>();
 };
@@ -354,34 +512,208 @@ std::istream& operator>>(std::istream& input, MultiOption<T>& multiOption)
     return input >> *multiOption;
 }
 
+// An option whose value is a list in a single token: --ids=1,2,3. Giving the
+// option again appends to the list.
+template <class T>
+class ListOption {
+public:
+    template <class... Args>
+    requires (sizeof...(Args) > 0)
+    ListOption keys(Args&&... args)
+    {
+        _data->keys = internal::internKeys(std::forward<Args>(args)...);
+        internal::schemaChanged();
+        return *this;
+    }
+
+    [[nodiscard]] std::span<const std::string_view> keys() const
+    {
+        return _data->keys;
+    }
+
+    ListOption help(std::string_view s)
+    {
+        _data->help = internal::textPool().intern(s);
+        internal::schemaChanged();
+        return *this;
+    }
+
+    [[nodiscard]] std::string_view help() const
+    {
+        return _data->help;
+    }
+
+    ListOption section(std::string_view s)
+    {
+        _data->section = internal::textPool().intern(s);
+        internal::schemaChanged();
+        return *this;
+    }
+
+    [[nodiscard]] std::string_view section() const
+    {
+        return _data->section;
+    }
+
+    ListOption metavar(std::string_view s)
+    {
+        _data->metavar = internal::textPool().intern(s);
+        internal::schemaChanged();
+        return *this;
+    }
+
+    ListOption utf8() requires internal::Text<T>
+    {
+        _data->utf8 = true;
+        return *this;
+    }
+
+    [[nodiscard]] std::string_view metavar() const
+    {
+        return _data->metavar;
+    }
+
+    ListOption delimiter(char c)
+    {
+        _data->delimiter = c;
+        return *this;
+    }
+
+    [[nodiscard]] char delimiter() const
+    {
+        return _data->delimiter;
+    }
+
+    ListOption markRequired()
+    {
+        _data->required = true;
+        internal::schemaChanged();
+        return *this;
+    }
+
+    [[nodiscard]] bool isRequired() const
+    {
+        return _data->required;
+    }
+
+    ListOption defaultValue(std::vector<T>&& values)
+    {
+        _data->value = std::move(values);
+        _data->hasDefault = true;
+        return *this;
+    }
+
+    // Whether defaultValue was called
+    [[nodiscard]] bool hasDefault() const
+    {
+        return _data->hasDefault;
+    }
+
+    [[nodiscard]] bool isSet() const
+    {
+        return _data->isSet;
+    }
+
+    const std::vector<T>& operator*() const
+    {
+        return _data->value;
+    }
+
+    std::vector<T>& operator*()
+    {
+        return _data->value;
+    }
+
+    const std::vector<T>* operator->() const
+    {
+        return &_data->value;
+    }
+
+    std::vector<T>* operator->()
+    {
+        return &_data->value;
+    }
+
+    auto begin() const
+    {
+        return _data->value.begin();
+    }
+
+    auto end() const
+    {
+        return _data->value.end();
+    }
+
+    ListOption& operator=(std::vector<T>&& values)
+    {
+        _data->value = std::move(values);
+        _data->isSet = true;
+        return *this;
+    }
+
+private:
+    friend class internal::AnyListOptionAdapter;
+
+    using Data = internal::HandleValue<std::vector<T>, T>;
+
+    std::shared_ptr<Data> _data = std::make_shared<Data>();
+};
+
 template <class T>
 class Value {
 public:
     Value help(std::string_view s)
     {
-        _data->help = s;
+        _data->help = internal::textPool().intern(s);
+        internal::schemaChanged();
         return *this;
     }
 
-    [[nodiscard]] const std::string& help() const
+    [[nodiscard]] std::string_view help() const
     {
         return _data->help;
     }
 
     Value metavar(std::string_view s)
     {
-        _data->metavar = s;
+        _data->metavar = internal::textPool().intern(s);
+        internal::schemaChanged();
         return *this;
     }
 
-    [[nodiscard]] const std::string& metavar() const
+    Value utf8() requires internal::Text<T>
+    {
+        _data->utf8 = true;
+        return *this;
+    }
+
+    [[nodiscard]] std::string_view metavar() const
     {
         return _data->metavar;
     }
 
+    Value choices(Choices<T> choices)
+    {
+        if (_data->metavar == "VALUE") {
+            _data->metavar =
+                internal::textPool().intern("{" + choices.join(",") + "}");
+        }
+        _data->ownedChoices =
+            std::make_unique<const Choices<T>>(std::move(choices));
+        _data->choices = _data->ownedChoices.get();
+        internal::schemaChanged();
+        return *this;
+    }
+
+    [[nodiscard]] const Choices<T>* choices() const
+    {
+        return _data->ownedChoices.get();
+    }
+
     Value markRequired()
     {
         _data->required = true;
+        internal::schemaChanged();
         return *this;
     }
 
@@ -393,9 +725,16 @@ public:
     Value defaultValue(T&& value)
     {
         _data->value = std::forward<T>(value);
+        _data->hasDefault = true;
         return *this;
     }
 
+    // Whether defaultValue was called
+    [[nodiscard]] bool hasDefault() const
+    {
+        return _data->hasDefault;
+    }
+
     [[nodiscard]] bool isSet() const
     {
         return _data->isSet;
@@ -434,13 +773,9 @@ public:
     }
 
 private:
-    struct Data {
-        std::string help;
-        std::string metavar = "VALUE";
-        bool required = false;
-        T value = T{};
-        bool isSet = false;
-    };
+    friend class internal::AnyValueAdapter;
+
+    using Data = internal::HandleValue<T>;
 
     std::shared_ptr<Data> _data = std::make_shared<Data>();
 };
@@ -462,67 +797,91 @@ class MultiValue {
 public:
     MultiValue help(std::string_view s)
     {
-        _data->help = s;
+        _data->help = internal::textPool().intern(s);
+        internal::schemaChanged();
         return *this;
     }
 
-    [[nodiscard]] const std::string& help() const
+    [[nodiscard]] std::string_view help() const
     {
         return _data->help;
     }
 
     MultiValue metavar(std::string_view s)
     {
-        _data->metavar = s;
+        _data->metavar = internal::textPool().intern(s);
+        internal::schemaChanged();
+        return *this;
+    }
+
+    MultiValue utf8() requires internal::Text<T>
+    {
+        _data->utf8 = true;
         return *this;
     }
 
-    [[nodiscard]] const std::string& metavar() const
+    [[nodiscard]] std::string_view metavar() const
     {
         return _data->metavar;
     }
 
+    MultiValue choices(Choices<T> choices)
+    {
+        if (_data->metavar == "VALUE") {
+            _data->metavar =
+                internal::textPool().intern("{" + choices.join(",") + "}");
+        }
+        _data->ownedChoices =
+            std::make_unique<const Choices<T>>(std::move(choices));
+        _data->choices = _data->ownedChoices.get();
+        internal::schemaChanged();
+        return *this;
+    }
+
+    [[nodiscard]] const Choices<T>* choices() const
+    {
+        return _data->ownedChoices.get();
+    }
+
     auto begin() const
     {
-        return _data->values.begin();
+        return _data->value.begin();
     }
 
     auto begin()
     {
-        return _data->values.begin();
+        return _data->value.begin();
     }
 
     auto end() const
     {
-        return _data->values.end();
+        return _data->value.end();
     }
 
     auto end()
     {
-        return _data->values.end();
+        return _data->value.end();
     }
 
     void push(T&& value)
     {
-        _data->values.push_back(std::forward<T>(value));
+        _data->value.push_back(std::forward<T>(value));
     }
 
     const std::vector<T>& vector() const
     {
-        return _data->values;
+        return _data->value;
     }
 
     std::vector<T>& vector()
     {
-        return _data->values;
+        return _data->value;
     }
 
 private:
-    struct Data {
-        std::string help;
-        std::string metavar = "VALUE";
-        std::vector<T> values;
-    };
+    friend class internal::AnyMultiValueAdapter;
+
+    using Data = internal::HandleValue<std::vector<T>, T>;
 
     std::shared_ptr<Data> _data = std::make_shared<Data>();
 };
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace arg {
+
+class Parser;
+
+// Argument vector in the layout that execv expects. All tokens live in one
+// buffer, each followed by a null character, and the table of pointers into
+// it ends with a null pointer. The first token is the program name.
+//
+//     auto argv = parser.toArgv();
+//     execv(path, argv.argv());
+class Argv {
+public:
+    Argv() = default;
+    Argv(const Argv&) = delete;
+    Argv(Argv&&) = default;
+    Argv& operator=(const Argv&) = delete;
+    Argv& operator=(Argv&&) = default;
+
+    [[nodiscard]] int argc() const
+    {
+        return static_cast<int>(size());
+    }
+
+    [[nodiscard]] char* const* argv() const
+    {
+        return _table.data();
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return _table.empty() ? 0 : _table.size() - 1;
+    }
+
+    [[nodiscard]] std::string_view operator[](size_t index) const
+    {
+        assert(index < size());
+        return _table[index];
+    }
+
+    // Tokens after the program name, as Parser::parse takes them
+    [[nodiscard]] std::span<char* const> args() const
+    {
+        return size() > 0 ?
+            std::span<char* const>{_table.data() + 1, size() - 1} :
+            std::span<char* const>{};
+    }
+
+private:
+    friend class Parser;
+
+    // The buffer is built as a std::string, and the offsets of the tokens
+    // are turned into pointers once it no longer grows
+    void finishToken()
+    {
+        _buffer.push_back('\0');
+        _starts.push_back(_tokenStart);
+        _tokenStart = _buffer.size();
+    }
+
+    void token(std::string_view text)
+    {
+        _buffer += text;
+        finishToken();
+    }
+
+    void finish()
+    {
+        _data.assign(_buffer.begin(), _buffer.end());
+        _table.reserve(_starts.size() + 1);
+        for (auto start : _starts) {
+            _table.push_back(_data.data() + start);
+        }
+        _table.push_back(nullptr);
+        _buffer = {};
+        _starts = {};
+    }
+
+    std::string _buffer;
+    std::vector<size_t> _starts;
+    size_t _tokenStart = 0;
+
+    std::vector<char> _data;
+    std::vector<char*> _table;
+};
+
+} // namespace arg
@@ -0,0 +1,185 @@
+#pragma once
+
+#include "arg/converters.hpp"
+
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <source_location>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace arg {
+
+// Specialize as std::true_type to let the parse cache copy values of T as
+// bytes. Only for trivially copyable types whose bytes are their whole
+// value: no pointers, and no views into other memory.
+template <class T>
+struct StoreAsBytes : std::false_type {};
+
+namespace internal {
+
+// Flat binary encoding of converted values, used by the parse cache. Values
+// are stored in native byte order and layout, so a blob is only meant to be
+// read back by the program that wrote it.
+
+// Time points are matched by shape, like durations, so that <chrono> is only
+// needed by code that uses them
+template <class T>
+concept TimePoint =
+    requires (const T& timePoint) {
+        typename T::clock;
+        typename T::duration;
+        timePoint.time_since_epoch();
+    } &&
+    Duration<typename T::duration>;
+
+template <class T>
+concept ArithmeticTicks =
+    (Duration<T> && std::is_arithmetic_v<typename T::rep>) ||
+    (TimePoint<T> && std::is_arithmetic_v<typename T::duration::rep>);
+
+template <class T>
+concept Blittable =
+    std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+    ((ArithmeticTicks<T> || StoreAsBytes<T>::value) &&
+        std::is_trivially_copyable_v<T>);
+
+template <class T>
+struct IsStorable : std::bool_constant<
+    Blittable<T> || std::same_as<T, std::string> || PathLike<T>> {};
+
+template <class T>
+struct IsStorable<std::vector<T>> : IsStorable<T> {};
+
+template <>
+struct IsStorable<std::vector<bool>> : std::false_type {};
+
+template <class T>
+concept Storable = IsStorable<T>::value;
+
+class BlobWriter {
+public:
+    template <class T>
+    void put(const T& value)
+    {
+        if constexpr (Blittable<T>) {
+            putBytes(&value, sizeof(T));
+        } else if constexpr (std::same_as<T, std::string>) {
+            put(static_cast<uint64_t>(value.size()));
+            _data.append(value);
+        } else if constexpr (PathLike<T>) {
+            put(value.string());
+        } else {
+            put(static_cast<uint64_t>(value.size()));
+            for (const auto& element : value) {
+                put(element);
+            }
+        }
+    }
+
+    void putBytes(const void* data, size_t size)
+    {
+        _data.append(static_cast<const char*>(data), size);
+    }
+
+    [[nodiscard]] const std::string& data() const
+    {
+        return _data;
+    }
+
+private:
+    std::string _data;
+};
+
+class BlobReader {
+public:
+    explicit BlobReader(std::string_view data)
+        : _data(data)
+    { }
+
+    template <class T>
+    bool get(T& value)
+    {
+        if constexpr (Blittable<T>) {
+            return getBytes(&value, sizeof(T));
+        } else if constexpr (std::same_as<T, std::string> || PathLike<T>) {
+            uint64_t size = 0;
+            if (!get(size) || _data.size() < size) {
+                return false;
+            }
+            value = T{_data.substr(0, size)};
+            _data.remove_prefix(size);
+            return true;
+        } else {
+            uint64_t size = 0;
+            if (!get(size) || _data.size() < size) {
+                return false;
+            }
+            value.clear();
+            value.resize(size);
+            for (auto& element : value) {
+                if (!get(element)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    bool getBytes(void* data, size_t size)
+    {
+        if (_data.size() < size) {
+            return false;
+        }
+        if (size > 0) {
+            std::memcpy(data, _data.data(), size);
+        }
+        _data.remove_prefix(size);
+        return true;
+    }
+
+    bool skip(size_t size)
+    {
+        if (_data.size() < size) {
+            return false;
+        }
+        _data.remove_prefix(size);
+        return true;
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return _data.size();
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return _data.empty();
+    }
+
+private:
+    std::string_view _data;
+};
+
+// A string that names T, for schema fingerprints. It comes from the
+// compiler, not from RTTI, and only has to be stable within one build; keys
+// that outlive a build add layout() and the program's identity.
+template <class T>
+std::string_view typeName()
+{
+    return std::source_location::current().function_name();
+}
+
+// Size and alignment of T in one number
+template <class T>
+constexpr uint64_t layout()
+{
+    return uint64_t{sizeof(T)} << 32 | alignof(T);
+}
+
+} // namespace internal
+
+} // namespace arg
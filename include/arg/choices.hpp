@@ -0,0 +1,174 @@
+#pragma once
+
+#include "arg/impl/hash.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace arg {
+
+namespace internal {
+
+// The names of a set of choices, kept apart from their values so that the
+// code working on names is shared by all value types
+class ChoiceTable {
+public:
+    // Index of the first choice with the given name, or npos. The token is
+    // hashed once and compared with at most the names in its probe run.
+    [[nodiscard]] size_t indexOf(std::string_view token) const
+    {
+        if (_slots.empty()) {
+            return std::string_view::npos;
+        }
+        const auto hash = hash32(token);
+        const auto mask = _slots.size() - 1;
+        for (auto i = hash & mask; _slots[i].index != empty;
+                i = (i + 1) & mask) {
+            const auto& slot = _slots[i];
+            if (slot.hash == hash && name(slot.index) == token) {
+                return slot.index;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return _entries.size();
+    }
+
+    // Choice names in the order they were defined
+    [[nodiscard]] std::vector<std::string_view> names() const
+    {
+        std::vector<std::string_view> names;
+        names.reserve(_entries.size());
+        for (uint32_t i = 0; i < _entries.size(); i++) {
+            names.push_back(name(i));
+        }
+        return names;
+    }
+
+    [[nodiscard]] std::string join(std::string_view separator) const
+    {
+        std::string result;
+        for (uint32_t i = 0; i < _entries.size(); i++) {
+            if (i > 0) {
+                result += separator;
+            }
+            result += name(i);
+        }
+        return result;
+    }
+
+    [[nodiscard]] std::string_view name(size_t index) const
+    {
+        const auto& entry = _entries[index];
+        return std::string_view{_names}.substr(entry.offset, entry.size);
+    }
+
+protected:
+    void add(std::string_view name)
+    {
+        _entries.push_back(Entry{
+            static_cast<uint32_t>(_names.size()),
+            static_cast<uint32_t>(name.size())});
+        _names.append(name);
+    }
+
+    // Builds the lookup table, at most half full so that probe runs stay
+    // short
+    void index()
+    {
+        _slots.assign(
+            std::bit_ceil(std::max<size_t>(8, 2 * _entries.size())),
+            Slot{0, empty});
+        const auto mask = _slots.size() - 1;
+        for (uint32_t index = 0; index < _entries.size(); index++) {
+            const auto hash = hash32(name(index));
+            auto i = hash & mask;
+            while (_slots[i].index != empty) {
+                if (_slots[i].hash == hash && name(_slots[i].index) ==
+                        name(index)) {
+                    break;
+                }
+                i = (i + 1) & mask;
+            }
+            if (_slots[i].index == empty) {
+                _slots[i] = Slot{hash, index};
+            }
+        }
+    }
+
+private:
+    struct Entry {
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    struct Slot {
+        uint32_t hash;
+        uint32_t index;
+    };
+
+    static constexpr uint32_t empty = UINT32_MAX;
+
+    std::string _names;
+    std::vector<Entry> _entries;
+    std::vector<Slot> _slots;
+};
+
+} // namespace internal
+
+// A fixed set of allowed tokens, each mapped to a value of type T. The table is
+// indexed once when the choices are defined, so a lookup during parsing is a
+// hash and a short probe of a contiguous array, with no allocations.
+template <class T>
+class Choices : public internal::ChoiceTable {
+public:
+    Choices(std::initializer_list<std::pair<std::string_view, T>> choices)
+    {
+        _values.reserve(choices.size());
+        for (const auto& [name, value] : choices) {
+            add(name);
+            _values.push_back(Entry{value});
+        }
+        index();
+    }
+
+    [[nodiscard]] const T* find(std::string_view token) const
+    {
+        auto index = indexOf(token);
+        if (index == std::string_view::npos) {
+            return nullptr;
+        }
+        return &_values[index].value;
+    }
+
+    // Name of the first choice with the given value, or a null view
+    [[nodiscard]] std::string_view nameOf(const T& value) const
+    {
+        for (size_t i = 0; i < _values.size(); i++) {
+            if (_values[i].value == value) {
+                return name(i);
+            }
+        }
+        return {};
+    }
+
+private:
+    // Not a plain vector of T, so that choices of bool can be found by
+    // address too
+    struct Entry {
+        T value;
+    };
+
+    std::vector<Entry> _values;
+};
+
+} // namespace arg
@@ -0,0 +1,52 @@
+#pragma once
+
+// arg is header-only by default. Define ARG_SEPARATE_COMPILATION (linking
+// against the arg_core target does that) to keep the non-template parts of
+// the library out of the headers: they are then compiled once into arg_core,
+// and including arg only costs the declarations.
+#if defined(ARG_SEPARATE_COMPILATION)
+#define ARG_DECL
+#else
+#define ARG_DECL inline
+#endif
+
+// arg reports mistakes in the command line as err::Error records. Exceptions
+// are only thrown for mistakes in the program itself, such as a constraint
+// that names an unknown option. Built without exceptions (-fno-exceptions,
+// or with ARG_NO_EXCEPTIONS defined), arg prints those and aborts instead.
+// arg_core must be built in the same mode as the code that uses it.
+#if !defined(ARG_NO_EXCEPTIONS) && (defined(__cpp_exceptions) || \
+    defined(__EXCEPTIONS) || defined(_CPPUNWIND))
+#define ARG_EXCEPTIONS
+#endif
+
+#include <concepts>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace arg::internal {
+
+// Anything parse can take arguments from
+template <class R>
+concept Range = requires (R& range) {
+    std::begin(range);
+    { *std::begin(range) } -> std::convertible_to<std::string_view>;
+    std::end(range);
+};
+
+[[noreturn]] inline void logicError(std::string_view message)
+{
+#if defined(ARG_EXCEPTIONS)
+    throw std::logic_error{std::string{message}};
+#else
+    std::fprintf(stderr, "arg: %.*s\n",
+        static_cast<int>(message.size()), message.data());
+    std::abort();
+#endif
+}
+
+} // namespace arg::internal
@@ -0,0 +1,186 @@
+#pragma once
+
+#include "arg/numbers.hpp"
+
+#include <concepts>
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace arg {
+
+// Converter<T> turns a command-line token into a value of type T without going
+// through iostreams. Specialize it for your own types:
+//
+//     template <>
+//     struct arg::Converter<Point> {
+//         bool operator()(std::string_view input, Point& point) const;
+//     };
+//
+// Types without a converter fall back to operator>>.
+template <class T, class = void>
+struct Converter {};
+
+template <class T>
+concept HasConverter = requires(std::string_view input, T& value) {
+    { Converter<T>{}(input, value) } -> std::convertible_to<bool>;
+};
+
+namespace internal {
+
+template <class T>
+concept CharType =
+    std::same_as<T, char> ||
+    std::same_as<T, signed char> ||
+    std::same_as<T, unsigned char> ||
+    std::same_as<T, wchar_t> ||
+    std::same_as<T, char8_t> ||
+    std::same_as<T, char16_t> ||
+    std::same_as<T, char32_t>;
+
+template <class T>
+concept Integer =
+    std::integral<T> && !std::same_as<T, bool> && !CharType<T>;
+
+// std::chrono::duration and std::filesystem::path are matched by shape, so
+// that their headers are only needed by code that uses them.
+template <class T>
+concept Duration =
+    requires (const T& duration) {
+        typename T::rep;
+        typename T::period;
+        T::period::num;
+        T::period::den;
+        duration.count();
+    } &&
+    std::constructible_from<T, typename T::rep>;
+
+template <class T>
+concept PathLike =
+    requires {
+        typename T::value_type;
+        typename T::string_type;
+        T::preferred_separator;
+    } &&
+    std::constructible_from<T, std::string_view>;
+
+// Read-only stream buffer over a token, so that the operator>> fallback does
+// not have to copy it
+class ViewBuffer : public std::streambuf {
+public:
+    explicit ViewBuffer(std::string_view view)
+    {
+        auto* data = const_cast<char*>(view.data());
+        setg(data, data, data + view.size());
+    }
+};
+
+} // namespace internal
+
+template <>
+struct Converter<std::string> {
+    bool operator()(std::string_view input, std::string& value) const
+    {
+        value.assign(input);
+        return true;
+    }
+};
+
+template <internal::PathLike T>
+struct Converter<T> {
+    bool operator()(std::string_view input, T& value) const
+    {
+        value = T{input};
+        return true;
+    }
+};
+
+template <>
+struct Converter<char> {
+    bool operator()(std::string_view input, char& value) const
+    {
+        if (input.size() != 1) {
+            return false;
+        }
+        value = input.front();
+        return true;
+    }
+};
+
+template <>
+struct Converter<bool> {
+    bool operator()(std::string_view input, bool& value) const
+    {
+        if (input == "1" || input == "true") {
+            value = true;
+            return true;
+        }
+        if (input == "0" || input == "false") {
+            value = false;
+            return true;
+        }
+        return false;
+    }
+};
+
+template <internal::Integer T>
+struct Converter<T> {
+    bool operator()(std::string_view input, T& value) const
+    {
+        return internal::fromChars(input, value);
+    }
+};
+
+template <std::floating_point T>
+struct Converter<T> {
+    bool operator()(std::string_view input, T& value) const
+    {
+        return internal::fromChars(input, value);
+    }
+};
+
+// Durations are written as numbers followed by units: "250ms", "1.5h",
+// "1h30m". A number without a unit is taken in the units of the duration
+// itself. Integer durations reject values that cannot be represented exactly.
+template <internal::Duration T>
+struct Converter<T> {
+    bool operator()(std::string_view input, T& value) const
+    {
+        auto ticks = typename T::rep{};
+        if (!internal::parseDuration<typename T::rep, typename T::period>(
+                input, ticks)) {
+            return false;
+        }
+        value = T{ticks};
+        return true;
+    }
+};
+
+namespace internal {
+
+template <class T>
+concept Streamable = requires(std::istream& input, T& value) {
+    input >> value;
+};
+
+} // namespace internal
+
+template <class T>
+bool read(std::string_view input, T& value)
+{
+    if constexpr (HasConverter<T>) {
+        return Converter<T>{}(input, value);
+    } else if constexpr (std::is_enum_v<T> && !internal::Streamable<T>) {
+        // Enumerations without operator>> are only read through choices
+        return false;
+    } else {
+        auto buffer = internal::ViewBuffer{input};
+        auto stream = std::istream{&buffer};
+        stream >> value;
+        return !!stream;
+    }
+}
+
+} // namespace arg
@@ -0,0 +1,17 @@
+#pragma once
+
+// The parts of arg needed to define and parse options, without the optional
+// value types and the struct binding. Together with the arg_core target this
+// keeps the cost of including arg down to the declarations.
+
+#include <arg/adapters.hpp>
+#include <arg/arguments.hpp>
+#include <arg/argv.hpp>
+#include <arg/choices.hpp>
+#include <arg/converters.hpp>
+#include <arg/errors.hpp>
+#include <arg/flagset.hpp>
+#include <arg/formatters.hpp>
+#include <arg/parser.hpp>
+#include <arg/registry.hpp>
+#include <arg/static.hpp>
@@ -1,17 +1,29 @@
 #pragma once
 
-#include <ostream>
-#include <stdexcept>
+#include "arg/config.hpp"
+
+#include <cstddef>
+#include <iosfwd>
+#include <optional>
 #include <string>
-#include <type_traits>
-#include <typeinfo>
 #include <variant>
 
 namespace arg::err {
 
+// For a list option, value is the element that could not be read, and
+// element is its position in the list. For a value that is not valid UTF-8,
+// offset is the position of the first invalid byte.
 struct InvalidValueGiven {
     std::string keys;
     std::string value;
+    std::optional<size_t> element;
+    std::optional<size_t> offset;
+};
+
+struct InvalidChoice {
+    std::string keys;
+    std::string value;
+    std::string choices;
 };
 
 struct RequiredOptionNotSet {
@@ -31,38 +43,53 @@ struct UnexpectedOptionValueGiven {
     std::string value;
 };
 
+struct FileNotReadable {
+    std::string path;
+};
+
+struct MutuallyExclusiveOptions {
+    std::string keys;
+};
+
+struct OneOfOptionsRequired {
+    std::string keys;
+};
+
+struct MissingDependency {
+    std::string key;
+    std::string dependency;
+};
+
+struct UnterminatedQuote {
+    std::string commandLine;
+    size_t offset = 0;
+};
+
+// A help key given as key=section, for a section that no option is in
+struct UnknownHelpSection {
+    std::string section;
+    std::string sections;
+};
+
 using Error = std::variant<
     InvalidValueGiven,
+    InvalidChoice,
     RequiredOptionNotSet,
     RequiredOptionValueNotGiven,
     UnexpectedArgument,
-    UnexpectedOptionValueGiven
+    UnexpectedOptionValueGiven,
+    FileNotReadable,
+    MutuallyExclusiveOptions,
+    OneOfOptionsRequired,
+    MissingDependency,
+    UnterminatedQuote,
+    UnknownHelpSection
 >;
 
-inline void print(std::ostream& output, const Error& error)
-{
-    std::visit([&output] (auto&& arg) {
-        using T = std::decay_t<decltype(arg)>;
-        if constexpr (std::is_same<T, InvalidValueGiven>()) {
-            output << "invalid value for option " << arg.keys <<
-                ": " << arg.value << "\n";
-        } else if constexpr (std::is_same<T, RequiredOptionNotSet>()) {
-            output << "required option (" << arg.keys << ") is not set\n";
-        } else if constexpr (std::is_same<T, RequiredOptionValueNotGiven>()) {
-            output << "option " << arg.key <<
-                " requires a value, but it was not provied\n";
-        } else if constexpr (std::is_same<T, UnexpectedArgument>()) {
-            output << "unexpected argument: " << arg.argument << "\n";
-        } else if constexpr (std::is_same<T, UnexpectedOptionValueGiven>()) {
-            output << "option " << arg.key <<
-                " does not require a value, but " << arg.value <<
-                " was provided\n";
-        } else {
-            throw std::logic_error{
-                "cannot print an error of type " +
-                    std::string{typeid(arg).name()}};
-        }
-    }, error);
-}
+ARG_DECL void print(std::ostream& output, const Error& error);
 
 } // namespace arg::err
+
+#if !defined(ARG_SEPARATE_COMPILATION)
+#include "arg/impl/errors.ipp"
+#endif
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "arg/config.hpp"
+#include "arg/impl/tokenizer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <span>
+#include <string_view>
+
+namespace arg {
+
+class Parser;
+
+// One step of a parse. Keys and values are views into the arguments being
+// parsed, so an event is only valid while they are.
+struct Event {
+    enum class Kind : uint8_t {
+        // An option that takes no value. index is the option's position
+        // among the parser's options, in the order they were attached.
+        Flag,
+        // An option with its value. index is as for Flag.
+        Option,
+        // A positional argument. index is the position of the argument
+        // that takes it.
+        Argument,
+        // A positional argument past the last one the parser has
+        Unexpected,
+        // One of the help keys. Given as key=value, value is the section
+        // of the help asked for.
+        Help,
+        // An option that takes a value was the last argument
+        MissingValue,
+        // An option that takes no value was given one with key=value
+        UnexpectedValue,
+    };
+
+    // How the key was written: on its own, as key=value, or as a character
+    // of a pack, in which case key is that character alone
+    enum class Form : uint8_t {
+        Separate,
+        Joined,
+        Packed,
+    };
+
+    Kind kind = Kind::Unexpected;
+    Form form = Form::Separate;
+    uint32_t index = 0;
+    std::string_view key;
+    std::string_view value;
+};
+
+// Reads the arguments as a stream of events, without storing any values.
+// Parser::parse consumes the same stream to fill the handles; tools that
+// only dispatch or forward options can read it directly:
+//
+//     for (const auto& event : parser.events(args)) {
+//         if (event.kind == arg::Event::Kind::Option) {
+//             forward(event.key, event.value);
+//         }
+//     }
+//
+// Reading events does not allocate. Required options are not checked, as
+// that needs the whole stream.
+class EventReader {
+public:
+    class Iterator {
+    public:
+        using value_type = Event;
+        using difference_type = std::ptrdiff_t;
+
+        const Event& operator*() const
+        {
+            return _event;
+        }
+
+        const Event* operator->() const
+        {
+            return &_event;
+        }
+
+        Iterator& operator++()
+        {
+            _done = !_reader->next(_event);
+            return *this;
+        }
+
+        void operator++(int)
+        {
+            ++*this;
+        }
+
+        bool operator==(std::default_sentinel_t) const
+        {
+            return _done;
+        }
+
+    private:
+        friend class EventReader;
+
+        explicit Iterator(EventReader* reader)
+            : _reader(reader)
+        {
+            ++*this;
+        }
+
+        EventReader* _reader;
+        Event _event;
+        bool _done = false;
+    };
+
+    // The parser and the arguments must outlive the reader
+    ARG_DECL EventReader(
+        const Parser& parser, std::span<const std::string_view> args);
+
+    // Reads the next event. Returns false when there are no more.
+    ARG_DECL bool next(Event& event);
+
+    Iterator begin()
+    {
+        return Iterator{this};
+    }
+
+    std::default_sentinel_t end() const
+    {
+        return {};
+    }
+
+private:
+    friend class Parser;
+
+    const Parser& _parser;
+    std::span<const std::string_view> _args;
+    internal::TokenizerConfig _tokenizer;
+    internal::KeyIndex _index;
+    size_t _next = 0;
+    size_t _position = 0;
+    bool _optionsEnded = false;
+
+    // The keys of a pack that are not reported yet, and what follows them
+    std::string_view _pack;
+    std::string_view _packValue;
+};
+
+} // namespace arg
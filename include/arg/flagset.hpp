@@ -0,0 +1,565 @@
+#pragma once
+
+#include "arg/adapters.hpp"
+#include "arg/config.hpp"
+#include "arg/text.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace arg {
+
+// A dense set of bits, one per flag of a FlagSet. Operations on two sets work
+// a word at a time; bits past the end of the shorter set count as clear.
+// Iterating visits the positions of the set bits, in order.
+class FlagBits {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const size_t*;
+        using reference = size_t;
+
+        Iterator() = default;
+
+        size_t operator*() const
+        {
+            return _bit;
+        }
+
+        Iterator& operator++()
+        {
+            _bit = _bits->next(_bit + 1);
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        friend bool operator==(const Iterator&, const Iterator&) = default;
+
+    private:
+        friend class FlagBits;
+
+        Iterator(const FlagBits* bits, size_t bit)
+            : _bits(bits)
+            , _bit(bit)
+        { }
+
+        const FlagBits* _bits = nullptr;
+        size_t _bit = 0;
+    };
+
+    FlagBits() = default;
+
+    explicit FlagBits(size_t size)
+        : _words((size + 63) / 64)
+        , _size(size)
+    { }
+
+    [[nodiscard]] size_t size() const
+    {
+        return _size;
+    }
+
+    void resize(size_t size)
+    {
+        _words.resize((size + 63) / 64);
+        if (size < _size && size % 64 != 0) {
+            _words.back() &= (uint64_t{1} << (size % 64)) - 1;
+        }
+        _size = size;
+    }
+
+    [[nodiscard]] bool test(size_t bit) const
+    {
+        return (_words[bit / 64] >> (bit % 64)) & 1;
+    }
+
+    bool operator[](size_t bit) const
+    {
+        return test(bit);
+    }
+
+    void set(size_t bit, bool value = true)
+    {
+        const auto mask = uint64_t{1} << (bit % 64);
+        if (value) {
+            _words[bit / 64] |= mask;
+        } else {
+            _words[bit / 64] &= ~mask;
+        }
+    }
+
+    void clear()
+    {
+        std::fill(_words.begin(), _words.end(), 0);
+    }
+
+    [[nodiscard]] size_t count() const
+    {
+        size_t count = 0;
+        for (auto word : _words) {
+            count += static_cast<size_t>(std::popcount(word));
+        }
+        return count;
+    }
+
+    [[nodiscard]] bool none() const
+    {
+        return std::all_of(
+            _words.begin(), _words.end(), [] (uint64_t w) { return w == 0; });
+    }
+
+    // Whether every bit set in other is set here
+    [[nodiscard]] bool includes(const FlagBits& other) const
+    {
+        for (size_t i = 0; i < other._words.size(); i++) {
+            if ((other._words[i] & ~word(i)) != 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Whether any bit is set in both
+    [[nodiscard]] bool intersects(const FlagBits& other) const
+    {
+        const auto words = std::min(_words.size(), other._words.size());
+        for (size_t i = 0; i < words; i++) {
+            if ((_words[i] & other._words[i]) != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    friend FlagBits operator&(const FlagBits& lhs, const FlagBits& rhs)
+    {
+        return combine(
+            lhs, rhs, [] (uint64_t a, uint64_t b) { return a & b; });
+    }
+
+    friend FlagBits operator|(const FlagBits& lhs, const FlagBits& rhs)
+    {
+        return combine(
+            lhs, rhs, [] (uint64_t a, uint64_t b) { return a | b; });
+    }
+
+    // The bits that differ
+    friend FlagBits operator^(const FlagBits& lhs, const FlagBits& rhs)
+    {
+        return combine(
+            lhs, rhs, [] (uint64_t a, uint64_t b) { return a ^ b; });
+    }
+
+    // The bits of lhs that are not set in rhs
+    friend FlagBits operator-(const FlagBits& lhs, const FlagBits& rhs)
+    {
+        return combine(
+            lhs, rhs, [] (uint64_t a, uint64_t b) { return a & ~b; });
+    }
+
+    friend bool operator==(const FlagBits& lhs, const FlagBits& rhs)
+    {
+        const auto words = std::max(lhs._words.size(), rhs._words.size());
+        for (size_t i = 0; i < words; i++) {
+            if (lhs.word(i) != rhs.word(i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] Iterator begin() const
+    {
+        return Iterator{this, next(0)};
+    }
+
+    [[nodiscard]] Iterator end() const
+    {
+        return Iterator{this, _size};
+    }
+
+private:
+    [[nodiscard]] uint64_t word(size_t index) const
+    {
+        return index < _words.size() ? _words[index] : 0;
+    }
+
+    // Position of the first set bit at or after bit, or size()
+    [[nodiscard]] size_t next(size_t bit) const
+    {
+        if (bit >= _size) {
+            return _size;
+        }
+        auto index = bit / 64;
+        auto rest = _words[index] & (~uint64_t{0} << (bit % 64));
+        while (rest == 0) {
+            if (++index == _words.size()) {
+                return _size;
+            }
+            rest = _words[index];
+        }
+        return index * 64 + static_cast<size_t>(std::countr_zero(rest));
+    }
+
+    template <class Op>
+    static FlagBits combine(const FlagBits& lhs, const FlagBits& rhs, Op op)
+    {
+        auto result = FlagBits{std::max(lhs._size, rhs._size)};
+        for (size_t i = 0; i < result._words.size(); i++) {
+            result._words[i] = op(lhs.word(i), rhs.word(i));
+        }
+        return result;
+    }
+
+    std::vector<uint64_t> _words;
+    size_t _size = 0;
+};
+
+namespace internal {
+
+struct FlagSetData {
+    struct Info {
+        std::span<const std::string_view> keys;
+        std::string_view help;
+        std::string_view section;
+    };
+
+    FlagBits bits;
+    std::vector<Info> flags;
+};
+
+class FlagSetAdapter;
+class FlagSetOptions;
+
+} // namespace internal
+
+// Flags whose values are bits of one FlagBits, rather than a bool each.
+// Reading a flag is a single bit test, and whole sets of flags can be
+// checked, compared and iterated a word at a time:
+//
+//     auto features = arg::FlagSet{};
+//     auto fast = parser.flag(features).keys("--fast");
+//     auto safe = parser.flag(features).keys("--safe");
+//     const auto both = features.mask({fast.bit(), safe.bit()});
+//     parser.parse(argc, argv);
+//
+//     if (features.all(both)) { ... }
+//     for (size_t bit : features) { ... }
+class FlagSet {
+public:
+    // One flag of the set. Reads through a member go through its own
+    // pointer to the set; keeping only bit() is enough to read the set.
+    class Member {
+    public:
+        template <class... Args>
+        requires (sizeof...(Args) > 0)
+        Member keys(Args&&... args)
+        {
+            info().keys = internal::internKeys(std::forward<Args>(args)...);
+            internal::schemaChanged();
+            return *this;
+        }
+
+        [[nodiscard]] std::span<const std::string_view> keys() const
+        {
+            return info().keys;
+        }
+
+        Member help(std::string_view s)
+        {
+            info().help = internal::textPool().intern(s);
+            internal::schemaChanged();
+            return *this;
+        }
+
+        [[nodiscard]] std::string_view help() const
+        {
+            return info().help;
+        }
+
+        Member section(std::string_view s)
+        {
+            info().section = internal::textPool().intern(s);
+            internal::schemaChanged();
+            return *this;
+        }
+
+        [[nodiscard]] std::string_view section() const
+        {
+            return info().section;
+        }
+
+        [[nodiscard]] size_t bit() const
+        {
+            return _bit;
+        }
+
+        operator bool() const
+        {
+            return _data->bits.test(_bit);
+        }
+
+    private:
+        friend class FlagSet;
+
+        Member(std::shared_ptr<internal::FlagSetData> data, size_t bit)
+            : _data(std::move(data))
+            , _bit(bit)
+        { }
+
+        [[nodiscard]] internal::FlagSetData::Info& info() const
+        {
+            return _data->flags[_bit];
+        }
+
+        std::shared_ptr<internal::FlagSetData> _data;
+        size_t _bit;
+    };
+
+    [[nodiscard]] size_t size() const
+    {
+        return _data->bits.size();
+    }
+
+    [[nodiscard]] bool test(size_t bit) const
+    {
+        return _data->bits.test(bit);
+    }
+
+    bool operator[](size_t bit) const
+    {
+        return test(bit);
+    }
+
+    void set(size_t bit, bool value = true)
+    {
+        _data->bits.set(bit, value);
+    }
+
+    [[nodiscard]] const FlagBits& bits() const
+    {
+        return _data->bits;
+    }
+
+    // A mask of the given flags, the size of the set
+    [[nodiscard]] FlagBits mask(std::initializer_list<size_t> flags) const
+    {
+        auto mask = FlagBits{size()};
+        for (auto bit : flags) {
+            mask.set(bit);
+        }
+        return mask;
+    }
+
+    [[nodiscard]] bool all(const FlagBits& mask) const
+    {
+        return _data->bits.includes(mask);
+    }
+
+    [[nodiscard]] bool any(const FlagBits& mask) const
+    {
+        return _data->bits.intersects(mask);
+    }
+
+    [[nodiscard]] size_t count() const
+    {
+        return _data->bits.count();
+    }
+
+    // Flags that are set in one of the two, but not in both
+    [[nodiscard]] FlagBits diff(const FlagBits& other) const
+    {
+        return _data->bits ^ other;
+    }
+
+    [[nodiscard]] FlagBits diff(const FlagSet& other) const
+    {
+        return diff(other.bits());
+    }
+
+    [[nodiscard]] FlagBits::Iterator begin() const
+    {
+        return _data->bits.begin();
+    }
+
+    [[nodiscard]] FlagBits::Iterator end() const
+    {
+        return _data->bits.end();
+    }
+
+private:
+    friend class Parser;
+
+    Member add()
+    {
+        auto bit = _data->flags.size();
+        _data->flags.emplace_back();
+        _data->bits.resize(bit + 1);
+        return Member{_data, bit};
+    }
+
+    std::shared_ptr<internal::FlagSetData> _data =
+        std::make_shared<internal::FlagSetData>();
+};
+
+namespace internal {
+
+// Connects one flag of a FlagSet to a parser. The flag's value is its bit;
+// the adapter only knows where that is. These live in a FlagSetOptions,
+// which keeps the set alive.
+class FlagSetAdapter : public KeyAdapter {
+public:
+    FlagSetAdapter(FlagSetData& data, size_t bit)
+        : _data(&data)
+        , _bit(bit)
+    { }
+
+    [[nodiscard]] bool hasArgument() const override
+    {
+        return false;
+    }
+
+    [[nodiscard]] bool isRequired() const override
+    {
+        return false;
+    }
+
+    [[nodiscard]] bool isSet() const override
+    {
+        return _data->bits.test(_bit);
+    }
+
+    void raise() override
+    {
+        _data->bits.set(_bit);
+    }
+
+    [[nodiscard]] std::string_view valueType() const override
+    {
+        return "flag";
+    }
+
+    bool save(BlobWriter& writer) const override
+    {
+        writer.put(isSet());
+        return true;
+    }
+
+    bool load(BlobReader& reader) override
+    {
+        bool value = false;
+        if (!reader.get(value)) {
+            return false;
+        }
+        _data->bits.set(_bit, value);
+        return true;
+    }
+
+    bool check(BlobReader& reader) const override
+    {
+        bool value = false;
+        return reader.get(value);
+    }
+
+    bool saveCurrent(BlobWriter& writer) const override
+    {
+        return save(writer);
+    }
+
+    bool addValue(std::string_view) override
+    {
+        logicError("FlagSetAdapter's addValue must not be called");
+    }
+
+    [[nodiscard]] size_t valueCount() const override
+    {
+        return isSet() ? 1 : 0;
+    }
+
+    bool formatValue(size_t, std::string&) const override
+    {
+        logicError("FlagSetAdapter's formatValue must not be called");
+    }
+
+    [[nodiscard]] std::span<const std::string_view> keys() const override
+    {
+        return _data->flags[_bit].keys;
+    }
+
+    [[nodiscard]] std::string_view metavar() const override
+    {
+        return "";
+    }
+
+    [[nodiscard]] std::string_view help() const override
+    {
+        return _data->flags[_bit].help;
+    }
+
+    [[nodiscard]] std::string_view section() const override
+    {
+        return _data->flags[_bit].section;
+    }
+
+    [[nodiscard]] bool multi() const override
+    {
+        return false;
+    }
+
+    [[nodiscard]] std::vector<std::string_view> choices() const override
+    {
+        return {};
+    }
+
+private:
+    FlagSetData* _data;
+    size_t _bit;
+};
+
+// The flags of one FlagSet in one parser. A parser holds one of these per
+// set, rather than an allocation and a reference to the set per flag.
+class FlagSetOptions {
+public:
+    explicit FlagSetOptions(std::shared_ptr<FlagSetData> data)
+        : _data(std::move(data))
+    { }
+
+    [[nodiscard]] const FlagSetData* data() const
+    {
+        return _data.get();
+    }
+
+    // Adapters stay in place as more are added
+    KeyAdapter* add(size_t bit)
+    {
+        return &_flags.emplace_back(*_data, bit);
+    }
+
+private:
+    std::shared_ptr<FlagSetData> _data;
+    std::deque<FlagSetAdapter> _flags;
+};
+
+} // namespace internal
+
+} // namespace arg
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "arg/choices.hpp"
+#include "arg/converters.hpp"
+#include "arg/numbers.hpp"
+
+#include <concepts>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <type_traits>
+
+namespace arg {
+
+// Formatter<T> is the counterpart of Converter<T>: it appends the text of a
+// value to a string, such that the converter reads back the same value.
+// Specialize it for your own types:
+//
+//     template <>
+//     struct arg::Formatter<Point> {
+//         void operator()(const Point& point, std::string& output) const;
+//     };
+//
+// Types without a formatter fall back to operator<<.
+template <class T, class = void>
+struct Formatter {};
+
+template <class T>
+concept HasFormatter = requires(const T& value, std::string& output) {
+    Formatter<T>{}(value, output);
+};
+
+template <>
+struct Formatter<std::string> {
+    void operator()(const std::string& value, std::string& output) const
+    {
+        output += value;
+    }
+};
+
+template <internal::PathLike T>
+struct Formatter<T> {
+    void operator()(const T& value, std::string& output) const
+    {
+        output += value.string();
+    }
+};
+
+template <>
+struct Formatter<char> {
+    void operator()(char value, std::string& output) const
+    {
+        output += value;
+    }
+};
+
+template <>
+struct Formatter<bool> {
+    void operator()(bool value, std::string& output) const
+    {
+        output += value ? "true" : "false";
+    }
+};
+
+template <class T>
+requires internal::Integer<T> || std::floating_point<T>
+struct Formatter<T> {
+    void operator()(T value, std::string& output) const
+    {
+        internal::toChars(value, output);
+    }
+};
+
+// A duration is written as a plain number of its own ticks, which the
+// converter reads back exactly
+template <internal::Duration T>
+struct Formatter<T> {
+    void operator()(const T& value, std::string& output) const
+    {
+        Formatter<typename T::rep>{}(value.count(), output);
+    }
+};
+
+namespace internal {
+
+template <class T>
+concept OutputStreamable = requires(std::ostream& output, const T& value) {
+    output << value;
+};
+
+// Stream buffer that appends to a string, so that the operator<< fallback
+// writes straight into the output
+class AppendBuffer : public std::streambuf {
+public:
+    explicit AppendBuffer(std::string& output)
+        : _output(output)
+    { }
+
+protected:
+    int_type overflow(int_type c) override
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            _output += traits_type::to_char_type(c);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    std::streamsize xsputn(const char* data, std::streamsize size) override
+    {
+        _output.append(data, static_cast<size_t>(size));
+        return size;
+    }
+
+private:
+    std::string& _output;
+};
+
+} // namespace internal
+
+template <class T>
+bool write(const T& value, std::string& output)
+{
+    if constexpr (HasFormatter<T>) {
+        Formatter<T>{}(value, output);
+        return true;
+    } else if constexpr (internal::OutputStreamable<T>) {
+        auto buffer = internal::AppendBuffer{output};
+        auto stream = std::ostream{&buffer};
+        stream << value;
+        return !!stream;
+    } else {
+        return false;
+    }
+}
+
+namespace internal {
+
+// Writes a value of an option that may have choices: those are written by
+// name, as they are read
+template <class T>
+bool format(const T& value, const Choices<T>* choices, std::string& output)
+{
+    if (choices) {
+        if constexpr (std::equality_comparable<T>) {
+            if (auto name = choices->nameOf(value); name.data()) {
+                output += name;
+                return true;
+            }
+        }
+        return false;
+    }
+    return write(value, output);
+}
+
+} // namespace internal
+
+} // namespace arg
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "arg/blob.hpp"
+#include "arg/impl/file.hpp"
+#include "arg/impl/hash.hpp"
+#include "arg/parser.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace arg {
+
+namespace internal {
+
+struct CacheHeader {
+    char magic[4] = {'a', 'r', 'g', 'c'};
+    uint32_t version = 1;
+    uint64_t key = 0;
+    uint64_t size = 0;
+    uint64_t checksum = 0;
+};
+
+inline uint64_t checksum(std::string_view payload)
+{
+    auto hash = Hash{};
+    hash.addBytes(payload);
+    return hash.value();
+}
+
+// Maps the cache file, checks its header against the expected key and hands
+// the payload to load as a view of the mapping
+template <class Load>
+bool readCache(const std::string& path, uint64_t key, Load&& load)
+{
+    auto check = [&] (std::string_view file) {
+        auto header = CacheHeader{};
+        if (file.size() < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, file.data(), sizeof(header));
+        auto payload = file.substr(sizeof(header));
+        return std::memcmp(header.magic, CacheHeader{}.magic, 4) == 0 &&
+            header.version == CacheHeader{}.version &&
+            header.key == key &&
+            header.size == payload.size() &&
+            header.checksum == checksum(payload) &&
+            load(payload);
+    };
+
+    auto file = FileMapping{path};
+    return file && check(file.data());
+}
+
+// Identifies the build of the running program by the inode, size and
+// modification time of its file, where /proc/self/exe has them
+inline uint64_t programIdentity()
+{
+    static const uint64_t identity = [] {
+        auto hash = Hash{};
+#if defined(__linux__)
+        struct stat status {};
+        if (::stat("/proc/self/exe", &status) == 0) {
+            hash.add(static_cast<uint64_t>(status.st_ino));
+            hash.add(static_cast<uint64_t>(status.st_size));
+            hash.add(static_cast<uint64_t>(status.st_mtim.tv_sec));
+            hash.add(static_cast<uint64_t>(status.st_mtim.tv_nsec));
+        }
+#endif
+        return hash.value();
+    }();
+    return identity;
+}
+
+// Concurrent runs never see a partially written cache, see replaceFile
+inline void writeCache(
+    const std::string& path, uint64_t key, std::string_view payload)
+{
+    auto header = CacheHeader{};
+    header.key = key;
+    header.size = payload.size();
+    header.checksum = checksum(payload);
+
+    auto file = std::string{};
+    file.reserve(sizeof(header) + payload.size());
+    file.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.append(payload);
+    replaceFile(path, file);
+}
+
+} // namespace internal
+
+ARG_DECL void Parser::cacheInput(std::string_view data)
+{
+    auto hash = internal::Hash{};
+    hash.add(_cacheInputs);
+    hash.add(data);
+    _cacheInputs = hash.value();
+}
+
+ARG_DECL uint64_t Parser::cacheKey(std::span<const std::string_view> args) const
+{
+    auto hash = internal::Hash{};
+    hash.add(static_cast<uint64_t>(internal::CacheHeader{}.version));
+    hash.add(static_cast<uint64_t>(sizeof(void*)));
+    hash.add(internal::programIdentity());
+    hash.add(config.cacheVersion);
+
+    hash.add(static_cast<uint64_t>(config.allowKeyValueSyntax));
+    hash.add(config.keyValueSeparator);
+    hash.add(static_cast<uint64_t>(config.allowArgumentPacking));
+    hash.add(config.packPrefix);
+    hash.add(static_cast<uint64_t>(config.allowUnspecifiedArguments));
+    hash.add(config.endOfOptions);
+
+    // Everything that decides the result of a parse is part of the key: the
+    // kind of each option (a list's type names its delimiter), the layout of
+    // its type, the checks on it, and the value it holds before the parse,
+    // which is its default.
+    // Options that cannot be stored turn the cache off when it is saved.
+    auto defaults = internal::BlobWriter{};
+    hash.add(static_cast<uint64_t>(_options.size()));
+    for (const auto& option : _options) {
+        hash.add(option->valueType());
+        hash.add(option->valueLayout());
+        hash.add(static_cast<uint64_t>(option->hasArgument()));
+        hash.add(static_cast<uint64_t>(option->multi()));
+        hash.add(static_cast<uint64_t>(option->isRequired()));
+        hash.add(static_cast<uint64_t>(option->requiresUtf8()));
+        option->saveCurrent(defaults);
+        hash.add(static_cast<uint64_t>(option->keys().size()));
+        for (const auto& key : option->keys()) {
+            hash.add(key);
+        }
+        hash.add(static_cast<uint64_t>(option->choices().size()));
+        for (auto choice : option->choices()) {
+            hash.add(choice);
+        }
+    }
+    hash.add(static_cast<uint64_t>(_arguments.size()));
+    for (const auto& argument : _arguments) {
+        hash.add(argument->valueType());
+        hash.add(argument->valueLayout());
+        hash.add(static_cast<uint64_t>(argument->multi()));
+        hash.add(static_cast<uint64_t>(argument->isRequired()));
+        hash.add(static_cast<uint64_t>(argument->requiresUtf8()));
+        argument->saveCurrent(defaults);
+        for (auto choice : argument->choices()) {
+            hash.add(choice);
+        }
+    }
+    for (const auto& key : _helpKeys) {
+        hash.add(key);
+    }
+    hash.add(static_cast<uint64_t>(_constraints.size()));
+    for (const auto& constraint : _constraints) {
+        hash.add(static_cast<uint64_t>(constraint.kind));
+        hash.add(static_cast<uint64_t>(constraint.keys.size()));
+        for (auto key : constraint.keys) {
+            hash.add(key);
+        }
+    }
+
+    hash.add(std::string_view{defaults.data()});
+
+    hash.add(_cacheInputs);
+    hash.add(static_cast<uint64_t>(args.size()));
+    for (auto arg : args) {
+        hash.add(arg);
+    }
+    return hash.value();
+}
+
+// The payload is checked whole before anything is loaded, so that a payload
+// that does not fit leaves every value as it was for the parse that follows
+ARG_DECL bool Parser::loadCache(uint64_t key)
+{
+    return internal::readCache(config.cacheFile, key, [this] (auto payload) {
+        auto checker = internal::BlobReader{payload};
+        for (const auto& option : _options) {
+            if (!option->check(checker)) {
+                return false;
+            }
+        }
+        for (const auto& argument : _arguments) {
+            if (!argument->check(checker)) {
+                return false;
+            }
+        }
+        auto leftovers = std::vector<std::string>{};
+        if (!checker.get(leftovers) || !checker.empty()) {
+            return false;
+        }
+
+        auto reader = internal::BlobReader{payload};
+        for (const auto& option : _options) {
+            option->load(reader);
+        }
+        for (const auto& argument : _arguments) {
+            argument->load(reader);
+        }
+        _leftovers = std::move(leftovers);
+        return true;
+    });
+}
+
+ARG_DECL void Parser::saveCache(uint64_t key) const
+{
+    auto writer = internal::BlobWriter{};
+    for (const auto& option : _options) {
+        if (!option->save(writer)) {
+            return;
+        }
+    }
+    for (const auto& argument : _arguments) {
+        if (!argument->save(writer)) {
+            return;
+        }
+    }
+    writer.put(_leftovers);
+    internal::writeCache(config.cacheFile, key, writer.data());
+}
+
+} // namespace arg
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "arg/errors.hpp"
+
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <variant>
+
+namespace arg::err {
+
+ARG_DECL void print(std::ostream& output, const Error& error)
+{
+    std::visit([&output] (auto&& arg) {
+        using T = std::decay_t<decltype(arg)>;
+        if constexpr (std::is_same<T, InvalidValueGiven>()) {
+            output << "invalid value for option " << arg.keys <<
+                ": " << arg.value;
+            if (arg.element) {
+                output << " (element " << *arg.element << ")";
+            }
+            if (arg.offset) {
+                output << " (invalid UTF-8 at byte " << *arg.offset << ")";
+            }
+            output << "\n";
+        } else if constexpr (std::is_same<T, InvalidChoice>()) {
+            output << "invalid value for option " << arg.keys <<
+                ": " << arg.value << " (choose from " << arg.choices << ")\n";
+        } else if constexpr (std::is_same<T, RequiredOptionNotSet>()) {
+            output << "required option (" << arg.keys << ") is not set\n";
+        } else if constexpr (std::is_same<T, RequiredOptionValueNotGiven>()) {
+            output << "option " << arg.key <<
+                " requires a value, but it was not provied\n";
+        } else if constexpr (std::is_same<T, UnexpectedArgument>()) {
+            output << "unexpected argument: " << arg.argument << "\n";
+        } else if constexpr (std::is_same<T, UnexpectedOptionValueGiven>()) {
+            output << "option " << arg.key <<
+                " does not require a value, but " << arg.value <<
+                " was provided\n";
+        } else if constexpr (std::is_same<T, FileNotReadable>()) {
+            output << "cannot read file: " << arg.path << "\n";
+        } else if constexpr (std::is_same<T, MutuallyExclusiveOptions>()) {
+            output << "options " << arg.keys <<
+                " cannot be used together\n";
+        } else if constexpr (std::is_same<T, OneOfOptionsRequired>()) {
+            output << "one of the options " << arg.keys << " is required\n";
+        } else if constexpr (std::is_same<T, MissingDependency>()) {
+            output << "option " << arg.key << " requires " <<
+                arg.dependency << "\n";
+        } else if constexpr (std::is_same<T, UnterminatedQuote>()) {
+            output << "unterminated quote at offset " << arg.offset <<
+                " of command line: " << arg.commandLine << "\n";
+        } else if constexpr (std::is_same<T, UnknownHelpSection>()) {
+            output << "unknown help section: " << arg.section <<
+                " (choose from " << arg.sections << ")\n";
+        } else {
+            static_assert(sizeof(T) == 0, "err::print misses an error type");
+        }
+    }, error);
+}
+
+} // namespace arg::err
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "arg/events.hpp"
+#include "arg/parser.hpp"
+
+#include <span>
+#include <string_view>
+
+namespace arg {
+
+ARG_DECL EventReader::EventReader(
+        const Parser& parser, std::span<const std::string_view> args)
+    : _parser(parser)
+    , _args(args)
+    , _tokenizer{
+        parser.config.allowArgumentPacking ?
+            std::string_view{parser.config.packPrefix} : std::string_view{},
+        parser.config.allowKeyValueSyntax ?
+            std::string_view{parser.config.keyValueSeparator} :
+            std::string_view{}}
+    , _index(
+        parser._options,
+        parser._helpKeys,
+        _tokenizer.packPrefix,
+        parser.currentImage())
+{ }
+
+ARG_DECL bool EventReader::next(Event& event)
+{
+    event = Event{};
+
+    if (!_pack.empty()) {
+        const auto* entry = _index.packed(_pack.front());
+        event.form = Event::Form::Packed;
+        event.index = entry->id;
+        event.key = _pack.substr(0, 1);
+        _pack.remove_prefix(1);
+        if (!_pack.empty() || !entry->option->hasArgument()) {
+            event.kind = Event::Kind::Flag;
+        } else if (!_packValue.empty()) {
+            event.kind = Event::Kind::Option;
+            event.value = _packValue;
+        } else if (_next < _args.size()) {
+            event.kind = Event::Kind::Option;
+            event.value = _args[_next++];
+        } else {
+            event.kind = Event::Kind::MissingValue;
+        }
+        return true;
+    }
+
+    if (_next == _args.size()) {
+        return false;
+    }
+
+    // Tokens are classified as they are reached, so values of options are
+    // never looked at
+    const auto token = internal::classify(_args[_next++], _tokenizer);
+
+    if (!_optionsEnded) {
+        const auto& endOfOptions = _parser.config.endOfOptions;
+        const auto* entry = _index.find(token.text);
+
+        if (!endOfOptions.empty() && token.text == endOfOptions && !entry) {
+            _optionsEnded = true;
+            return next(event);
+        }
+
+        if (entry) {
+            event.key = token.text;
+            if (entry->help) {
+                event.kind = Event::Kind::Help;
+                return true;
+            }
+            event.index = entry->id;
+            if (!entry->option->hasArgument()) {
+                event.kind = Event::Kind::Flag;
+            } else if (_next == _args.size()) {
+                event.kind = Event::Kind::MissingValue;
+            } else {
+                event.kind = Event::Kind::Option;
+                event.value = _args[_next++];
+            }
+            return true;
+        }
+
+        if (token.kind == internal::Token::Kind::KeyValue) {
+            const auto* entry = _index.find(token.key());
+            if (entry && entry->help) {
+                event.kind = Event::Kind::Help;
+                event.form = Event::Form::Joined;
+                event.key = token.key();
+                event.value = token.value();
+                return true;
+            }
+            if (entry) {
+                event.kind = entry->option->hasArgument() ?
+                    Event::Kind::Option : Event::Kind::UnexpectedValue;
+                event.form = Event::Form::Joined;
+                event.index = entry->id;
+                event.key = token.key();
+                event.value = token.value();
+                return true;
+            }
+        }
+
+        if (token.prefixed) {
+            // A pack is a run of flags, optionally ending with an option that
+            // takes the rest of the token, or the next token, as its value
+            auto keys = token.text.substr(_tokenizer.packPrefix.size());
+            size_t length = 0;
+            const internal::KeyIndex::Entry* last = nullptr;
+            while (length < keys.size()) {
+                last = _index.packed(keys[length]);
+                if (!last) {
+                    break;
+                }
+                length++;
+                if (last->option->hasArgument()) {
+                    break;
+                }
+            }
+
+            if (last && length > 0) {
+                _pack = keys.substr(0, length);
+                _packValue = keys.substr(length);
+                return next(event);
+            }
+        }
+    }
+
+    const auto& arguments = _parser._arguments;
+    event.value = token.text;
+    if (_position < arguments.size()) {
+        event.kind = Event::Kind::Argument;
+        event.index = static_cast<uint32_t>(_position);
+        if (!arguments[_position]->multi()) {
+            _position++;
+        }
+    } else {
+        event.kind = Event::Kind::Unexpected;
+    }
+    return true;
+}
+
+ARG_DECL EventReader Parser::events(
+    std::span<const std::string_view> args) const
+{
+    return EventReader{*this, args};
+}
+
+} // namespace arg
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ARG_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+namespace arg::internal {
+
+// How the contents of a mapping will be read, passed on to the kernel
+enum class FileAccess : uint8_t {
+    Normal,
+    Sequential,
+    Random,
+    WillNeed,
+};
+
+// A whole file, mapped read-only where mmap is available and read into
+// memory elsewhere. Mappings of the same file share their pages with every
+// other process that maps it. Empty if the file cannot be read; error()
+// tells that apart from an empty file.
+class FileMapping {
+public:
+    FileMapping() = default;
+
+    explicit FileMapping(
+        const std::string& path, FileAccess access = FileAccess::Normal)
+    {
+#if defined(ARG_MMAP)
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            _error = errno;
+            return;
+        }
+        struct stat status {};
+        if (::fstat(fd, &status) != 0) {
+            _error = errno;
+            ::close(fd);
+            return;
+        }
+        if (status.st_size <= 0) {
+            ::close(fd);
+            return;
+        }
+        auto size = static_cast<size_t>(status.st_size);
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            _error = errno;
+            ::close(fd);
+            return;
+        }
+        ::close(fd);
+        _data = static_cast<const char*>(data);
+        _size = size;
+        advise(access);
+#else
+        (void)access;
+        errno = 0;
+        auto input = std::ifstream{path, std::ios::binary};
+        if (!input) {
+            _error = errno != 0 ? errno : ENOENT;
+            return;
+        }
+        _contents.assign(
+            std::istreambuf_iterator<char>{input},
+            std::istreambuf_iterator<char>{});
+        if (input.bad()) {
+            _error = EIO;
+            _contents.clear();
+        }
+#endif
+    }
+
+    explicit operator bool() const
+    {
+        return !data().empty();
+    }
+
+    // The errno of the call that failed to open, inspect or map the file,
+    // or 0 if it was read, even if it is empty
+    [[nodiscard]] int error() const
+    {
+        return _error;
+    }
+
+#if defined(ARG_MMAP)
+    FileMapping(FileMapping&& other) noexcept
+        : _data(std::exchange(other._data, nullptr))
+        , _size(std::exchange(other._size, 0))
+        , _error(std::exchange(other._error, 0))
+    { }
+
+    FileMapping& operator=(FileMapping&& other) noexcept
+    {
+        if (this != &other) {
+            unmap();
+            _data = std::exchange(other._data, nullptr);
+            _size = std::exchange(other._size, 0);
+            _error = std::exchange(other._error, 0);
+        }
+        return *this;
+    }
+
+    ~FileMapping()
+    {
+        unmap();
+    }
+
+    [[nodiscard]] std::string_view data() const
+    {
+        return {_data, _size};
+    }
+
+private:
+    void advise(FileAccess access)
+    {
+        // Only a hint, so failures are ignored
+        switch (access) {
+            case FileAccess::Normal:
+                break;
+            case FileAccess::Sequential:
+                ::posix_madvise(
+                    const_cast<char*>(_data), _size, POSIX_MADV_SEQUENTIAL);
+                break;
+            case FileAccess::Random:
+                ::posix_madvise(
+                    const_cast<char*>(_data), _size, POSIX_MADV_RANDOM);
+                break;
+            case FileAccess::WillNeed:
+                ::posix_madvise(
+                    const_cast<char*>(_data), _size, POSIX_MADV_WILLNEED);
+                break;
+        }
+    }
+
+    void unmap()
+    {
+        if (_data) {
+            ::munmap(const_cast<char*>(_data), _size);
+        }
+    }
+
+    const char* _data = nullptr;
+    size_t _size = 0;
+#else
+    [[nodiscard]] std::string_view data() const
+    {
+        return _contents;
+    }
+
+private:
+    std::string _contents;
+#endif
+    int _error = 0;
+};
+
+// Writes the file next to its final location and renames it into place, so
+// that concurrent readers never see a partially written file. Returns false
+// if the file could not be written.
+inline bool replaceFile(const std::string& path, std::string_view data)
+{
+    auto temporary = path + ".tmp";
+#if defined(ARG_MMAP)
+    temporary += std::to_string(::getpid());
+#endif
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written =
+        std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    written = std::fclose(file) == 0 && written;
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace arg::internal
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace arg::internal {
+
+// 64-bit FNV-1a. Hashes here only have to tell schemas and runs apart, not
+// resist deliberate collisions: cache and image files are as trusted as the
+// binary.
+class Hash {
+public:
+    void add(std::string_view data)
+    {
+        add(static_cast<uint64_t>(data.size()));
+        addBytes(data);
+    }
+
+    void add(uint64_t value)
+    {
+        addBytes(std::string_view{
+            reinterpret_cast<const char*>(&value), sizeof(value)});
+    }
+
+    void addBytes(std::string_view data)
+    {
+        for (unsigned char c : data) {
+            _value = (_value ^ c) * 0x100000001b3ull;
+        }
+    }
+
+    [[nodiscard]] uint64_t value() const
+    {
+        return _value;
+    }
+
+private:
+    uint64_t _value = 0xcbf29ce484222325ull;
+};
+
+// 32-bit FNV-1a, for hash tables stored in files
+inline uint32_t hash32(std::string_view data)
+{
+    uint32_t value = 0x811c9dc5u;
+    for (unsigned char c : data) {
+        value = (value ^ c) * 0x01000193u;
+    }
+    return value;
+}
+
+} // namespace arg::internal
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "arg/config.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace arg::internal {
+
+// Help text, rendered once and kept until the options change. Sections are
+// ranges of the text, so printing one of them renders nothing.
+struct HelpCache {
+    struct Section {
+        std::string_view name;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    [[nodiscard]] const Section* find(std::string_view name) const
+    {
+        auto it = std::find_if(
+            sections.begin(), sections.end(),
+            [name] (const Section& section) { return section.name == name; });
+        return it != sections.end() ? &*it : nullptr;
+    }
+
+    // What the text was rendered for
+    size_t options = 0;
+    size_t arguments = 0;
+    size_t width = 0;
+    std::string programName;
+    uint64_t generation = 0;
+
+    std::string text;
+    size_t usageSize = 0;
+    std::vector<Section> sections;
+};
+
+// Width of the terminal on standard output, else $COLUMNS, else 80
+ARG_DECL size_t terminalWidth();
+
+// Columns that text takes on a terminal, counting UTF-8 sequences as one
+inline size_t columns(std::string_view text)
+{
+    return static_cast<size_t>(std::count_if(
+        text.begin(), text.end(), [] (char c) {
+            return (static_cast<unsigned char>(c) & 0xc0) != 0x80;
+        }));
+}
+
+// Appends a space and word to a line that ends at column, or a new line
+// indented by indent if the word would cross width. Returns the new column.
+inline size_t appendWord(
+    std::string& output,
+    std::string_view word,
+    size_t column,
+    size_t indent,
+    size_t width)
+{
+    const auto size = columns(word);
+    if (column > indent && column + 1 + size > width) {
+        output += '\n';
+        output.append(indent, ' ');
+        column = indent;
+    } else {
+        output += ' ';
+        column++;
+    }
+    output += word;
+    return column + size;
+}
+
+// Appends text at column, which is where wrapped lines are indented to.
+// Line breaks in text are kept. Each line is found in one pass and appended
+// whole.
+inline void appendWrapped(
+    std::string& output, std::string_view text, size_t column, size_t width)
+{
+    const auto indent = column;
+    const auto room = width > indent ? width - indent : 1;
+    while (!text.empty() && text.front() == ' ') {
+        text.remove_prefix(1);
+    }
+    for (;;) {
+        size_t used = 0;
+        size_t end = 0;
+        size_t lastSpace = std::string_view::npos;
+        while (end < text.size() && text[end] != '\n') {
+            const auto c = static_cast<unsigned char>(text[end]);
+            if ((c & 0xc0) != 0x80) {
+                if (used == room) {
+                    break;
+                }
+                used++;
+            }
+            if (c == ' ') {
+                lastSpace = end;
+            }
+            end++;
+        }
+
+        // A line that is too long breaks at its last space, or after its
+        // first word if that alone does not fit
+        auto cut = end;
+        if (end < text.size() && text[end] != '\n' && text[end] != ' ') {
+            cut = lastSpace != std::string_view::npos ?
+                lastSpace : std::min(text.find(' ', end), text.size());
+        }
+        auto line = text.substr(0, cut);
+        while (!line.empty() && line.back() == ' ') {
+            line.remove_suffix(1);
+        }
+        output += line;
+
+        text.remove_prefix(cut);
+        if (!text.empty() && text.front() == '\n') {
+            text.remove_prefix(1);
+        } else {
+            while (!text.empty() && text.front() == ' ') {
+                text.remove_prefix(1);
+            }
+        }
+        if (text.empty()) {
+            return;
+        }
+        output += '\n';
+        output.append(indent, ' ');
+    }
+}
+
+} // namespace arg::internal
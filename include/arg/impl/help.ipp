@@ -0,0 +1,282 @@
+#pragma once
+
+#include "arg/impl/help.hpp"
+#include "arg/impl/image.hpp"
+#include "arg/parser.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+namespace arg {
+
+namespace internal {
+
+ARG_DECL size_t terminalWidth()
+{
+#if defined(TIOCGWINSZ)
+    struct winsize size {};
+    if (::isatty(STDOUT_FILENO) &&
+            ::ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 &&
+            size.ws_col > 0) {
+        return size.ws_col;
+    }
+#endif
+    if (const char* columns = std::getenv("COLUMNS")) {
+        size_t width = 0;
+        auto end = columns + std::string_view{columns}.size();
+        auto [ptr, error] = std::from_chars(columns, end, width);
+        if (error == std::errc{} && ptr == end && width > 0) {
+            return width;
+        }
+    }
+    return 80;
+}
+
+} // namespace internal
+
+ARG_DECL void Parser::printHelp() const
+{
+    printHelp(std::cout);
+}
+
+ARG_DECL void Parser::printHelp(
+    std::ostream& output, std::string_view section) const
+{
+    auto write = [&output] (std::string_view text) {
+        output.write(text.data(), static_cast<std::streamsize>(text.size()));
+    };
+
+    // An image keeps the full help as it was rendered when the image was
+    // made, which is only good for the same width and program name
+    const auto width = helpWidth();
+    if (const auto* image = currentImage(); image && section.empty() &&
+            image->header().helpWidth == width) {
+        const auto help = image->help();
+        const auto usage = std::string_view{"usage: "};
+        const auto rest = help.substr(std::min(
+            help.size(), usage.size() + _programName.size()));
+        if (help.starts_with(usage) &&
+                help.substr(usage.size()).starts_with(_programName) &&
+                (rest.starts_with(' ') || rest.starts_with('\n'))) {
+            write(help);
+            return;
+        }
+    }
+
+    const auto& help = helpCache(width);
+    const auto* found = section.empty() ? nullptr : help.find(section);
+    if (!found) {
+        write(help.text);
+        return;
+    }
+    auto text = std::string{};
+    text.reserve(help.usageSize + found->end - found->begin);
+    text.append(help.text, 0, help.usageSize);
+    text.append(help.text, found->begin, found->end - found->begin);
+    write(text);
+}
+
+ARG_DECL size_t Parser::helpWidth() const
+{
+    return config.helpWidth > 0 ? config.helpWidth : internal::terminalWidth();
+}
+
+ARG_DECL const internal::HelpCache& Parser::helpCache(size_t width) const
+{
+    if (_help && _help->options == _options.size() &&
+            _help->arguments == _arguments.size() &&
+            _help->width == width && _help->programName == _programName &&
+            _help->generation == internal::schemaGeneration()) {
+        return *_help;
+    }
+
+    if (!_help) {
+        _help = std::make_unique<internal::HelpCache>();
+    }
+    auto& help = *_help;
+    help.options = _options.size();
+    help.arguments = _arguments.size();
+    help.width = width;
+    help.programName = _programName;
+    help.generation = internal::schemaGeneration();
+    help.sections.clear();
+
+    auto& text = help.text;
+    text.clear();
+    text += "usage: ";
+    text += _programName;
+
+    // The synopsis wraps under its first item, unless the program name
+    // leaves too little room for that
+    auto column = internal::columns(text);
+    const auto indent = column + 1 <= width / 3 ? column + 1 : 4;
+    auto item = std::string{};
+    auto addItem = [&] (
+            bool multi, bool required, std::string_view key,
+            std::string_view metavar) {
+        item.clear();
+        if (multi) {
+            item += "{ ";
+        } else if (!required) {
+            item += "[ ";
+        }
+        item += key;
+        if (!key.empty() && !metavar.empty()) {
+            item += ' ';
+        }
+        item += metavar;
+        if (multi) {
+            item += " }";
+        } else if (!required) {
+            item += " ]";
+        }
+        column = internal::appendWord(text, item, column, indent, width);
+    };
+    for (const auto& option : _options) {
+        auto keys = option->keys();
+        addItem(
+            option->multi(),
+            option->isRequired(),
+            keys.empty() ? std::string_view{"<no key>"} : keys.front(),
+            option->hasArgument() ? option->metavar() : std::string_view{});
+    }
+    for (const auto& argument : _arguments) {
+        addItem(
+            argument->multi(), argument->isRequired(), {}, argument->metavar());
+    }
+    text += '\n';
+    help.usageSize = text.size();
+
+    // Widths of the key column, computed once for all entries
+    auto optionWidth = [] (const KeyAdapter& option) {
+        size_t size = 2;
+        for (const auto& key : option.keys()) {
+            size += internal::columns(key) + 2;
+        }
+        if (!option.keys().empty()) {
+            size -= 2;
+        }
+        if (option.hasArgument()) {
+            size += 1 + internal::columns(option.metavar());
+        }
+        return size;
+    };
+    std::vector<size_t> widths;
+    widths.reserve(_options.size());
+    size_t widest = 0;
+    for (const auto& option : _options) {
+        widths.push_back(optionWidth(*option));
+        widest = std::max(widest, widths.back());
+    }
+    for (const auto& argument : _arguments) {
+        widest = std::max(widest, 2 + internal::columns(argument->metavar()));
+    }
+    const auto helpColumn =
+        std::min(widest + 2, std::max<size_t>(width * 2 / 5, 8));
+
+    auto addHelp = [&] (size_t used, std::string_view helpText) {
+        if (!helpText.empty()) {
+            if (used + 2 > helpColumn) {
+                text += '\n';
+                text.append(helpColumn, ' ');
+            } else {
+                text.append(helpColumn - used, ' ');
+            }
+            internal::appendWrapped(text, helpText, helpColumn, width);
+        }
+        text += '\n';
+    };
+
+    // Options grouped by section, in the order the sections first appear
+    std::unordered_map<std::string_view, uint32_t> sectionIds;
+    std::vector<std::string_view> names;
+    std::vector<std::vector<uint32_t>> members;
+    sectionIds.emplace(std::string_view{}, 0);
+    names.emplace_back();
+    members.emplace_back();
+    for (size_t i = 0; i < _options.size(); i++) {
+        auto [it, added] = sectionIds.try_emplace(
+            _options[i]->section(), static_cast<uint32_t>(names.size()));
+        if (added) {
+            names.push_back(it->first);
+            members.emplace_back();
+        }
+        members[it->second].push_back(static_cast<uint32_t>(i));
+    }
+
+    for (size_t s = 0; s < names.size(); s++) {
+        if (members[s].empty()) {
+            continue;
+        }
+        const auto begin = text.size();
+        text += '\n';
+        if (names[s].empty()) {
+            text += "Options:\n";
+        } else {
+            text += names[s];
+            text += " options:\n";
+        }
+        for (auto i : members[s]) {
+            const auto& option = *_options[i];
+            text += "  ";
+            bool first = true;
+            for (const auto& key : option.keys()) {
+                if (!first) {
+                    text += ", ";
+                }
+                text += key;
+                first = false;
+            }
+            if (option.hasArgument()) {
+                text += ' ';
+                text += option.metavar();
+            }
+            addHelp(widths[i], option.help());
+        }
+        help.sections.push_back(
+            internal::HelpCache::Section{names[s], begin, text.size()});
+    }
+
+    if (!_arguments.empty()) {
+        text += "\nPositional arguments:\n";
+        for (const auto& argument : _arguments) {
+            text += "  ";
+            text += argument->metavar();
+            addHelp(
+                2 + internal::columns(argument->metavar()), argument->help());
+        }
+    }
+    return help;
+}
+
+ARG_DECL err::Error Parser::unknownHelpSection(std::string_view section) const
+{
+    auto names = std::string{};
+    for (const auto& known : helpCache(helpWidth()).sections) {
+        if (!known.name.empty()) {
+            if (!names.empty()) {
+                names += ", ";
+            }
+            names += known.name;
+        }
+    }
+    return err::UnknownHelpSection{std::string{section}, std::move(names)};
+}
+
+} // namespace arg
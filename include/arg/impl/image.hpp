@@ -0,0 +1,174 @@
+#pragma once
+
+#include "arg/impl/file.hpp"
+#include "arg/impl/hash.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <utility>
+
+namespace arg::internal {
+
+// Layout of a parser image, see Parser::image. Offsets are from the start of
+// the image, so that it works at any address; numbers are in native byte
+// order. The header is followed by the key table, the pack table, the keys
+// themselves and the help text.
+struct ImageHeader {
+    char magic[4] = {'a', 'r', 'g', 'i'};
+    uint32_t version = 1;
+    uint64_t fingerprint = 0;
+    uint32_t size = 0;
+    uint32_t options = 0;
+    uint32_t arguments = 0;
+    uint32_t helpKeys = 0;
+    uint32_t packPrefix = 0;
+    uint32_t slotCount = 0;
+    uint32_t slots = 0;
+    uint32_t pack = 0;
+    uint32_t help = 0;
+    uint32_t helpSize = 0;
+    uint32_t helpWidth = 0;
+    uint32_t reserved = 0;
+};
+
+// An entry of the open-addressing key table
+struct ImageSlot {
+    uint32_t hash = 0;
+    uint32_t key = 0;
+    uint32_t keySize = 0;
+    uint32_t id = 0;
+};
+
+// A parser image in memory: either a file mapping it owns, or bytes that
+// someone else keeps alive. Lookups read the image in place, and never
+// allocate.
+class ParserImage {
+public:
+    // Ids of keys that are not options
+    static constexpr uint32_t none = UINT32_MAX;
+    static constexpr uint32_t helpKey = UINT32_MAX - 1;
+
+    explicit ParserImage(std::string_view data)
+        : _data(data)
+    {
+        _valid = check();
+    }
+
+    explicit ParserImage(FileMapping mapping)
+        : _mapping(std::move(mapping))
+        , _data(_mapping.data())
+    {
+        _valid = check();
+    }
+
+    ParserImage(const ParserImage&) = delete;
+    ParserImage& operator=(const ParserImage&) = delete;
+
+    [[nodiscard]] bool valid() const
+    {
+        return _valid;
+    }
+
+    [[nodiscard]] const ImageHeader& header() const
+    {
+        return _header;
+    }
+
+    // Id of the option that key belongs to, helpKey, or none
+    [[nodiscard]] uint32_t find(std::string_view key) const
+    {
+        const auto hash = hash32(key);
+        const auto mask = _header.slotCount - 1;
+        for (auto i = hash & mask; ; i = (i + 1) & mask) {
+            const auto slot = this->slot(i);
+            if (slot.id == none) {
+                return none;
+            }
+            if (slot.hash == hash &&
+                    _data.substr(slot.key, slot.keySize) == key) {
+                return slot.id;
+            }
+        }
+    }
+
+    // Id of the option that the pack prefix and c make a key of, or none
+    [[nodiscard]] uint32_t packed(char c) const
+    {
+        return read<uint32_t>(
+            _header.pack + sizeof(uint32_t) * static_cast<unsigned char>(c));
+    }
+
+    // The full help, as rendered for header().helpWidth columns
+    [[nodiscard]] std::string_view help() const
+    {
+        return _data.substr(_header.help, _header.helpSize);
+    }
+
+private:
+    // Images may sit at any alignment, for example in a char array linked
+    // into the program, so fields are copied out rather than cast to
+    template <class T>
+    [[nodiscard]] T read(uint64_t offset) const
+    {
+        T value;
+        std::memcpy(&value, _data.data() + offset, sizeof(T));
+        return value;
+    }
+
+    [[nodiscard]] ImageSlot slot(uint32_t index) const
+    {
+        return read<ImageSlot>(
+            _header.slots + uint64_t{sizeof(ImageSlot)} * index);
+    }
+
+    // Checks everything that lookups rely on, once, so that a damaged image
+    // is rejected instead of read out of bounds
+    [[nodiscard]] bool check()
+    {
+        if (_data.size() < sizeof(ImageHeader)) {
+            return false;
+        }
+        _header = read<ImageHeader>(0);
+        const auto size = uint64_t{_data.size()};
+        const auto within = [size] (uint64_t offset, uint64_t length) {
+            return offset <= size && length <= size - offset;
+        };
+        if (std::memcmp(_header.magic, ImageHeader{}.magic, 4) != 0 ||
+                _header.version != ImageHeader{}.version ||
+                _header.size != size ||
+                !std::has_single_bit(_header.slotCount) ||
+                !within(_header.slots,
+                    uint64_t{sizeof(ImageSlot)} * _header.slotCount) ||
+                !within(_header.pack, sizeof(uint32_t) * 256) ||
+                !within(_header.help, _header.helpSize)) {
+            return false;
+        }
+
+        bool hasEmptySlot = false;
+        for (uint32_t i = 0; i < _header.slotCount; i++) {
+            const auto slot = this->slot(i);
+            if (slot.id == none) {
+                hasEmptySlot = true;
+            } else if (!within(slot.key, slot.keySize) ||
+                    (slot.id >= _header.options && slot.id != helpKey)) {
+                return false;
+            }
+        }
+        for (int c = 0; c < 256; c++) {
+            auto id = packed(static_cast<char>(c));
+            if (id != none && id >= _header.options) {
+                return false;
+            }
+        }
+        return hasEmptySlot;
+    }
+
+    FileMapping _mapping;
+    std::string_view _data;
+    ImageHeader _header;
+    bool _valid = false;
+};
+
+} // namespace arg::internal
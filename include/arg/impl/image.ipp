@@ -0,0 +1,211 @@
+#pragma once
+
+#include "arg/impl/file.hpp"
+#include "arg/impl/hash.hpp"
+#include "arg/impl/image.hpp"
+#include "arg/parser.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace arg {
+
+ARG_DECL uint64_t Parser::imageFingerprint() const
+{
+    auto hash = internal::Hash{};
+    hash.add(static_cast<uint64_t>(internal::ImageHeader{}.version));
+    hash.add(config.allowArgumentPacking ?
+        std::string_view{config.packPrefix} : std::string_view{});
+
+    hash.add(static_cast<uint64_t>(_options.size()));
+    for (const auto& option : _options) {
+        hash.add(static_cast<uint64_t>(option->keys().size()));
+        for (const auto& key : option->keys()) {
+            hash.add(key);
+        }
+        hash.add(static_cast<uint64_t>(option->hasArgument()));
+        hash.add(static_cast<uint64_t>(option->multi()));
+        hash.add(static_cast<uint64_t>(option->isRequired()));
+        hash.add(option->metavar());
+        hash.add(option->help());
+        hash.add(option->section());
+    }
+    hash.add(static_cast<uint64_t>(_arguments.size()));
+    for (const auto& argument : _arguments) {
+        hash.add(static_cast<uint64_t>(argument->multi()));
+        hash.add(static_cast<uint64_t>(argument->isRequired()));
+        hash.add(argument->metavar());
+        hash.add(argument->help());
+    }
+    hash.add(static_cast<uint64_t>(_helpKeys.size()));
+    for (const auto& key : _helpKeys) {
+        hash.add(key);
+    }
+    return hash.value();
+}
+
+ARG_DECL std::string Parser::image() const
+{
+    using internal::ParserImage;
+
+    const auto packPrefix = config.allowArgumentPacking ?
+        std::string_view{config.packPrefix} : std::string_view{};
+
+    // Keys in the order they first appear, each with its final meaning:
+    // the same precedence as KeyIndex, with later definitions winning
+    std::vector<std::pair<std::string_view, uint32_t>> keys;
+    std::unordered_map<std::string_view, size_t> positions;
+    auto define = [&] (std::string_view key, uint32_t id) {
+        auto [it, added] = positions.try_emplace(key, keys.size());
+        if (added) {
+            keys.emplace_back(key, id);
+        } else {
+            keys[it->second].second = id;
+        }
+    };
+    for (size_t id = 0; id < _options.size(); id++) {
+        for (const auto& key : _options[id]->keys()) {
+            define(key, static_cast<uint32_t>(id));
+        }
+    }
+    for (const auto& key : _helpKeys) {
+        define(key, ParserImage::helpKey);
+    }
+
+    const auto width = helpWidth();
+    const auto& help = helpCache(width).text;
+
+    size_t keyBytes = 0;
+    for (const auto& [key, id] : keys) {
+        keyBytes += key.size();
+    }
+
+    auto header = internal::ImageHeader{};
+    header.fingerprint = imageFingerprint();
+    header.options = static_cast<uint32_t>(_options.size());
+    header.arguments = static_cast<uint32_t>(_arguments.size());
+    header.helpKeys = static_cast<uint32_t>(_helpKeys.size());
+    header.packPrefix = internal::hash32(packPrefix);
+    // At most half of the slots are used, so probes stay short
+    header.slotCount = static_cast<uint32_t>(
+        std::bit_ceil(std::max<size_t>(8, 2 * keys.size())));
+    header.slots = sizeof(header);
+    header.pack = static_cast<uint32_t>(
+        header.slots + sizeof(internal::ImageSlot) * header.slotCount);
+    const auto keyOffset = header.pack + sizeof(uint32_t) * 256;
+    const auto size = keyOffset + keyBytes + help.size();
+    if (size > std::numeric_limits<uint32_t>::max()) {
+        internal::logicError("parser image does not fit in 4 GiB");
+    }
+    header.help = static_cast<uint32_t>(keyOffset + keyBytes);
+    header.helpSize = static_cast<uint32_t>(help.size());
+    header.helpWidth = static_cast<uint32_t>(width);
+    header.size = static_cast<uint32_t>(size);
+
+    auto slots = std::vector<internal::ImageSlot>(
+        header.slotCount, internal::ImageSlot{0, 0, 0, ParserImage::none});
+    auto pack = std::array<uint32_t, 256>{};
+    pack.fill(ParserImage::none);
+
+    auto image = std::string(size, '\0');
+    auto offset = keyOffset;
+    const auto mask = header.slotCount - 1;
+    for (const auto& [key, id] : keys) {
+        const auto slot = internal::ImageSlot{
+            internal::hash32(key),
+            static_cast<uint32_t>(offset),
+            static_cast<uint32_t>(key.size()),
+            id};
+        auto i = slot.hash & mask;
+        while (slots[i].id != ParserImage::none) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+        std::memcpy(image.data() + offset, key.data(), key.size());
+        offset += key.size();
+
+        if (id != ParserImage::helpKey && !packPrefix.empty() &&
+                key.size() == packPrefix.size() + 1 &&
+                key.starts_with(packPrefix)) {
+            pack[static_cast<unsigned char>(key.back())] = id;
+        }
+    }
+
+    std::memcpy(image.data(), &header, sizeof(header));
+    std::memcpy(image.data() + header.slots,
+        slots.data(), sizeof(internal::ImageSlot) * slots.size());
+    std::memcpy(image.data() + header.pack, pack.data(), sizeof(pack));
+    std::memcpy(image.data() + header.help, help.data(), help.size());
+    return image;
+}
+
+ARG_DECL bool Parser::saveImage(const std::string& path) const
+{
+    return internal::replaceFile(path, image());
+}
+
+ARG_DECL bool Parser::loadImage(const std::string& path)
+{
+    auto mapping = internal::FileMapping{path};
+    return mapping && adoptImage(
+        std::make_shared<const internal::ParserImage>(std::move(mapping)));
+}
+
+ARG_DECL bool Parser::useImage(std::string_view image)
+{
+    return adoptImage(std::make_shared<const internal::ParserImage>(image));
+}
+
+ARG_DECL bool Parser::adoptImage(
+    std::shared_ptr<const internal::ParserImage> image)
+{
+    const auto generation = internal::schemaGeneration();
+    if (!image->valid() || image->header().fingerprint != imageFingerprint()) {
+        return false;
+    }
+    _image = std::move(image);
+    _imageGeneration = generation;
+    return true;
+}
+
+ARG_DECL const internal::ParserImage* Parser::currentImage() const
+{
+    if (!_image) {
+        return nullptr;
+    }
+    const auto& header = _image->header();
+    const auto packPrefix = config.allowArgumentPacking ?
+        std::string_view{config.packPrefix} : std::string_view{};
+    bool matches =
+        header.options == _options.size() &&
+        header.arguments == _arguments.size() &&
+        header.helpKeys == _helpKeys.size() &&
+        header.packPrefix == internal::hash32(packPrefix);
+    if (!matches) {
+        return nullptr;
+    }
+
+    // A handle changed something since the last check; it may have been one
+    // of ours
+    const auto generation = internal::schemaGeneration();
+    if (generation != _imageGeneration) {
+        if (header.fingerprint != imageFingerprint()) {
+            _image.reset();
+            return nullptr;
+        }
+        _imageGeneration = generation;
+    }
+    return _image.get();
+}
+
+} // namespace arg
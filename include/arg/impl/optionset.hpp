@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace arg::internal {
+
+// A set of option ids, one bit per option
+class OptionSet {
+public:
+    explicit OptionSet(size_t size)
+        : _words((size + 63) / 64)
+    { }
+
+    void insert(size_t id)
+    {
+        _words[id / 64] |= uint64_t{1} << (id % 64);
+    }
+
+    [[nodiscard]] bool contains(size_t id) const
+    {
+        return (_words[id / 64] >> (id % 64)) & 1;
+    }
+
+private:
+    std::vector<uint64_t> _words;
+};
+
+} // namespace arg::internal
@@ -0,0 +1,492 @@
+#pragma once
+
+#include "arg/errors.hpp"
+#include "arg/events.hpp"
+#include "arg/impl/optionset.hpp"
+#include "arg/impl/shell.hpp"
+#include "arg/impl/simd.hpp"
+#include "arg/impl/tokenizer.hpp"
+#include "arg/parser.hpp"
+#include "arg/registry.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace arg {
+
+ARG_DECL void Parser::attachRegistered()
+{
+    // New registrations are prepended, so everything before the head seen
+    // last time is new. They are attached in the order they were linked.
+    auto* head = internal::registrations.load(std::memory_order_acquire);
+    std::vector<internal::Registration*> added;
+    for (auto* node = head; node != _registered; node = node->next()) {
+        added.push_back(node);
+    }
+    _options.reserve(_options.size() + added.size());
+    for (auto it = added.rbegin(); it != added.rend(); ++it) {
+        attach(std::make_unique<internal::RegisteredAdapter>(*it));
+    }
+    _registered = head;
+}
+
+ARG_DECL void Parser::parse(int argc, char** argv)
+{
+    if (argc > 0) {
+        _programName = std::filesystem::path{argv[0]}.filename().string();
+    }
+
+    std::vector<std::string_view> args;
+    for (int i = 1; i < argc; i++) {
+        args.emplace_back(argv[i]);
+    }
+    parseTokens(args);
+}
+
+ARG_DECL void Parser::parse(std::string_view commandLine)
+{
+    std::vector<std::string_view> args;
+    std::string scratch;
+    auto quote = internal::splitCommandLine(commandLine, args, scratch);
+    if (quote != std::string_view::npos) {
+        print(std::cerr, err::UnterminatedQuote{
+            std::string{commandLine}, quote});
+        printHelp(std::cerr);
+        std::exit(EXIT_FAILURE);
+    }
+    parseTokens(args);
+}
+
+ARG_DECL std::vector<err::Error> Parser::tryParse(std::string_view commandLine)
+{
+    std::vector<std::string_view> args;
+    std::string scratch;
+    auto quote = internal::splitCommandLine(commandLine, args, scratch);
+    if (quote != std::string_view::npos) {
+        return {err::UnterminatedQuote{std::string{commandLine}, quote}};
+    }
+    bool helpRequested = false;
+    return interpret(args, helpRequested);
+}
+
+ARG_DECL void Parser::parseTokens(std::span<const std::string_view> args)
+{
+    uint64_t key = 0;
+    if (!config.cacheFile.empty()) {
+        key = cacheKey(args);
+        if (loadCache(key)) {
+            return;
+        }
+    }
+
+    bool helpRequested = false;
+    auto errors = interpret(args, helpRequested);
+
+    if (!errors.empty()) {
+        for (const auto& error : errors) {
+            print(std::cerr, error);
+        }
+        printHelp(std::cerr);
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (helpRequested) {
+        printHelp(std::cout, _helpSection);
+        std::exit(EXIT_SUCCESS);
+    }
+
+    if (!config.cacheFile.empty()) {
+        saveCache(key);
+    }
+}
+
+ARG_DECL std::vector<err::Error> Parser::interpret(
+    std::span<const std::string_view> args, bool& helpRequested)
+{
+    std::vector<err::Error> errors;
+    _leftovers.clear();
+    _helpSection.clear();
+
+    const auto packPrefix = config.allowArgumentPacking ?
+        std::string_view{config.packPrefix} : std::string_view{};
+    auto keyOf = [&] (const Event& event) {
+        return event.form == Event::Form::Packed ?
+            std::string{packPrefix} + std::string{event.key} :
+            std::string{event.key};
+    };
+
+    auto reader = EventReader{*this, args};
+    auto given = internal::OptionSet{_options.size()};
+    for (auto event = Event{}; reader.next(event); ) {
+        switch (event.kind) {
+            case Event::Kind::Flag:
+                given.insert(event.index);
+                _options[event.index]->raise();
+                break;
+            case Event::Kind::Option: {
+                given.insert(event.index);
+                auto* option = _options[event.index];
+                auto offset = option->requiresUtf8() ?
+                    internal::simd::invalidUtf8(event.value) :
+                    std::string_view::npos;
+                if (offset == std::string_view::npos &&
+                        option->addValue(event.value)) {
+                    break;
+                }
+                auto keys = event.form == Event::Form::Separate ?
+                    option->keyString() : keyOf(event);
+                if (offset != std::string_view::npos) {
+                    errors.emplace_back(err::InvalidValueGiven{
+                        std::move(keys),
+                        std::string{event.value},
+                        std::nullopt,
+                        offset});
+                } else if (auto element = option->invalidElement()) {
+                    errors.emplace_back(err::InvalidValueGiven{
+                        std::move(keys),
+                        std::string{element->text},
+                        element->index,
+                        std::nullopt});
+                } else {
+                    errors.push_back(invalidValue(
+                        option->choices(), keys, event.value));
+                }
+                break;
+            }
+            case Event::Kind::Argument: {
+                auto* argument = _arguments[event.index].get();
+                auto offset = argument->requiresUtf8() ?
+                    internal::simd::invalidUtf8(event.value) :
+                    std::string_view::npos;
+                if (offset != std::string_view::npos) {
+                    errors.emplace_back(err::InvalidValueGiven{
+                        std::string{argument->metavar()},
+                        std::string{event.value},
+                        std::nullopt,
+                        offset});
+                } else if (!argument->addValue(event.value)) {
+                    errors.push_back(invalidValue(
+                        argument->choices(), argument->metavar(), event.value));
+                }
+                break;
+            }
+            case Event::Kind::Unexpected:
+                if (config.allowUnspecifiedArguments) {
+                    _leftovers.emplace_back(event.value);
+                } else {
+                    errors.emplace_back(
+                        err::UnexpectedArgument{std::string{event.value}});
+                }
+                break;
+            case Event::Kind::Help:
+                helpRequested = true;
+                _helpSection = event.value;
+                if (!event.value.empty() &&
+                        !helpCache(helpWidth()).find(event.value)) {
+                    errors.emplace_back(unknownHelpSection(event.value));
+                }
+                break;
+            case Event::Kind::MissingValue:
+                errors.emplace_back(
+                    err::RequiredOptionValueNotGiven{keyOf(event)});
+                break;
+            case Event::Kind::UnexpectedValue:
+                errors.emplace_back(err::UnexpectedOptionValueGiven{
+                    std::string{event.key}, std::string{event.value}});
+                break;
+        }
+    }
+
+    if (!helpRequested) {
+        checkConstraints(given, errors);
+        for (const auto& option : _options) {
+            if (option->isRequired() && !option->isSet()) {
+                errors.emplace_back(
+                    err::RequiredOptionNotSet{option->keyString()});
+            }
+        }
+        for (const auto& argument : _arguments) {
+            if (argument->isRequired() && !argument->isSet()) {
+                errors.emplace_back(
+                    err::RequiredOptionNotSet{std::string{argument->metavar()}});
+            }
+        }
+    }
+
+    return errors;
+}
+
+// Keys of options attached since the last call are indexed first. A key
+// that is still missing may have been set after its option was indexed, so
+// the index is rebuilt once before giving up. As in parsing, a later option
+// with the same key wins.
+ARG_DECL uint32_t Parser::optionId(std::string_view key)
+{
+    auto find = [this, key] {
+        for (; _optionIdsIndexed < _options.size(); _optionIdsIndexed++) {
+            for (auto optionKey : _options[_optionIdsIndexed]->keys()) {
+                _optionIds[optionKey] =
+                    static_cast<uint32_t>(_optionIdsIndexed);
+            }
+        }
+        return _optionIds.find(key);
+    };
+
+    auto it = find();
+    if (it == _optionIds.end()) {
+        _optionIds.clear();
+        _optionIdsIndexed = 0;
+        it = find();
+    }
+    if (it == _optionIds.end()) {
+        internal::logicError(
+            "constraint refers to an unknown option: " + std::string{key});
+    }
+    return it->second;
+}
+
+ARG_DECL void Parser::checkConstraints(
+    const internal::OptionSet& given, std::vector<err::Error>& errors) const
+{
+    auto join = [&] (const internal::Constraint& constraint, bool onlyGiven) {
+        std::string result;
+        for (size_t i = 0; i < constraint.keys.size(); i++) {
+            if (!onlyGiven || given.contains(constraint.ids[i])) {
+                if (!result.empty()) {
+                    result += ", ";
+                }
+                result += constraint.keys[i];
+            }
+        }
+        return result;
+    };
+
+    // Each constraint is checked by visiting its ids once. An option named
+    // by several keys of one constraint counts once; stamps tell which ids
+    // the current constraint has already counted, without clearing a set
+    // the size of the parser for every constraint.
+    auto stamps = std::vector<size_t>(
+        _constraints.empty() ? 0 : _options.size());
+    size_t stamp = 0;
+    for (const auto& constraint : _constraints) {
+        stamp++;
+        const auto& ids = constraint.ids;
+        switch (constraint.kind) {
+            case internal::Constraint::Kind::AtMostOne:
+            case internal::Constraint::Kind::ExactlyOne: {
+                size_t count = 0;
+                for (auto id : ids) {
+                    if (given.contains(id) && stamps[id] != stamp) {
+                        stamps[id] = stamp;
+                        count++;
+                    }
+                }
+                if (count > 1) {
+                    errors.emplace_back(
+                        err::MutuallyExclusiveOptions{join(constraint, true)});
+                } else if (count == 0 && constraint.kind ==
+                        internal::Constraint::Kind::ExactlyOne) {
+                    errors.emplace_back(
+                        err::OneOfOptionsRequired{join(constraint, false)});
+                }
+                break;
+            }
+            case internal::Constraint::Kind::Dependency:
+                if (!given.contains(ids.front())) {
+                    break;
+                }
+                for (size_t i = 1; i < ids.size(); i++) {
+                    if (!given.contains(ids[i])) {
+                        errors.emplace_back(err::MissingDependency{
+                            std::string{constraint.keys.front()},
+                            std::string{constraint.keys[i]}});
+                    }
+                }
+                break;
+        }
+    }
+}
+
+ARG_DECL Argv Parser::toArgv() const
+{
+    const auto packPrefix = config.allowArgumentPacking ?
+        std::string_view{config.packPrefix} : std::string_view{};
+    const auto separator = config.allowKeyValueSyntax ?
+        std::string_view{config.keyValueSeparator} : std::string_view{};
+    const auto index = internal::KeyIndex{
+        _options, _helpKeys, packPrefix, currentImage()};
+
+    auto argv = Argv{};
+    argv.token(_programName);
+
+    auto formatError = [] (std::string_view what) {
+        internal::logicError(
+            "toArgv: cannot format the value of " + std::string{what});
+    };
+
+    for (const auto& option : _options) {
+        auto count = option->valueCount();
+        if (count == 0 || option->keys().empty()) {
+            continue;
+        }
+        std::string_view key = option->keys().front();
+        for (const auto& other : option->keys()) {
+            if (other.size() < key.size()) {
+                key = other;
+            }
+        }
+
+        if (!option->hasArgument()) {
+            // Repeated single-character flags are packed: -vvv
+            bool packable = count > 1 && !packPrefix.empty() &&
+                key.size() == packPrefix.size() + 1 &&
+                key.starts_with(packPrefix);
+            if (packable) {
+                argv._buffer += key;
+                argv._buffer.append(count - 1, key.back());
+                auto packed =
+                    std::string_view{argv._buffer}.substr(argv._tokenStart);
+                if (!index.find(packed)) {
+                    argv.finishToken();
+                    continue;
+                }
+                argv._buffer.resize(argv._tokenStart);
+            }
+            for (size_t i = 0; i < count; i++) {
+                argv.token(key);
+            }
+            continue;
+        }
+
+        bool joined = !separator.empty() &&
+            key.find(separator) == std::string_view::npos;
+        for (size_t i = 0; i < count; i++) {
+            argv._buffer += key;
+            if (joined) {
+                argv._buffer += separator;
+            } else {
+                argv.finishToken();
+            }
+            if (!option->formatValue(i, argv._buffer)) {
+                formatError(option->keyString());
+            }
+            argv.finishToken();
+        }
+    }
+
+    // Positional values that would be read as keys go after the end of
+    // options marker, which is only written when it is needed
+    auto looksLikeKey = [&] (std::string_view token) {
+        if (token == config.endOfOptions || index.find(token)) {
+            return true;
+        }
+        if (!separator.empty()) {
+            auto split = token.find(separator);
+            if (split != std::string_view::npos) {
+                auto* entry = index.find(token.substr(0, split));
+                if (entry && entry->option) {
+                    return true;
+                }
+            }
+        }
+        return !packPrefix.empty() && token.size() > packPrefix.size() &&
+            token.starts_with(packPrefix) &&
+            index.packed(token[packPrefix.size()]);
+    };
+
+    auto firstPositional = argv._starts.size();
+    bool escape = false;
+    auto positional = [&] {
+        auto token = std::string_view{argv._buffer}.substr(argv._tokenStart);
+        escape = escape || looksLikeKey(token);
+        argv.finishToken();
+    };
+    for (const auto& argument : _arguments) {
+        for (size_t i = 0; i < argument->valueCount(); i++) {
+            if (!argument->formatValue(i, argv._buffer)) {
+                formatError(argument->metavar());
+            }
+            positional();
+        }
+    }
+    for (const auto& leftover : _leftovers) {
+        argv._buffer += leftover;
+        positional();
+    }
+
+    if (escape) {
+        if (config.endOfOptions.empty()) {
+            internal::logicError(
+                "toArgv: positional arguments look like keys, and there is "
+                "no end of options marker to separate them");
+        }
+        auto offset = firstPositional < argv._starts.size() ?
+            argv._starts[firstPositional] : argv._buffer.size();
+        auto marker = config.endOfOptions + '\0';
+        argv._buffer.insert(offset, marker);
+        for (size_t i = firstPositional; i < argv._starts.size(); i++) {
+            argv._starts[i] += marker.size();
+        }
+        argv._starts.insert(
+            argv._starts.begin() + static_cast<ptrdiff_t>(firstPositional),
+            offset);
+        argv._tokenStart = argv._buffer.size();
+    }
+
+    argv.finish();
+    return argv;
+}
+
+ARG_DECL err::Error Parser::invalidValue(
+    const std::vector<std::string_view>& choices,
+    std::string_view keys,
+    std::string_view value)
+{
+    if (choices.empty()) {
+        return err::InvalidValueGiven{
+            std::string{keys}, std::string{value}, std::nullopt, std::nullopt};
+    }
+
+    std::string list;
+    for (auto choice : choices) {
+        if (!list.empty()) {
+            list += ", ";
+        }
+        list += choice;
+    }
+    return err::InvalidChoice{
+        std::string{keys}, std::string{value}, std::move(list)};
+}
+
+ARG_DECL void printHelp()
+{
+    internal::globalParser().attachRegistered();
+    internal::globalParser().printHelp();
+}
+
+ARG_DECL void printHelp(std::ostream& output)
+{
+    internal::globalParser().attachRegistered();
+    internal::globalParser().printHelp(output);
+}
+
+ARG_DECL void parse(int argc, char** argv)
+{
+    internal::globalParser().attachRegistered();
+    internal::globalParser().parse(argc, argv);
+}
+
+ARG_DECL const std::vector<std::string>& leftovers()
+{
+    return internal::globalParser().leftovers();
+}
+
+} // namespace arg
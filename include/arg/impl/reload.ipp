@@ -0,0 +1,222 @@
+#pragma once
+
+#include "arg/reload.hpp"
+
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <climits>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace arg::internal {
+
+ARG_DECL bool readFile(const std::string& path, std::string& contents)
+{
+    auto input = std::ifstream{path, std::ios::binary};
+    if (!input) {
+        return false;
+    }
+    contents.assign(
+        std::istreambuf_iterator<char>{input}, std::istreambuf_iterator<char>{});
+    return !input.bad();
+}
+
+ARG_DECL std::vector<std::string_view> splitArgs(std::string_view text)
+{
+    auto isSpace = [] (char c) {
+        return std::isspace(static_cast<unsigned char>(c)) != 0;
+    };
+
+    std::vector<std::string_view> tokens;
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && isSpace(text[i])) {
+            i++;
+        }
+        if (i < text.size() && text[i] == '#') {
+            while (i < text.size() && text[i] != '\n') {
+                i++;
+            }
+            continue;
+        }
+        size_t start = i;
+        while (i < text.size() && !isSpace(text[i])) {
+            i++;
+        }
+        if (i > start) {
+            tokens.push_back(text.substr(start, i - start));
+        }
+    }
+    return tokens;
+}
+
+#if defined(__linux__)
+
+// The parent directory is watched rather than the file itself, because
+// editors and deployment tools usually replace a file instead of writing it
+// in place
+struct FileWatcher::State {
+    int inotify = -1;
+    int stop = -1;
+    std::thread thread;
+
+    ~State()
+    {
+        if (inotify >= 0) {
+            ::close(inotify);
+        }
+        if (stop >= 0) {
+            ::close(stop);
+        }
+    }
+};
+
+ARG_DECL FileWatcher::FileWatcher(
+        std::string path, std::function<void()> onChange)
+    : _state(std::make_unique<State>())
+{
+    auto file = std::filesystem::path{path};
+    auto directory = file.parent_path().empty() ?
+        std::filesystem::path{"."} : file.parent_path();
+    auto name = file.filename().string();
+
+    _state->inotify = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    _state->stop = ::eventfd(0, EFD_CLOEXEC);
+    if (_state->inotify < 0 || _state->stop < 0 ||
+            ::inotify_add_watch(
+                _state->inotify,
+                directory.c_str(),
+                IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        auto error = std::error_code{errno, std::generic_category()};
+#if defined(ARG_EXCEPTIONS)
+        throw std::system_error{error, "cannot watch " + path};
+#else
+        std::cerr << "cannot watch " << path << ": " << error.message() << "\n";
+        return;
+#endif
+    }
+
+    _state->thread = std::thread{
+        [state = _state.get(), name, onChange = std::move(onChange)] {
+            alignas(inotify_event) char buffer[sizeof(inotify_event) +
+                NAME_MAX + 1];
+            pollfd fds[] = {
+                {state->inotify, POLLIN, 0},
+                {state->stop, POLLIN, 0},
+            };
+            for (;;) {
+                if (::poll(fds, 2, -1) < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return;
+                }
+                if (fds[1].revents != 0) {
+                    return;
+                }
+
+                bool changed = false;
+                for (;;) {
+                    auto size = ::read(state->inotify, buffer, sizeof(buffer));
+                    if (size <= 0) {
+                        break;
+                    }
+                    for (ssize_t offset = 0; offset < size; ) {
+                        const auto* event =
+                            reinterpret_cast<const inotify_event*>(
+                                buffer + offset);
+                        if (event->len > 0 &&
+                                std::string_view{event->name} == name) {
+                            changed = true;
+                        }
+                        offset += static_cast<ssize_t>(
+                            sizeof(inotify_event) + event->len);
+                    }
+                }
+                if (changed) {
+                    onChange();
+                }
+            }
+        }};
+}
+
+ARG_DECL FileWatcher::~FileWatcher()
+{
+    if (!_state->thread.joinable()) {
+        return;
+    }
+    uint64_t one = 1;
+    [[maybe_unused]] auto written = ::write(_state->stop, &one, sizeof(one));
+    _state->thread.join();
+}
+
+#else
+
+struct FileWatcher::State {
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread thread;
+};
+
+ARG_DECL FileWatcher::FileWatcher(
+        std::string path, std::function<void()> onChange)
+    : _state(std::make_unique<State>())
+{
+    _state->thread = std::thread{[state = _state.get(),
+            path = std::move(path), onChange = std::move(onChange)] {
+        auto modified = [&path] {
+            auto error = std::error_code{};
+            return std::filesystem::last_write_time(path, error);
+        };
+
+        auto last = modified();
+        auto lock = std::unique_lock{state->mutex};
+        while (!state->wake.wait_for(
+                lock, std::chrono::milliseconds{500},
+                [state] { return state->stopping; })) {
+            auto current = modified();
+            if (current != last) {
+                last = current;
+                lock.unlock();
+                onChange();
+                lock.lock();
+            }
+        }
+    }};
+}
+
+ARG_DECL FileWatcher::~FileWatcher()
+{
+    {
+        auto lock = std::lock_guard{_state->mutex};
+        _state->stopping = true;
+    }
+    _state->wake.notify_one();
+    _state->thread.join();
+}
+
+#endif
+
+} // namespace arg::internal
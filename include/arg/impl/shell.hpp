@@ -0,0 +1,147 @@
+#pragma once
+
+#include "arg/impl/simd.hpp"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace arg::internal {
+
+// Splits a command line into arguments like a POSIX shell, without any
+// expansions: blanks separate arguments, single quotes keep everything up to
+// the closing quote, double quotes keep everything but backslash escapes of
+// $ ` " \ and newline, and a backslash outside of quotes escapes the next
+// character. Pieces of one argument are concatenated, so a'b'"c" is abc.
+//
+// An argument that is a single run of characters of commandLine, such as
+// plain words and simple quoted strings, is a view into commandLine. Others
+// are unescaped into scratch, which must be empty. It is sized once to fit
+// all of them, as unescaping never makes the text longer, so it is never
+// reallocated afterwards.
+//
+// Returns the offset of the opening quote that has no closing quote, or npos
+// if commandLine is complete.
+inline size_t splitCommandLine(
+    std::string_view commandLine,
+    std::vector<std::string_view>& tokens,
+    std::string& scratch)
+{
+    constexpr auto npos = std::string_view::npos;
+    const auto size = commandLine.size();
+
+    auto isBlank = [] (char c) {
+        return c == ' ' || c == '\t' || c == '\n';
+    };
+
+    size_t i = 0;
+    for (;;) {
+        while (i < size && isBlank(commandLine[i])) {
+            i++;
+        }
+        if (i == size) {
+            return npos;
+        }
+
+        // The argument is the view [viewBegin, viewEnd) of commandLine until
+        // a piece that does not continue it arrives; from then on it is built
+        // in scratch, starting at scratchBegin
+        bool started = false;
+        bool copied = false;
+        size_t viewBegin = 0;
+        size_t viewEnd = 0;
+        size_t scratchBegin = 0;
+        auto addPiece = [&] (size_t from, size_t to) {
+            if (!copied) {
+                if (!started || viewBegin == viewEnd) {
+                    viewBegin = from;
+                    viewEnd = to;
+                    started = true;
+                    return;
+                }
+                if (from == viewEnd) {
+                    viewEnd = to;
+                    return;
+                }
+                if (scratch.empty()) {
+                    scratch.reserve(size);
+                }
+                scratchBegin = scratch.size();
+                scratch.append(commandLine, viewBegin, viewEnd - viewBegin);
+                copied = true;
+            }
+            scratch.append(commandLine, from, to - from);
+        };
+
+        while (i < size) {
+            auto special = simd::findAny(
+                commandLine.substr(i), ' ', '\t', '\n', '\'', '"', '\\');
+            if (special == npos) {
+                addPiece(i, size);
+                i = size;
+                break;
+            }
+            if (special > 0) {
+                addPiece(i, i + special);
+                i += special;
+            }
+
+            char c = commandLine[i];
+            if (isBlank(c)) {
+                break;
+            } else if (c == '\\') {
+                if (i + 1 == size) {
+                    addPiece(i, i + 1);
+                    i++;
+                } else if (commandLine[i + 1] != '\n') {
+                    addPiece(i + 1, i + 2);
+                    i += 2;
+                } else {
+                    i += 2;
+                }
+            } else if (c == '\'') {
+                auto close = simd::find(commandLine.substr(i + 1), '\'');
+                if (close == npos) {
+                    return i;
+                }
+                addPiece(i + 1, i + 1 + close);
+                i += close + 2;
+            } else {
+                auto open = i++;
+                for (;;) {
+                    auto next = simd::findAny(commandLine.substr(i), '"', '\\');
+                    if (next == npos) {
+                        return open;
+                    }
+                    addPiece(i, i + next);
+                    i += next;
+                    if (commandLine[i] == '"') {
+                        i++;
+                        break;
+                    }
+                    auto escaped = i + 1 < size ? commandLine[i + 1] : '\0';
+                    if (escaped == '\n') {
+                        i += 2;
+                    } else if (escaped == '$' || escaped == '`' ||
+                            escaped == '"' || escaped == '\\') {
+                        addPiece(i + 1, i + 2);
+                        i += 2;
+                    } else {
+                        addPiece(i, i + 1);
+                        i++;
+                    }
+                }
+            }
+        }
+
+        if (copied) {
+            tokens.emplace_back(
+                scratch.data() + scratchBegin, scratch.size() - scratchBegin);
+        } else if (started) {
+            tokens.push_back(
+                commandLine.substr(viewBegin, viewEnd - viewBegin));
+        }
+    }
+}
+
+} // namespace arg::internal
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARG_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+// Byte scanning primitives. They process 16 bytes at a time with SSE2 where
+// it is available, and fall back to plain loops elsewhere.
+
+namespace arg::internal::simd {
+
+#if defined(ARG_SIMD_SSE2)
+
+inline __m128i load(const char* data)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+inline unsigned matches(__m128i block, char c)
+{
+    return static_cast<unsigned>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8(c))));
+}
+
+#endif
+
+// Position of the first byte equal to c, or npos
+inline size_t find(std::string_view input, char c)
+{
+    size_t i = 0;
+#if defined(ARG_SIMD_SSE2)
+    for (; i + 16 <= input.size(); i += 16) {
+        if (auto mask = matches(load(input.data() + i), c); mask != 0) {
+            return i + static_cast<size_t>(std::countr_zero(mask));
+        }
+    }
+#endif
+    for (; i < input.size(); i++) {
+        if (input[i] == c) {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// Number of bytes equal to c
+inline size_t count(std::string_view input, char c)
+{
+    size_t result = 0;
+    size_t i = 0;
+#if defined(ARG_SIMD_SSE2)
+    for (; i + 16 <= input.size(); i += 16) {
+        result += static_cast<size_t>(
+            std::popcount(matches(load(input.data() + i), c)));
+    }
+#endif
+    for (; i < input.size(); i++) {
+        result += input[i] == c;
+    }
+    return result;
+}
+
+// Position of the first byte equal to any of cs, or npos
+template <std::same_as<char>... Chars>
+size_t findAny(std::string_view input, Chars... cs)
+{
+    size_t i = 0;
+#if defined(ARG_SIMD_SSE2)
+    for (; i + 16 <= input.size(); i += 16) {
+        auto block = load(input.data() + i);
+        if (auto mask = (matches(block, cs) | ...); mask != 0) {
+            return i + static_cast<size_t>(std::countr_zero(mask));
+        }
+    }
+#endif
+    for (; i < input.size(); i++) {
+        if (((input[i] == cs) || ...)) {
+            return i;
+        }
+    }
+    return std::string_view::npos;
+}
+
+namespace utf8 {
+
+// Position of the first byte of the first sequence from a sequence boundary
+// on that is not valid UTF-8, or npos. Decodes one sequence at a time.
+inline size_t firstInvalid(std::string_view input, size_t from)
+{
+    auto byte = [input] (size_t i) {
+        return static_cast<unsigned char>(input[i]);
+    };
+
+    for (size_t i = from; i < input.size(); ) {
+        unsigned char lead = byte(i);
+        if (lead < 0x80) {
+            i++;
+            continue;
+        }
+
+        // Allowed range of the second byte, which rules out the overlong,
+        // surrogate and too large forms
+        size_t length = 0;
+        unsigned char low = 0x80;
+        unsigned char high = 0xbf;
+        if (lead >= 0xc2 && lead <= 0xdf) {
+            length = 2;
+        } else if (lead >= 0xe0 && lead <= 0xef) {
+            length = 3;
+            low = lead == 0xe0 ? 0xa0 : 0x80;
+            high = lead == 0xed ? 0x9f : 0xbf;
+        } else if (lead >= 0xf0 && lead <= 0xf4) {
+            length = 4;
+            low = lead == 0xf0 ? 0x90 : 0x80;
+            high = lead == 0xf4 ? 0x8f : 0xbf;
+        } else {
+            return i;
+        }
+
+        if (input.size() - i < length ||
+                byte(i + 1) < low || byte(i + 1) > high) {
+            return i;
+        }
+        for (size_t k = 2; k < length; k++) {
+            if ((byte(i + k) & 0xc0) != 0x80) {
+                return i;
+            }
+        }
+        i += length;
+    }
+    return std::string_view::npos;
+}
+
+#if defined(ARG_SIMD_SSE2)
+
+// Checks 16 bytes at a time with bit masks of byte classes. Each lead byte
+// sets the bits of the continuation bytes it needs, and the input is valid
+// where those are exactly the continuation bytes. Needs for the bytes of the
+// next block are carried over.
+class BlockChecker {
+public:
+    bool check(__m128i block)
+    {
+        uint32_t nonAscii = mask(block);
+        if (nonAscii == 0 && _expected == 0) {
+            return true;
+        }
+
+        uint32_t cont = below(block, 0xc0);
+        uint32_t lead = nonAscii & ~cont;
+        uint32_t lead3 = lead & ~below(block, 0xe0);
+        uint32_t bad = lead & below(block, 0xc2);
+        uint32_t expected = _expected | lead << 1;
+
+        // Longer sequences are rarer, and only they need the rest. The
+        // second byte of E0, ED, F0 and F4 sequences has a narrower range
+        // than other continuation bytes.
+        if ((lead3 | _afterE0 | _afterED | _afterF0 | _afterF4) != 0) {
+            uint32_t lead4 = lead & ~below(block, 0xf0);
+            uint32_t belowA0 = below(block, 0xa0);
+            uint32_t below90 = below(block, 0x90);
+            uint32_t afterE0 = _afterE0 | equal(block, 0xe0) << 1;
+            uint32_t afterED = _afterED | equal(block, 0xed) << 1;
+            uint32_t afterF0 = _afterF0 | equal(block, 0xf0) << 1;
+            uint32_t afterF4 = _afterF4 | equal(block, 0xf4) << 1;
+            bad |=
+                (lead & ~below(block, 0xf5)) |
+                (afterE0 & belowA0) |
+                (afterED & cont & ~belowA0) |
+                (afterF0 & below90) |
+                (afterF4 & cont & ~below90);
+            expected |= lead3 << 2 | lead4 << 3;
+            _afterE0 = afterE0 >> 16;
+            _afterED = afterED >> 16;
+            _afterF0 = afterF0 >> 16;
+            _afterF4 = afterF4 >> 16;
+        }
+
+        _expected = expected >> 16;
+        return (bad & 0xffff) == 0 && (expected & 0xffff) == cont;
+    }
+
+    // Whether the last block ended inside a sequence
+    [[nodiscard]] bool pending() const
+    {
+        return _expected != 0;
+    }
+
+private:
+    static uint32_t mask(__m128i block)
+    {
+        return static_cast<uint32_t>(_mm_movemask_epi8(block));
+    }
+
+    // Signed comparisons, which order the bytes from 0x80 up as expected as
+    // long as ASCII bytes are excluded by other masks
+    static uint32_t below(__m128i block, int c)
+    {
+        return mask(_mm_cmplt_epi8(block, _mm_set1_epi8(static_cast<char>(c))));
+    }
+
+    static uint32_t equal(__m128i block, int c)
+    {
+        return mask(_mm_cmpeq_epi8(block, _mm_set1_epi8(static_cast<char>(c))));
+    }
+
+    uint32_t _expected = 0;
+    uint32_t _afterE0 = 0;
+    uint32_t _afterED = 0;
+    uint32_t _afterF0 = 0;
+    uint32_t _afterF4 = 0;
+};
+
+#endif
+
+} // namespace utf8
+
+// Position of the first byte of the first sequence that is not valid UTF-8,
+// or npos. Overlong forms, surrogates and code points past U+10FFFF are
+// invalid. The blocks are only checked for validity; when one fails, its
+// bytes are decoded one by one to find the exact position.
+inline size_t invalidUtf8(std::string_view input)
+{
+#if defined(ARG_SIMD_SSE2)
+    // The start of the sequence that the block at i begins inside of. The
+    // bytes before the block are known to be valid.
+    auto restart = [input] (size_t i) {
+        size_t start = i;
+        while (start > 0 && i - start < 3 &&
+                (static_cast<unsigned char>(input[start - 1]) & 0xc0) == 0x80) {
+            start--;
+        }
+        return start > 0 ? start - 1 : 0;
+    };
+
+    auto checker = utf8::BlockChecker{};
+    size_t i = 0;
+    for (; i + 16 <= input.size(); i += 16) {
+        if (!checker.check(load(input.data() + i))) {
+            return utf8::firstInvalid(input, restart(i));
+        }
+    }
+
+    // The rest is padded with ASCII, so that a sequence cut short fails
+    char tail[16] = {};
+    std::memcpy(tail, input.data() + i, input.size() - i);
+    if (!checker.check(load(tail)) || checker.pending()) {
+        return utf8::firstInvalid(input, restart(i));
+    }
+    return std::string_view::npos;
+#else
+    return utf8::firstInvalid(input, 0);
+#endif
+}
+
+// Position of the first occurrence of needle, or npos. Candidates are found
+// by scanning for the first byte of the needle.
+inline size_t find(std::string_view input, std::string_view needle)
+{
+    if (needle.empty()) {
+        return 0;
+    }
+    for (size_t from = 0; from + needle.size() <= input.size(); ) {
+        auto i = find(input.substr(from), needle.front());
+        if (i == std::string_view::npos) {
+            break;
+        }
+        i += from;
+        if (input.substr(i, needle.size()) == needle) {
+            return i;
+        }
+        from = i + 1;
+    }
+    return std::string_view::npos;
+}
+
+} // namespace arg::internal::simd
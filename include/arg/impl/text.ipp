@@ -0,0 +1,160 @@
+#pragma once
+
+#include "arg/text.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+
+namespace arg::internal {
+
+inline constexpr size_t textChunkSize = 64 * 1024;
+
+inline std::string_view recordData(const char* record, size_t header)
+{
+    uint32_t size = 0;
+    std::memcpy(&size, record, sizeof(size));
+    return {record + header, size};
+}
+
+ARG_DECL std::string_view TextPool::intern(std::string_view text)
+{
+    if (text.empty()) {
+        return {};
+    }
+    auto lock = std::lock_guard{_mutex};
+    return recordData(insert(_texts, text), _texts.header);
+}
+
+ARG_DECL std::span<const std::string_view> TextPool::intern(
+    std::span<const std::string_view> texts)
+{
+    if (texts.empty()) {
+        return {};
+    }
+
+    std::vector<std::string_view> interned;
+    interned.reserve(texts.size());
+    auto lock = std::lock_guard{_mutex};
+    for (auto text : texts) {
+        interned.push_back(text.empty() ?
+            std::string_view{} :
+            recordData(insert(_texts, text), _texts.header));
+    }
+
+    // Interned texts have unique addresses, so equal lists have equal bytes
+    auto bytes = std::string_view{
+        reinterpret_cast<const char*>(interned.data()),
+        interned.size() * sizeof(std::string_view)};
+    auto data = recordData(insert(_lists, bytes), _lists.header);
+    return {
+        reinterpret_cast<const std::string_view*>(data.data()),
+        interned.size()};
+}
+
+ARG_DECL size_t TextPool::bytes() const
+{
+    auto lock = std::lock_guard{_mutex};
+    return _bytes;
+}
+
+ARG_DECL const char* TextPool::insert(Table& table, std::string_view data)
+{
+    if ((table.used + 1) * 4 > table.slots.size() * 3) {
+        grow(table);
+    }
+
+    auto mask = table.slots.size() - 1;
+    for (auto i = std::hash<std::string_view>{}(data) & mask; ;
+            i = (i + 1) & mask) {
+        const char* record = table.slots[i];
+        if (!record) {
+            auto* memory = allocate(table.header + data.size(), table.header);
+            auto size = static_cast<uint32_t>(data.size());
+            std::memcpy(memory, &size, sizeof(size));
+            std::memcpy(memory + table.header, data.data(), data.size());
+            table.slots[i] = memory;
+            table.used++;
+            return memory;
+        }
+        if (recordData(record, table.header) == data) {
+            return record;
+        }
+    }
+}
+
+ARG_DECL void TextPool::grow(Table& table)
+{
+    auto slots = std::vector<const char*>(
+        std::max<size_t>(64, table.slots.size() * 2), nullptr);
+    auto mask = slots.size() - 1;
+    for (const char* record : table.slots) {
+        if (!record) {
+            continue;
+        }
+        auto hash = std::hash<std::string_view>{}(
+            recordData(record, table.header));
+        auto i = hash & mask;
+        while (slots[i]) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = record;
+    }
+    table.slots = std::move(slots);
+}
+
+ARG_DECL char* TextPool::allocate(size_t size, size_t alignment)
+{
+    auto padding = static_cast<size_t>(
+        -reinterpret_cast<uintptr_t>(_next) & (alignment - 1));
+    if (_next && padding + size <= _left) {
+        auto* result = _next + padding;
+        _next += padding + size;
+        _left -= padding + size;
+        return result;
+    }
+
+    // Large texts get a chunk of their own, so that the current one keeps
+    // being filled
+    bool small = size * 4 <= textChunkSize;
+    auto capacity = small ? textChunkSize : size;
+    auto chunk = std::make_unique<char[]>(capacity);
+    auto* result = chunk.get();
+    _bytes += capacity;
+    if (small) {
+        _next = result + size;
+        _left = capacity - size;
+    }
+    _chunks.push_back(std::move(chunk));
+    return result;
+}
+
+ARG_DECL TextPool& textPool()
+{
+    static TextPool pool;
+    return pool;
+}
+
+inline std::atomic<uint64_t>& schemaCounter()
+{
+    static std::atomic<uint64_t> counter{0};
+    return counter;
+}
+
+ARG_DECL void schemaChanged()
+{
+    schemaCounter().fetch_add(1, std::memory_order_relaxed);
+}
+
+ARG_DECL uint64_t schemaGeneration()
+{
+    return schemaCounter().load(std::memory_order_relaxed);
+}
+
+} // namespace arg::internal
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "arg/adapters.hpp"
+#include "arg/impl/image.hpp"
+#include "arg/impl/simd.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace arg::internal {
+
+// A command-line token, classified once when the event reader reaches it.
+// The key and value spans are only meaningful for KeyValue tokens.
+struct Token {
+    enum class Kind : uint8_t {
+        Plain,
+        KeyValue,
+    };
+
+    std::string_view text;
+    uint32_t keySize = 0;
+    uint32_t valueOffset = 0;
+    Kind kind = Kind::Plain;
+    bool prefixed = false;
+
+    [[nodiscard]] std::string_view key() const
+    {
+        return text.substr(0, keySize);
+    }
+
+    [[nodiscard]] std::string_view value() const
+    {
+        return text.substr(valueOffset);
+    }
+};
+
+struct TokenizerConfig {
+    std::string_view packPrefix;
+    std::string_view keyValueSeparator;
+};
+
+inline Token classify(std::string_view text, const TokenizerConfig& config)
+{
+    auto token = Token{};
+    token.text = text;
+    token.prefixed = !config.packPrefix.empty() &&
+        text.starts_with(config.packPrefix);
+
+    if (!config.keyValueSeparator.empty()) {
+        auto separator = simd::find(text, config.keyValueSeparator);
+        if (separator != std::string_view::npos) {
+            token.kind = Token::Kind::KeyValue;
+            token.keySize = static_cast<uint32_t>(separator);
+            token.valueOffset = static_cast<uint32_t>(
+                separator + config.keyValueSeparator.size());
+        }
+    }
+    return token;
+}
+
+// Lookup table from keys to options, built once per parse. Options defined
+// later take precedence, as do help keys. Single-character keys made of the
+// pack prefix and one character also go into a flat table for packs. Given
+// a parser image, the tables are read from the image instead, and only the
+// entries themselves are built.
+class KeyIndex {
+public:
+    struct Entry {
+        KeyAdapter* option = nullptr;
+        uint32_t id = 0;
+        bool help = false;
+    };
+
+    KeyIndex(
+        const std::vector<KeyAdapter*>& options,
+        const std::vector<std::string>& helpKeys,
+        std::string_view packPrefix,
+        const ParserImage* image = nullptr)
+    {
+        if (image) {
+            _image = image;
+            _entries.reserve(options.size() + 1);
+            for (size_t id = 0; id < options.size(); id++) {
+                _entries.push_back(
+                    Entry{options[id], static_cast<uint32_t>(id), false});
+            }
+            _entries.push_back(Entry{nullptr, 0, true});
+            return;
+        }
+
+        _keys.reserve(options.size() + helpKeys.size());
+        for (size_t id = 0; id < options.size(); id++) {
+            auto* option = options[id];
+            for (const auto& key : option->keys()) {
+                auto& entry = _keys[key];
+                entry = Entry{option, static_cast<uint32_t>(id), false};
+                if (!packPrefix.empty() &&
+                        key.size() == packPrefix.size() + 1 &&
+                        key.starts_with(packPrefix)) {
+                    _pack[static_cast<unsigned char>(key.back())] = &entry;
+                }
+            }
+        }
+        for (const auto& key : helpKeys) {
+            _keys[key] = Entry{nullptr, 0, true};
+        }
+    }
+
+    KeyIndex(const KeyIndex&) = delete;
+    KeyIndex(KeyIndex&&) = default;
+    KeyIndex& operator=(const KeyIndex&) = delete;
+    KeyIndex& operator=(KeyIndex&&) = default;
+
+    [[nodiscard]] const Entry* find(std::string_view key) const
+    {
+        if (_image) {
+            return entry(_image->find(key));
+        }
+        auto it = _keys.find(key);
+        return it != _keys.end() ? &it->second : nullptr;
+    }
+
+    // Entries point into _keys, which keeps them in place as it grows. A
+    // help key that replaces a single-character key turns its entry off.
+    [[nodiscard]] const Entry* packed(char c) const
+    {
+        if (_image) {
+            return entry(_image->packed(c));
+        }
+        const auto* entry = _pack[static_cast<unsigned char>(c)];
+        return entry && entry->option ? entry : nullptr;
+    }
+
+private:
+    [[nodiscard]] const Entry* entry(uint32_t id) const
+    {
+        if (id == ParserImage::none) {
+            return nullptr;
+        }
+        return id == ParserImage::helpKey ? &_entries.back() : &_entries[id];
+    }
+
+    std::unordered_map<std::string_view, Entry> _keys;
+    std::array<const Entry*, 256> _pack{};
+    const ParserImage* _image = nullptr;
+    std::vector<Entry> _entries;
+};
+
+} // namespace arg::internal
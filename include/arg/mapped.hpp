@@ -0,0 +1,141 @@
+#pragma once
+
+#include "arg/converters.hpp"
+#include "arg/formatters.hpp"
+#include "arg/impl/file.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+namespace arg {
+
+// A file whose contents are the value of an option, given as "@path" or as
+// a plain path. Parsing only records the path. The file is mapped read-only
+// the first time its contents are asked for, so startup does not pay for
+// reading payloads that may never be used, and processes that map the same
+// file share its pages through the page cache. Copies share one mapping.
+//
+//     auto weights = parser.option<arg::MappedFile>().keys("--weights");
+//     parser.parse(argc, argv);      // --weights=@model.bin
+//     auto bytes = weights->data();  // mapped here
+class MappedFile {
+public:
+    using Access = internal::FileAccess;
+
+    MappedFile() = default;
+
+    explicit MappedFile(std::string path, Access access = Access::Sequential)
+        : _state(std::make_shared<State>(std::move(path), access))
+    { }
+
+    [[nodiscard]] const std::string& path() const
+    {
+        return _state->path;
+    }
+
+    // How the contents will be read, passed on to madvise when the file is
+    // mapped. Set it after parsing and before the first access; changes
+    // after that have no effect.
+    [[nodiscard]] Access access() const
+    {
+        return _state->access;
+    }
+
+    void access(Access access)
+    {
+        _state->access = access;
+    }
+
+    // The contents of the file, mapped on the first call. Empty if the file
+    // cannot be read, or is empty; readable() tells which.
+    [[nodiscard]] std::string_view data() const
+    {
+        auto& state = *_state;
+        std::call_once(state.once, [&state] {
+            state.mapping = internal::FileMapping{state.path, state.access};
+            state.mapped = true;
+        });
+        return state.mapping.data();
+    }
+
+    // Whether the file could be opened and mapped. Maps it if that was not
+    // done yet.
+    [[nodiscard]] bool readable() const
+    {
+        return error() == 0;
+    }
+
+    // The errno of the call that failed to open or map the file, or 0. Maps
+    // it if that was not done yet.
+    [[nodiscard]] int error() const
+    {
+        std::ignore = data();
+        return _state->mapping.error();
+    }
+
+    [[nodiscard]] size_t size() const
+    {
+        return data().size();
+    }
+
+    [[nodiscard]] bool empty() const
+    {
+        return data().empty();
+    }
+
+    // Whether the contents have been asked for yet
+    [[nodiscard]] bool mapped() const
+    {
+        return _state->mapped;
+    }
+
+private:
+    struct State {
+        State() = default;
+
+        State(std::string path, Access access)
+            : path(std::move(path))
+            , access(access)
+        { }
+
+        std::string path;
+        Access access = Access::Sequential;
+        std::once_flag once;
+        internal::FileMapping mapping;
+        std::atomic<bool> mapped = false;
+    };
+
+    std::shared_ptr<State> _state = std::make_shared<State>();
+};
+
+// A leading '@' is dropped, so "@@name" names the file "@name"
+template <>
+struct Converter<MappedFile> {
+    bool operator()(std::string_view input, MappedFile& value) const
+    {
+        if (input.starts_with('@')) {
+            input.remove_prefix(1);
+        }
+        if (input.empty()) {
+            return false;
+        }
+        value = MappedFile{std::string{input}};
+        return true;
+    }
+};
+
+template <>
+struct Formatter<MappedFile> {
+    void operator()(const MappedFile& value, std::string& output) const
+    {
+        output += '@';
+        output += value.path();
+    }
+};
+
+} // namespace arg
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <ratio>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+
+// Allocation-free scanners for numbers with units, shared by the built-in
+// converters, and their counterparts for formatting.
+
+namespace arg::internal {
+
+template <class T>
+bool fromChars(std::string_view input, T& value)
+{
+    if (input.size() > 1 && input.front() == '+' &&
+            input[1] != '-' && input[1] != '+') {
+        input.remove_prefix(1);
+    }
+    if (input.empty()) {
+        return false;
+    }
+
+    auto result = T{};
+    auto [end, ec] =
+        std::from_chars(input.data(), input.data() + input.size(), result);
+    if (ec != std::errc{} || end != input.data() + input.size()) {
+        return false;
+    }
+    value = result;
+    return true;
+}
+
+// Appends the shortest text that fromChars reads back as the same value
+template <class T>
+void toChars(T value, std::string& output)
+{
+    char buffer[64];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    output.append(buffer, result.ptr);
+}
+
+// A decimal number as written: mantissa / scale, where scale is a power of 10
+struct Decimal {
+    uint64_t mantissa = 0;
+    uint64_t scale = 1;
+    bool negative = false;
+};
+
+// Reads a decimal number from the start of input and removes it. Fails if the
+// significant digits do not fit into 64 bits.
+inline bool parseDecimal(std::string_view& input, Decimal& decimal)
+{
+    constexpr auto max = std::numeric_limits<uint64_t>::max();
+
+    auto result = Decimal{};
+    size_t i = 0;
+    if (i < input.size() && (input[i] == '-' || input[i] == '+')) {
+        result.negative = input[i] == '-';
+        i++;
+    }
+
+    size_t digits = 0;
+    size_t pendingZeros = 0;
+    bool point = false;
+    for (; i < input.size(); i++) {
+        char c = input[i];
+        if (c == '.' && !point) {
+            point = true;
+            continue;
+        }
+        if (c < '0' || c > '9') {
+            break;
+        }
+        digits++;
+
+        // Zeros after the decimal point only matter if a non-zero digit
+        // follows them, so "1.500" does not lose precision.
+        if (point && c == '0') {
+            pendingZeros++;
+            continue;
+        }
+        for (; pendingZeros > 0; pendingZeros--) {
+            if (result.mantissa > max / 10 || result.scale > max / 10) {
+                return false;
+            }
+            result.mantissa *= 10;
+            result.scale *= 10;
+        }
+
+        auto digit = static_cast<uint64_t>(c - '0');
+        if (result.mantissa > (max - digit) / 10) {
+            return false;
+        }
+        result.mantissa = result.mantissa * 10 + digit;
+        if (point) {
+            if (result.scale > max / 10) {
+                return false;
+            }
+            result.scale *= 10;
+        }
+    }
+
+    if (digits == 0) {
+        return false;
+    }
+    input.remove_prefix(i);
+    decimal = result;
+    return true;
+}
+
+// Computes decimal * num / den exactly. Fails if the result is not a whole
+// number or does not fit into 64 bits.
+inline bool scaleExact(
+    const Decimal& decimal, uint64_t num, uint64_t den, uint64_t& result)
+{
+    constexpr auto max = std::numeric_limits<uint64_t>::max();
+
+    auto mantissa = decimal.mantissa;
+    if (mantissa == 0) {
+        result = 0;
+        return true;
+    }
+
+    // den * scale may overflow, so cancel each factor separately
+    auto g = std::gcd(mantissa, decimal.scale);
+    mantissa /= g;
+    auto scale = decimal.scale / g;
+    g = std::gcd(num, scale);
+    num /= g;
+    scale /= g;
+    if (scale != 1) {
+        return false;
+    }
+
+    g = std::gcd(mantissa, den);
+    mantissa /= g;
+    den /= g;
+    g = std::gcd(num, den);
+    num /= g;
+    den /= g;
+    if (den != 1) {
+        return false;
+    }
+
+    if (mantissa > max / num) {
+        return false;
+    }
+    result = mantissa * num;
+    return true;
+}
+
+template <class T>
+bool toSigned(uint64_t magnitude, bool negative, T& value)
+{
+    using U = std::make_unsigned_t<T>;
+    constexpr auto max = static_cast<uint64_t>(std::numeric_limits<T>::max());
+
+    if (!negative) {
+        if (magnitude > max) {
+            return false;
+        }
+        value = static_cast<T>(magnitude);
+        return true;
+    }
+
+    if constexpr (std::is_signed_v<T>) {
+        if (magnitude > max + 1) {
+            return false;
+        }
+        value = static_cast<T>(static_cast<U>(0) - static_cast<U>(magnitude));
+        return true;
+    } else {
+        if (magnitude != 0) {
+            return false;
+        }
+        value = 0;
+        return true;
+    }
+}
+
+struct Multiplier {
+    uint64_t num = 1;
+    uint64_t den = 1;
+};
+
+// SI (k, M, G, T, P, E) and IEC (Ki, Mi, Gi, Ti, Pi, Ei) multipliers. An
+// empty suffix means 1.
+inline bool parseMultiplier(std::string_view suffix, Multiplier& multiplier)
+{
+    if (suffix.empty()) {
+        multiplier = {};
+        return true;
+    }
+
+    int power = 0;
+    switch (suffix.front()) {
+        case 'k': case 'K': power = 1; break;
+        case 'M': power = 2; break;
+        case 'G': power = 3; break;
+        case 'T': power = 4; break;
+        case 'P': power = 5; break;
+        case 'E': power = 6; break;
+        default: return false;
+    }
+
+    uint64_t base = 1000;
+    if (suffix.size() == 2 && suffix[1] == 'i') {
+        base = 1024;
+    } else if (suffix.size() != 1) {
+        return false;
+    }
+
+    multiplier = {};
+    for (int i = 0; i < power; i++) {
+        multiplier.num *= base;
+    }
+    return true;
+}
+
+// Time units as a ratio of nanoseconds
+inline bool parseTimeUnit(std::string_view unit, Multiplier& multiplier)
+{
+    if (unit == "ns") {
+        multiplier = {1, 1};
+    } else if (unit == "us" || unit == "\xc2\xb5s") {
+        multiplier = {1'000, 1};
+    } else if (unit == "ms") {
+        multiplier = {1'000'000, 1};
+    } else if (unit == "s") {
+        multiplier = {1'000'000'000, 1};
+    } else if (unit == "m" || unit == "min") {
+        multiplier = {60'000'000'000, 1};
+    } else if (unit == "h") {
+        multiplier = {3'600'000'000'000, 1};
+    } else if (unit == "d") {
+        multiplier = {86'400'000'000'000, 1};
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline size_t unitLength(std::string_view input)
+{
+    size_t i = 0;
+    while (i < input.size() &&
+            !(input[i] >= '0' && input[i] <= '9') &&
+            input[i] != '.' && input[i] != '/') {
+        i++;
+    }
+    return i;
+}
+
+inline bool parseByteSize(std::string_view input, uint64_t& bytes)
+{
+    auto decimal = Decimal{};
+    if (!parseDecimal(input, decimal) || decimal.negative) {
+        return false;
+    }
+    if (!input.empty() && input.back() == 'B') {
+        input.remove_suffix(1);
+    }
+
+    auto multiplier = Multiplier{};
+    return parseMultiplier(input, multiplier) &&
+        scaleExact(decimal, multiplier.num, multiplier.den, bytes);
+}
+
+// Parses "1h30m", "250ms" or "1.5s" into a number of ticks of the given
+// period. A number without a unit is taken in ticks. Integer tick counts must
+// be represented exactly.
+template <class Rep, class Period>
+bool parseDuration(std::string_view input, Rep& ticks)
+{
+    static_assert(Period::num > 0 && Period::den > 0);
+
+    auto first = Decimal{};
+    auto rest = input;
+    if (!parseDecimal(rest, first)) {
+        return false;
+    }
+    if (rest.empty()) {
+        if constexpr (std::is_floating_point_v<Rep>) {
+            if (input.front() == '+') {
+                input.remove_prefix(1);
+            }
+            auto [end, ec] = std::from_chars(
+                input.data(), input.data() + input.size(), ticks);
+            return ec == std::errc{} && end == input.data() + input.size();
+        } else {
+            return first.scale == 1 &&
+                toSigned(first.mantissa, first.negative, ticks);
+        }
+    }
+
+    // Each part is a number followed by a unit. Only the first part may have
+    // a sign, which applies to the whole duration.
+    auto nextPart = [&input] (bool isFirst, Decimal& decimal, Multiplier& unit) {
+        if (!parseDecimal(input, decimal) || (!isFirst && decimal.negative)) {
+            return false;
+        }
+        auto length = unitLength(input);
+        if (length == 0 || !parseTimeUnit(input.substr(0, length), unit)) {
+            return false;
+        }
+        input.remove_prefix(length);
+        return true;
+    };
+
+    if constexpr (std::is_floating_point_v<Rep>) {
+        auto nanoseconds = static_cast<long double>(0);
+        for (bool isFirst = true; !input.empty(); isFirst = false) {
+            auto decimal = Decimal{};
+            auto unit = Multiplier{};
+            if (!nextPart(isFirst, decimal, unit)) {
+                return false;
+            }
+            nanoseconds += static_cast<long double>(decimal.mantissa) /
+                static_cast<long double>(decimal.scale) *
+                static_cast<long double>(unit.num);
+        }
+        if (first.negative) {
+            nanoseconds = -nanoseconds;
+        }
+        ticks = static_cast<Rep>(nanoseconds * Period::den /
+            (static_cast<long double>(Period::num) * 1e9L));
+        return true;
+    } else {
+        // ticks = nanoseconds * Ticks::num / Ticks::den
+        using Ticks = std::ratio_divide<std::nano, Period>;
+        constexpr auto max = std::numeric_limits<uint64_t>::max();
+
+        uint64_t total = 0;
+        for (bool isFirst = true; !input.empty(); isFirst = false) {
+            auto decimal = Decimal{};
+            auto unit = Multiplier{};
+            if (!nextPart(isFirst, decimal, unit)) {
+                return false;
+            }
+
+            // Cancel the unit against the tick ratio first, so that the
+            // multiplication below only overflows if the result does.
+            auto g = std::gcd(unit.num, static_cast<uint64_t>(Ticks::den));
+            auto num = unit.num / g;
+            auto den = static_cast<uint64_t>(Ticks::den) / g;
+            if (static_cast<uint64_t>(Ticks::num) > max / num) {
+                return false;
+            }
+            uint64_t part = 0;
+            if (!scaleExact(decimal,
+                    num * static_cast<uint64_t>(Ticks::num), den, part) ||
+                    part > max - total) {
+                return false;
+            }
+            total += part;
+        }
+        return toSigned(total, first.negative, ticks);
+    }
+}
+
+template <class T>
+bool parseQuantity(std::string_view input, T& value)
+{
+    auto rest = input;
+    auto decimal = Decimal{};
+    if (!parseDecimal(rest, decimal)) {
+        return false;
+    }
+    auto multiplier = Multiplier{};
+    if (!parseMultiplier(rest, multiplier)) {
+        return false;
+    }
+
+    if constexpr (std::is_floating_point_v<T>) {
+        auto number = T{};
+        auto digits = input.substr(0, input.size() - rest.size());
+        if (digits.front() == '+') {
+            digits.remove_prefix(1);
+        }
+        auto [end, ec] = std::from_chars(
+            digits.data(), digits.data() + digits.size(), number);
+        if (ec != std::errc{} || end != digits.data() + digits.size()) {
+            return false;
+        }
+        value = number * static_cast<T>(multiplier.num);
+        return true;
+    } else {
+        uint64_t magnitude = 0;
+        return scaleExact(
+                decimal, multiplier.num, multiplier.den, magnitude) &&
+            toSigned(magnitude, decimal.negative, value);
+    }
+}
+
+} // namespace arg::internal
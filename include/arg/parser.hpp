@@ -2,23 +2,66 @@
 
 #include "arg/adapters.hpp"
 #include "arg/arguments.hpp"
+#include "arg/argv.hpp"
+#include "arg/config.hpp"
 #include "arg/errors.hpp"
+#include "arg/events.hpp"
+#include "arg/flagset.hpp"
+#include "arg/impl/help.hpp"
+#include "arg/text.hpp"
 
 #include <algorithm>
-#include <cassert>
-#include <cstdlib>
-#include <filesystem>
-#include <iostream>
+#include <concepts>
+#include <cstdint>
+#include <iosfwd>
+#include <iterator>
 #include <memory>
-#include <optional>
-#include <ostream>
-#include <ranges>
-#include <stdexcept>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace arg {
 
+namespace internal {
+
+class OptionSet;
+class Registration;
+
+// A constraint between options, given by their keys and checked at the end
+// of each parse. For a Dependency, the first key is the dependent option.
+// The keys are resolved to option ids when the constraint is added, so a
+// parse only looks at ids; ids[i] is the option of keys[i].
+struct Constraint {
+    enum class Kind : uint8_t {
+        AtMostOne,
+        ExactlyOne,
+        Dependency,
+    };
+
+    Kind kind = Kind::AtMostOne;
+    std::span<const std::string_view> keys;
+    std::vector<uint32_t> ids;
+};
+
+template <class T>
+std::string_view constraintKey(const T& option)
+{
+    if constexpr (std::convertible_to<const T&, std::string_view>) {
+        return option;
+    } else {
+        if (option.keys().empty()) {
+            internal::logicError("an option in a constraint has no keys");
+        }
+        return option.keys().front();
+    }
+}
+
+} // namespace internal
+
 class Parser {
 public:
     struct Config {
@@ -27,30 +70,64 @@ public:
         bool allowArgumentPacking = true;
         std::string packPrefix = "-";
         bool allowUnspecifiedArguments = false;
+
+        // Token after which all tokens are positional arguments. Off when
+        // empty.
+        std::string endOfOptions = "--";
+
+        // File to keep the result of the last successful parse in. When the
+        // arguments and the options are the same on the next run, the result
+        // is loaded from it instead of being parsed again. Off when empty.
+        std::string cacheFile;
+
+        // Part of the cache key. Change it when values change meaning without
+        // changing type or layout, such as a renumbered enum. The program's
+        // own file is part of the key too, where it can be found, so that a
+        // rebuild starts with a fresh cache.
+        std::string cacheVersion;
+
+        // Columns to wrap help text to. When 0, the width of the terminal.
+        size_t helpWidth = 0;
     };
 
+    void attach(std::unique_ptr<KeyAdapter> option)
+    {
+        _options.push_back(option.get());
+        _ownedOptions.push_back(std::move(option));
+    }
+
+    void attach(std::unique_ptr<ArgumentAdapter> argument)
+    {
+        _arguments.push_back(std::move(argument));
+    }
+
     void attach(Flag flag)
     {
-        _options.push_back(std::make_unique<FlagAdapter>(std::move(flag)));
+        attach(std::make_unique<FlagAdapter>(std::move(flag)));
     }
 
     void attach(MultiFlag multiFlag)
     {
-        _options.push_back(
-            std::make_unique<MultiFlagAdapter>(std::move(multiFlag)));
+        attach(std::make_unique<MultiFlagAdapter>(std::move(multiFlag)));
     }
 
     template <class T>
     void attach(Option<T> option)
     {
-        _options.push_back(
-            std::make_unique<OptionAdapter<T>>(std::move(option)));
+        attach(std::make_unique<OptionAdapter<T>>(std::move(option)));
+    }
+
+    template <class T>
+    void attach(ListOption<T> listOption)
+    {
+        attach(
+            std::make_unique<ListOptionAdapter<T>>(std::move(listOption)));
     }
 
     template <class T>
     void attach(MultiOption<T> multiOption)
     {
-        _options.push_back(
+        attach(
             std::make_unique<MultiOptionAdapter<T>>(std::move(multiOption)));
     }
 
@@ -78,12 +155,36 @@ public:
         return makeAndAttach<MultiFlag>();
     }
 
+    // Adds a flag whose value is a bit of set
+    FlagSet::Member flag(FlagSet& set)
+    {
+        auto member = set.add();
+        auto it = std::find_if(
+            _flagSets.rbegin(), _flagSets.rend(),
+            [&set] (const auto& flags) {
+                return flags->data() == set._data.get();
+            });
+        if (it == _flagSets.rend()) {
+            _flagSets.push_back(
+                std::make_unique<internal::FlagSetOptions>(set._data));
+            it = _flagSets.rbegin();
+        }
+        _options.push_back((*it)->add(member.bit()));
+        return member;
+    }
+
     template <class T>
     Option<T> option()
     {
         return makeAndAttach<Option<T>>();
     }
 
+    template <class T>
+    ListOption<T> listOption()
+    {
+        return makeAndAttach<ListOption<T>>();
+    }
+
     template <class T>
     MultiOption<T> multiOption()
     {
@@ -106,230 +207,146 @@ public:
     void helpKeys(Args&&... args)
     {
         _helpKeys = {std::forward<Args>(args)...};
+        internal::schemaChanged();
     }
 
-    void printHelp(std::ostream& output=std::cout) const
+    // The name that help starts with. parse(argc, argv) sets it from argv[0].
+    void programName(std::string_view name)
     {
-        output << "usage: " << _programName;
-        for (const auto& option : _options) {
-            if (option->multi()) {
-                output << " {";
-            } else if (!option->isRequired()) {
-                output << " [";
-            }
-            output << " " << option->firstKey();
-            if (option->hasArgument()) {
-                output << " " << option->metavar();
-            }
-            if (option->multi()) {
-                output << " }";
-            } else if (!option->isRequired()) {
-                output << " ]";
-            }
-        }
-        for (const auto& argument : _arguments) {
-            if (argument->multi()) {
-                output << " {";
-            } else if (!argument->isRequired()) {
-                output << " [";
-            }
-            output << " " << argument->metavar();
-            if (argument->multi()) {
-                output << " }";
-            } else if (!argument->isRequired()) {
-                output << " ]";
-            }
-        }
-        output << "\n";
-
-        if (!_options.empty()) {
-            output << "\nOptions:\n";
-            for (const auto& option : _options) {
-                output << "  " << option->keyString();
-                if (option->hasArgument()) {
-                    output << " " << option->metavar();
-                }
-                output << "  " << option->help() << "\n";
-            }
-        }
-
-        if (!_arguments.empty()) {
-            output << "\nPositional arguments:\n";
-            for (const auto& argument : _arguments) {
-                output << argument->metavar() << "  " <<
-                    argument->help() << "\n";
-            }
-        }
+        _programName = name;
     }
 
-    void parse(int argc, char** argv)
+    [[nodiscard]] const std::string& programName() const
     {
-        if (argc > 0) {
-            _programName = std::filesystem::path{argv[0]}.filename().string();
-        }
-
-        std::vector<std::string> args;
-        for (int i = 1; i < argc; i++) {
-            args.emplace_back(argv[i]);
-        }
-        parse(args);
+        return _programName;
     }
 
-    void parse(std::ranges::range auto&& args)
-    {
-        std::vector<err::Error> errors;
-        bool helpRequested = false;
-
-        for (auto arg = args.begin(); arg != args.end(); ) {
-            if (auto it = std::find(_helpKeys.begin(), _helpKeys.end(), *arg);
-                    it != _helpKeys.end()) {
-                helpRequested = true;
-                ++arg;
-                continue;
-            }
-
-            if (auto* option = findOption(*arg); option) {
-                if (option->hasArgument()) {
-                    auto givenKey = *arg;
-                    ++arg;
-                    if (arg == args.end()) {
-                        errors.emplace_back(
-                            err::RequiredOptionValueNotGiven{givenKey});
-                        continue;
-                    }
-                    if (option->addValue(*arg)) {
-                        ++arg;
-                    } else {
-                        errors.emplace_back(
-                            err::InvalidValueGiven{option->keyString(), *arg});
-                    }
-                } else {
-                    option->raise();
-                    ++arg;
-                }
-                continue;
-            }
-
-            if (auto pair = parseKeyValue(*arg); pair) {
-                if (auto* option = findOption(pair->key); option) {
-                    if (option->hasArgument()) {
-                        option->addValue(pair->value);
-                    } else {
-                        errors.emplace_back(err::UnexpectedOptionValueGiven{
-                                pair->key, pair->value});
-                    }
-                    ++arg;
-                    continue;
-                }
-            }
+    // Constraints between options, each given by one of its keys or by its
+    // handle. They are checked at the end of a parse, against the options
+    // given on the command line.
 
-            if (auto pack = parsePack(*arg); pack) {
-                assert(!pack->keys.empty());
-
-                for (size_t i = 0; i + 1 < pack->keys.size(); i++) {
-                    auto* option = findOption(pack->keys.at(i));
-                    assert(option);
-                    assert(!option->hasArgument());
-                    option->raise();
-                }
-
-                auto* lastOption = findOption(pack->keys.back());
-                if (lastOption->hasArgument()) {
-                    if (!pack->leftover.empty()) {
-                        if (!lastOption->addValue(pack->leftover)) {
-                            errors.emplace_back(err::InvalidValueGiven{
-                                pack->keys.back(), pack->leftover});
-                        }
-                        ++arg;
-                    } else {
-                        ++arg;
-                        if (arg == args.end()) {
-                            errors.emplace_back(
-                                err::RequiredOptionValueNotGiven{
-                                    pack->keys.back()});
-                            continue;
-                        }
-                        if (lastOption->addValue(*arg)) {
-                            ++arg;
-                        } else {
-                            errors.emplace_back(err::InvalidValueGiven{
-                                    pack->keys.back(), *arg});
-                        }
-                    }
-                } else {
-                    lastOption->raise();
-                    ++arg;
-                }
-                continue;
-            }
-
-            if (_position < _arguments.size()) {
-                auto* argument = _arguments.at(_position).get();
-                if (!argument->addValue(*arg)) {
-                    errors.emplace_back(
-                        err::InvalidValueGiven{argument->metavar(), *arg});
-                }
-                ++arg;
-                if (!argument->multi()) {
-                    _position++;
-                }
-                continue;
-            }
+    // At most one of the options may be given
+    template <class... Keys>
+    requires (sizeof...(Keys) > 1)
+    void mutuallyExclusive(const Keys&... options)
+    {
+        addConstraint(internal::Constraint::Kind::AtMostOne, options...);
+    }
 
-            if (config.allowUnspecifiedArguments) {
-                _leftovers.push_back(*arg);
-            } else {
-                errors.emplace_back(err::UnexpectedArgument{*arg});
-            }
-            ++arg;
-        }
+    // Exactly one of the options must be given
+    template <class... Keys>
+    requires (sizeof...(Keys) > 1)
+    void exactlyOne(const Keys&... options)
+    {
+        addConstraint(internal::Constraint::Kind::ExactlyOne, options...);
+    }
 
-        if (!helpRequested) {
-            for (const auto& option : _options) {
-                if (option->isRequired() && !option->isSet()) {
-                    errors.emplace_back(
-                        err::RequiredOptionNotSet{option->keyString()});
-                }
-            }
-            for (const auto& argument : _arguments) {
-                if (argument->isRequired() && !argument->isSet()) {
-                    errors.emplace_back(
-                        err::RequiredOptionNotSet{argument->metavar()});
-                }
-            }
-        }
+    // If option is given, all of the dependencies must be given too
+    template <class Key, class... Keys>
+    requires (sizeof...(Keys) > 0)
+    void dependsOn(const Key& option, const Keys&... dependencies)
+    {
+        addConstraint(
+            internal::Constraint::Kind::Dependency, option, dependencies...);
+    }
 
-        if (!errors.empty()) {
-            for (const auto& error : errors) {
-                print(std::cerr, error);
-            }
-            printHelp(std::cerr);
-            std::exit(EXIT_FAILURE);
-        }
+    // Attaches the options defined with ARG_DEFINE_* that this parser has
+    // not seen yet. The global arg::parse and arg::printHelp do this on
+    // their own.
+    ARG_DECL void attachRegistered();
+
+    // Help is rendered once, with aligned columns, and kept until options
+    // are added. Given a section, only the options in it are listed.
+    ARG_DECL void printHelp() const;
+    ARG_DECL void printHelp(
+        std::ostream& output, std::string_view section = {}) const;
+
+    // Parsing takes time linear in the total size of the arguments plus the
+    // number of options, keys and constraints, whatever the arguments are.
+    // Each token is classified in one pass, keys are found by hashing, a
+    // pack costs one table lookup per character, and the final checks visit
+    // each option and constraint once. Error records are the exception:
+    // each copies the keys it names.
+    ARG_DECL void parse(int argc, char** argv);
+
+    // Splits commandLine into arguments the way a POSIX shell does, honoring
+    // single quotes, double quotes and backslash escapes, and parses them
+    ARG_DECL void parse(std::string_view commandLine);
+
+    template <internal::Range Args>
+    void parse(Args&& args)
+    {
+        std::vector<std::string> storage;
+        parseTokens(tokenViews(args, storage));
+    }
 
-        if (helpRequested) {
-            printHelp(std::cout);
-            std::exit(EXIT_SUCCESS);
-        }
+    // Parses like parse(), but returns the errors instead of printing them
+    // and exiting. Help keys print nothing, and the parse cache is not used.
+    template <internal::Range Args>
+    [[nodiscard]] std::vector<err::Error> tryParse(Args&& args)
+    {
+        std::vector<std::string> storage;
+        bool helpRequested = false;
+        return interpret(tokenViews(args, storage), helpRequested);
     }
 
+    [[nodiscard]] ARG_DECL std::vector<err::Error> tryParse(
+        std::string_view commandLine);
+
     const std::vector<std::string>& leftovers() const
     {
         return _leftovers;
     }
 
+    // Reads args as a stream of events instead of storing values into the
+    // handles, see EventReader
+    [[nodiscard]] ARG_DECL EventReader events(
+        std::span<const std::string_view> args) const;
+
+    // Renders the result of the last parse as a minimal argument vector that
+    // parses back to the same values. Throws std::logic_error, or aborts when
+    // built without exceptions, if a value has no text form.
+    [[nodiscard]] ARG_DECL Argv toArgv() const;
+
+    // Adds data that the parse result depends on besides the arguments, such
+    // as the contents of a config file, to the key of the parse cache
+    ARG_DECL void cacheInput(std::string_view data);
+
+    // A compiled image of the options: their key table, pack table and help
+    // text in one position-independent blob. Every process that defines the
+    // same options can map the image read-only, sharing its pages, instead
+    // of indexing the options on each parse. Load it once all options and
+    // help keys are defined; an image that does not match them is rejected,
+    // and the load returns false.
+    [[nodiscard]] ARG_DECL std::string image() const;
+    ARG_DECL bool saveImage(const std::string& path) const;
+    ARG_DECL bool loadImage(const std::string& path);
+
+    // Uses an image embedded in the program. It is read in place, so it must
+    // outlive the parser.
+    ARG_DECL bool useImage(std::string_view image);
+
     Config config;
 
 private:
-    struct KeyValuePair {
-        std::string key;
-        std::string value;
-    };
+    friend class EventReader;
 
-    struct KeyPack {
-        std::vector<std::string> keys;
-        std::string leftover;
-    };
+    template <class... Keys>
+    void addConstraint(internal::Constraint::Kind kind, const Keys&... options)
+    {
+        const std::string_view keys[] = {internal::constraintKey(options)...};
+        auto constraint = internal::Constraint{
+            kind, internal::textPool().intern(std::span{keys}), {}};
+        constraint.ids.reserve(constraint.keys.size());
+        for (auto key : constraint.keys) {
+            constraint.ids.push_back(optionId(key));
+        }
+        _constraints.push_back(std::move(constraint));
+    }
+
+    // Id of the option with key, for constraints. Throws std::logic_error,
+    // or aborts when exceptions are off, if no option has it.
+    ARG_DECL uint32_t optionId(std::string_view key);
 
     template <class T>
     T makeAndAttach()
@@ -339,133 +356,177 @@ private:
         return arg;
     }
 
-    // NOTE: linear search here, probably should replace with something better
-    // someday
-    KeyAdapter* findOption(std::string_view key)
+    ARG_DECL static err::Error invalidValue(
+        const std::vector<std::string_view>& choices,
+        std::string_view keys,
+        std::string_view value);
+
+    ARG_DECL void parseTokens(std::span<const std::string_view> args);
+
+    // Views of the elements of args. Elements that the range makes on the
+    // fly, such as strings from a transform view, are copied into storage
+    // first, so that the views outlive the loop that reads them.
+    template <internal::Range Args>
+    static std::vector<std::string_view> tokenViews(
+        Args& args, std::vector<std::string>& storage)
     {
-        for (auto it = _options.rbegin(); it != _options.rend(); ++it) {
-            if ((*it)->hasKey(key)) {
-                return it->get();
+        using Element = decltype(*std::begin(args));
+        std::vector<std::string_view> tokens;
+        if constexpr (std::is_lvalue_reference_v<Element> ||
+                std::is_convertible_v<Element, const char*> ||
+                std::same_as<std::remove_cvref_t<Element>, std::string_view>) {
+            for (const auto& arg : args) {
+                tokens.emplace_back(arg);
             }
+        } else {
+            for (auto&& arg : args) {
+                storage.emplace_back(std::string_view{arg});
+            }
+            tokens.assign(storage.begin(), storage.end());
         }
-        return nullptr;
+        return tokens;
     }
 
-    [[nodiscard]]
-    std::optional<KeyValuePair> parseKeyValue(std::string_view arg) const
-    {
-        if (!config.allowKeyValueSyntax) {
-            return std::nullopt;
-        }
+    ARG_DECL std::vector<err::Error> interpret(
+        std::span<const std::string_view> args, bool& helpRequested);
 
-        auto sep = arg.find(config.keyValueSeparator);
-        if (sep == std::string_view::npos) {
-            return std::nullopt;
-        }
+    ARG_DECL void checkConstraints(
+        const internal::OptionSet& given,
+        std::vector<err::Error>& errors) const;
 
-        KeyValuePair keyValue;
-        keyValue.key = arg.substr(0, sep);
-        if (sep + 1 < arg.size()) {
-            keyValue.value = arg.substr(sep + 1);
-        }
-        return keyValue;
-    }
+    [[nodiscard]]
+    ARG_DECL uint64_t cacheKey(std::span<const std::string_view> args) const;
 
-    std::optional<KeyPack> parsePack(std::string_view arg)
-    {
-        if (!config.allowArgumentPacking) {
-            return std::nullopt;
-        }
+    ARG_DECL bool loadCache(uint64_t key);
+    ARG_DECL void saveCache(uint64_t key) const;
 
-        if (arg.find(config.packPrefix) != 0) {
-            return std::nullopt;
-        }
+    [[nodiscard]] ARG_DECL size_t helpWidth() const;
+    ARG_DECL const internal::HelpCache& helpCache(size_t width) const;
+    [[nodiscard]]
+    ARG_DECL err::Error unknownHelpSection(std::string_view section) const;
 
-        KeyPack keyPack;
-        size_t i = config.packPrefix.length();
-        for (; i < arg.length(); i++) {
-            auto key = config.packPrefix + arg.at(i);
-            auto* option = findOption(key);
-            if (!option) {
-                return std::nullopt;
-            }
+    [[nodiscard]] ARG_DECL uint64_t imageFingerprint() const;
+    ARG_DECL bool adoptImage(
+        std::shared_ptr<const internal::ParserImage> image);
 
-            keyPack.keys.push_back(key);
-            if (option->hasArgument() && i + 1 < arg.length()) {
-                keyPack.leftover = arg.substr(i + 1);
-                return keyPack;
-            }
-        }
-        return keyPack;
-    }
+    // The loaded image, unless options were added or changed or the pack
+    // prefix changed since it was loaded
+    [[nodiscard]] ARG_DECL const internal::ParserImage* currentImage() const;
 
-    std::vector<std::unique_ptr<KeyAdapter>> _options;
+    // Options by id. Most are owned here, flags of sets by _flagSets.
+    std::vector<KeyAdapter*> _options;
+    std::vector<std::unique_ptr<KeyAdapter>> _ownedOptions;
+    std::vector<std::unique_ptr<internal::FlagSetOptions>> _flagSets;
     std::vector<std::unique_ptr<ArgumentAdapter>> _arguments;
-    size_t _position = 0;
     std::vector<std::string> _leftovers;
     std::string _programName = "<program>";
     std::vector<std::string> _helpKeys;
+    std::string _helpSection;
+    std::vector<internal::Constraint> _constraints;
+    std::unordered_map<std::string_view, uint32_t> _optionIds;
+    size_t _optionIdsIndexed = 0;
+    uint64_t _cacheInputs = 0;
+    const internal::Registration* _registered = nullptr;
+    mutable std::shared_ptr<const internal::ParserImage> _image;
+    mutable uint64_t _imageGeneration = 0;
+    mutable std::unique_ptr<internal::HelpCache> _help;
 };
 
 namespace internal {
 
-inline Parser globalParser;
+// Created on first use, so that options can be defined from static
+// initializers in any translation unit
+inline Parser& globalParser()
+{
+    static Parser parser;
+    return parser;
+}
 
 } // namespace internal
 
 inline Flag flag()
 {
-    return internal::globalParser.flag();
+    return internal::globalParser().flag();
 }
 
 inline MultiFlag multiFlag()
 {
-    return internal::globalParser.multiFlag();
+    return internal::globalParser().multiFlag();
+}
+
+inline FlagSet::Member flag(FlagSet& set)
+{
+    return internal::globalParser().flag(set);
 }
 
 template <class T>
 Option<T> option()
 {
-    return internal::globalParser.option<T>();
+    return internal::globalParser().option<T>();
+}
+
+template <class T>
+ListOption<T> listOption()
+{
+    return internal::globalParser().listOption<T>();
 }
 
 template <class T>
 MultiOption<T> multiOption()
 {
-    return internal::globalParser.multiOption<T>();
+    return internal::globalParser().multiOption<T>();
 }
 
 template <class T>
 Value<T> argument()
 {
-    return internal::globalParser.argument<T>();
+    return internal::globalParser().argument<T>();
 }
 
 template <class T>
 MultiValue<T> multiArgument()
 {
-    return internal::globalParser.multiArgument<T>();
+    return internal::globalParser().multiArgument<T>();
 }
 
 template <class... Args>
 void helpKeys(Args&&... args)
 {
-    internal::globalParser.helpKeys(std::forward<Args>(args)...);
+    internal::globalParser().helpKeys(std::forward<Args>(args)...);
 }
 
-inline void printHelp(std::ostream& output = std::cout)
+template <class... Keys>
+void mutuallyExclusive(const Keys&... options)
 {
-    internal::globalParser.printHelp(output);
+    internal::globalParser().attachRegistered();
+    internal::globalParser().mutuallyExclusive(options...);
 }
 
-inline void parse(int argc, char** argv)
+template <class... Keys>
+void exactlyOne(const Keys&... options)
 {
-    return internal::globalParser.parse(argc, argv);
+    internal::globalParser().attachRegistered();
+    internal::globalParser().exactlyOne(options...);
 }
 
-inline const std::vector<std::string>& leftovers()
+template <class Key, class... Keys>
+void dependsOn(const Key& option, const Keys&... dependencies)
 {
-    return internal::globalParser.leftovers();
+    internal::globalParser().attachRegistered();
+    internal::globalParser().dependsOn(option, dependencies...);
 }
 
+ARG_DECL void printHelp();
+ARG_DECL void printHelp(std::ostream& output);
+ARG_DECL void parse(int argc, char** argv);
+ARG_DECL const std::vector<std::string>& leftovers();
+
 } // namespace arg
+
+#if !defined(ARG_SEPARATE_COMPILATION)
+#include "arg/impl/cache.ipp"
+#include "arg/impl/events.ipp"
+#include "arg/impl/help.ipp"
+#include "arg/impl/image.ipp"
+#include "arg/impl/parser.ipp"
+#endif
@@ -0,0 +1,329 @@
+#pragma once
+
+#include "arg/adapters.hpp"
+#include "arg/config.hpp"
+#include "arg/converters.hpp"
+#include "arg/formatters.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// Options defined next to the code that uses them, in any translation unit,
+// and attached to the global parser on the first arg::parse:
+//
+//     ARG_DEFINE_INT(threads, "--threads", 4, "Number of worker threads");
+//
+//     void startWorkers()
+//     {
+//         for (int i = 0; i < *threads; i++) { ... }
+//     }
+//
+// Other translation units refer to the option with ARG_DECLARE_INT(threads).
+//
+// The definitions are constant-initialized, so they cost no allocations and
+// reading one is safe from any initializer: before parsing it holds its
+// default. Linking a definition into the list of options is a dynamic
+// initializer of its translation unit, though, and those run in no set
+// order across translation units. A parse from main() or later sees every
+// option of the program; a parse from another static initializer may run
+// before some options are linked and treat their keys as unknown. Options
+// linked after a parse, such as those of a library loaded later, are
+// attached on the next one.
+
+#define ARG_DEFINE(type, name, key, defaultValue, help)                      \
+    constinit ::arg::Registered<type> name{key, defaultValue, help};         \
+    [[maybe_unused]] static const bool argRegistered_##name = name.link()
+
+#define ARG_DECLARE(type, name) extern ::arg::Registered<type> name
+
+#define ARG_DEFINE_BOOL(name, key, defaultValue, help)                       \
+    ARG_DEFINE(bool, name, key, defaultValue, help)
+#define ARG_DEFINE_INT(name, key, defaultValue, help)                        \
+    ARG_DEFINE(int, name, key, defaultValue, help)
+#define ARG_DEFINE_INT64(name, key, defaultValue, help)                      \
+    ARG_DEFINE(int64_t, name, key, defaultValue, help)
+#define ARG_DEFINE_UINT64(name, key, defaultValue, help)                     \
+    ARG_DEFINE(uint64_t, name, key, defaultValue, help)
+#define ARG_DEFINE_DOUBLE(name, key, defaultValue, help)                     \
+    ARG_DEFINE(double, name, key, defaultValue, help)
+#define ARG_DEFINE_STRING(name, key, defaultValue, help)                     \
+    ARG_DEFINE(std::string, name, key, defaultValue, help)
+
+#define ARG_DECLARE_BOOL(name) ARG_DECLARE(bool, name)
+#define ARG_DECLARE_INT(name) ARG_DECLARE(int, name)
+#define ARG_DECLARE_INT64(name) ARG_DECLARE(int64_t, name)
+#define ARG_DECLARE_UINT64(name) ARG_DECLARE(uint64_t, name)
+#define ARG_DECLARE_DOUBLE(name) ARG_DECLARE(double, name)
+#define ARG_DECLARE_STRING(name) ARG_DECLARE(std::string, name)
+
+namespace arg {
+
+namespace internal {
+
+class Registration;
+
+// Head of the list of registered options. Constant-initialized, so it is
+// valid before any dynamic initializer runs.
+inline constinit std::atomic<Registration*> registrations = nullptr;
+
+// A registered option: an intrusive list node that also knows how to store
+// values into its option
+class Registration {
+public:
+    constexpr Registration(std::string_view key, std::string_view help)
+        : _key(key)
+        , _help(help)
+    { }
+
+    Registration(const Registration&) = delete;
+    Registration& operator=(const Registration&) = delete;
+
+    // Prepends the option to the global list. Called once, from the dynamic
+    // initializer that ARG_DEFINE adds; the return value only exists to make
+    // that possible.
+    bool link() noexcept
+    {
+        if (!_linked) {
+            _linked = true;
+            _next = registrations.load(std::memory_order_relaxed);
+            while (!registrations.compare_exchange_weak(
+                    _next, this,
+                    std::memory_order_release, std::memory_order_relaxed)) {
+            }
+        }
+        return true;
+    }
+
+    [[nodiscard]] Registration* next() const
+    {
+        return _next;
+    }
+
+    [[nodiscard]] std::span<const std::string_view> keys() const
+    {
+        return {&_key, 1};
+    }
+
+    [[nodiscard]] std::string_view help() const
+    {
+        return _help;
+    }
+
+    [[nodiscard]] virtual bool hasArgument() const = 0;
+    [[nodiscard]] virtual bool isSet() const = 0;
+    virtual void raise() = 0;
+    virtual bool addValue(std::string_view input) = 0;
+    virtual bool formatValue(std::string& output) const = 0;
+
+protected:
+    ~Registration() = default;
+
+private:
+    std::string_view _key;
+    std::string_view _help;
+    Registration* _next = nullptr;
+    bool _linked = false;
+};
+
+// Connects a registered option to a parser
+class RegisteredAdapter : public KeyAdapter {
+public:
+    explicit RegisteredAdapter(Registration* registration)
+        : _registration(registration)
+    { }
+
+    [[nodiscard]] bool hasArgument() const override
+    {
+        return _registration->hasArgument();
+    }
+
+    [[nodiscard]] bool isRequired() const override
+    {
+        return false;
+    }
+
+    [[nodiscard]] bool isSet() const override
+    {
+        return _registration->isSet();
+    }
+
+    [[nodiscard]] std::span<const std::string_view> keys() const override
+    {
+        return _registration->keys();
+    }
+
+    [[nodiscard]] std::string_view metavar() const override
+    {
+        return hasArgument() ? "VALUE" : "";
+    }
+
+    [[nodiscard]] std::string_view help() const override
+    {
+        return _registration->help();
+    }
+
+    [[nodiscard]] bool multi() const override
+    {
+        return false;
+    }
+
+    [[nodiscard]] std::vector<std::string_view> choices() const override
+    {
+        return {};
+    }
+
+    void raise() override
+    {
+        _registration->raise();
+    }
+
+    bool addValue(std::string_view s) override
+    {
+        return _registration->addValue(s);
+    }
+
+    [[nodiscard]] size_t valueCount() const override
+    {
+        return isSet() ? 1 : 0;
+    }
+
+    bool formatValue(size_t, std::string& output) const override
+    {
+        return _registration->formatValue(output);
+    }
+
+private:
+    Registration* _registration;
+};
+
+} // namespace internal
+
+// Value of an option defined with ARG_DEFINE_*. A bool option is a flag.
+template <class T>
+class Registered final : public internal::Registration {
+public:
+    constexpr Registered(
+            std::string_view key, T defaultValue, std::string_view help)
+        : Registration(key, help)
+        , _value(std::move(defaultValue))
+    { }
+
+    [[nodiscard]] bool isSet() const override
+    {
+        return _set;
+    }
+
+    const T& operator*() const
+    {
+        return _value;
+    }
+
+    const T* operator->() const
+    {
+        return &_value;
+    }
+
+    operator const T&() const
+    {
+        return _value;
+    }
+
+private:
+    [[nodiscard]] bool hasArgument() const override
+    {
+        return !std::is_same_v<T, bool>;
+    }
+
+    void raise() override
+    {
+        if constexpr (std::is_same_v<T, bool>) {
+            _value = true;
+            _set = true;
+        } else {
+            internal::logicError("Registered's raise must not be called");
+        }
+    }
+
+    bool addValue(std::string_view input) override
+    {
+        auto value = T{};
+        if (!read(input, value)) {
+            return false;
+        }
+        _value = std::move(value);
+        _set = true;
+        return true;
+    }
+
+    bool formatValue(std::string& output) const override
+    {
+        return write(_value, output);
+    }
+
+    T _value;
+    bool _set = false;
+};
+
+// Strings keep their default as a view, so that a long default does not
+// need an allocation during constant initialization
+template <>
+class Registered<std::string> final : public internal::Registration {
+public:
+    constexpr Registered(
+            std::string_view key,
+            std::string_view defaultValue,
+            std::string_view help)
+        : Registration(key, help)
+        , _default(defaultValue)
+    { }
+
+    [[nodiscard]] bool isSet() const override
+    {
+        return _set;
+    }
+
+    std::string_view operator*() const
+    {
+        return _set ? std::string_view{_value} : _default;
+    }
+
+    operator std::string_view() const
+    {
+        return **this;
+    }
+
+private:
+    [[nodiscard]] bool hasArgument() const override
+    {
+        return true;
+    }
+
+    void raise() override
+    {
+        internal::logicError("Registered's raise must not be called");
+    }
+
+    bool addValue(std::string_view input) override
+    {
+        _value.assign(input);
+        _set = true;
+        return true;
+    }
+
+    bool formatValue(std::string& output) const override
+    {
+        output += **this;
+        return true;
+    }
+
+    std::string_view _default;
+    std::string _value;
+    bool _set = false;
+};
+
+} // namespace arg
@@ -0,0 +1,261 @@
+#pragma once
+
+#include "arg/config.hpp"
+#include "arg/errors.hpp"
+#include "arg/parser.hpp"
+#include "arg/schema.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace arg {
+
+namespace internal {
+
+// Reads a whole file. Returns false if it cannot be read.
+ARG_DECL bool readFile(const std::string& path, std::string& contents);
+
+// Splits the contents of an arguments file into tokens: one or more tokens
+// per line, separated by whitespace. Lines starting with '#' are comments.
+ARG_DECL std::vector<std::string_view> splitArgs(std::string_view text);
+
+// Calls onChange from a background thread whenever the file at path is
+// written or replaced. Uses inotify on Linux, and polls the modification
+// time elsewhere.
+class FileWatcher {
+public:
+    ARG_DECL FileWatcher(std::string path, std::function<void()> onChange);
+    ARG_DECL ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+private:
+    struct State;
+    std::unique_ptr<State> _state;
+};
+
+} // namespace internal
+
+// Options that can change while the program runs. The values live in an
+// immutable snapshot of Config; a reload parses into a new snapshot and swaps
+// it in atomically, so readers never see a half-updated configuration:
+//
+//     auto live = arg::Reloadable<Config>{schema, schema.parse(argc, argv)};
+//     live.watch("/etc/server/args");
+//
+//     // in each worker thread
+//     auto config = live.reader();
+//     for (;;) {
+//         serve(config->rateLimit);
+//         config.quiescent();
+//     }
+//
+// A reader keeps seeing the snapshot it was created with, and moves to the
+// newest one only in quiescent(), so all reads between two calls come from
+// one snapshot. Replaced snapshots are freed once every reader has called
+// quiescent() after the swap, so a reader must not keep references into a
+// snapshot across quiescent().
+template <class Config>
+class Reloadable {
+public:
+    class Reader {
+    public:
+        Reader(Reader&& other) noexcept
+            : _owner(std::exchange(other._owner, nullptr))
+            , _slot(std::exchange(other._slot, nullptr))
+            , _config(std::exchange(other._config, nullptr))
+        { }
+
+        Reader& operator=(Reader&&) = delete;
+
+        ~Reader()
+        {
+            if (_owner) {
+                _owner->unregister(_slot);
+            }
+        }
+
+        const Config& operator*() const
+        {
+            return *_config;
+        }
+
+        const Config* operator->() const
+        {
+            return _config;
+        }
+
+        // Tells that this reader holds no references into snapshots, and
+        // moves it to the newest one. The generation is read first: a
+        // snapshot published after it is retired with a later generation,
+        // so the one pinned here stays alive until the next call.
+        void quiescent()
+        {
+            _slot->store(
+                _owner->_generation.load(std::memory_order_acquire),
+                std::memory_order_release);
+            _config = _owner->_current.load(std::memory_order_acquire);
+        }
+
+    private:
+        friend class Reloadable;
+
+        Reader(
+                Reloadable* owner,
+                std::atomic<uint64_t>* slot,
+                const Config* config)
+            : _owner(owner)
+            , _slot(slot)
+            , _config(config)
+        { }
+
+        Reloadable* _owner;
+        std::atomic<uint64_t>* _slot;
+        const Config* _config;
+    };
+
+    // Reloads start from base, so an option removed from the arguments file
+    // gets its base value back
+    Reloadable(Schema<Config>& schema, Config base)
+        : _schema(schema)
+        , _base(std::move(base))
+        , _current(new Config(_base))
+    { }
+
+    Reloadable(const Reloadable&) = delete;
+    Reloadable& operator=(const Reloadable&) = delete;
+
+    // All readers must be gone by now
+    ~Reloadable()
+    {
+        _watcher.reset();
+        delete _current.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] Reader reader()
+    {
+        auto lock = std::lock_guard{_mutex};
+        auto& slot = _slots.emplace_back(
+            std::make_unique<std::atomic<uint64_t>>(
+                _generation.load(std::memory_order_relaxed)));
+        return Reader{
+            this, slot.get(), _current.load(std::memory_order_acquire)};
+    }
+
+    // Parses args on top of the base configuration and publishes the
+    // result. On errors the current snapshot stays, and the errors are
+    // returned.
+    std::vector<err::Error> reload(internal::Range auto&& args)
+    {
+        auto lock = std::lock_guard{_mutex};
+        auto next = std::make_unique<Config>(_base);
+        auto errors = _schema.tryParseInto(*next, args);
+        if (errors.empty()) {
+            publish(std::move(next));
+        }
+        return errors;
+    }
+
+    std::vector<err::Error> reloadFile(const std::string& path)
+    {
+        std::string contents;
+        if (!internal::readFile(path, contents)) {
+            return {err::FileNotReadable{path}};
+        }
+        return reload(internal::splitArgs(contents));
+    }
+
+    // Reloads from the file now and on every later change to it. Errors are
+    // printed to std::cerr, and leave the current snapshot in place. Throws
+    // std::system_error if the file cannot be watched; without exceptions,
+    // that is printed too, and the file is only read once.
+    void watch(const std::string& path)
+    {
+        auto reloadAndReport = [this, path] {
+            for (const auto& error : reloadFile(path)) {
+                err::print(std::cerr, error);
+            }
+        };
+        _watcher.reset();
+        reloadAndReport();
+        _watcher = std::make_unique<internal::FileWatcher>(
+            path, std::move(reloadAndReport));
+    }
+
+    // Frees replaced snapshots that no reader can still see. Reloads do this
+    // too, so it is only needed to release memory between reloads.
+    void collect()
+    {
+        auto lock = std::lock_guard{_mutex};
+        collectLocked();
+    }
+
+    // Number of replaced snapshots that are not freed yet
+    [[nodiscard]] size_t retired() const
+    {
+        auto lock = std::lock_guard{_mutex};
+        return _retired.size();
+    }
+
+private:
+    struct Retired {
+        uint64_t generation;
+        std::unique_ptr<const Config> config;
+    };
+
+    void publish(std::unique_ptr<Config> next)
+    {
+        auto old = std::unique_ptr<const Config>{
+            _current.exchange(next.release(), std::memory_order_acq_rel)};
+        auto generation =
+            _generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+        _retired.push_back(Retired{generation, std::move(old)});
+        collectLocked();
+    }
+
+    void collectLocked()
+    {
+        auto oldest = _generation.load(std::memory_order_relaxed);
+        for (const auto& slot : _slots) {
+            oldest = std::min(oldest, slot->load(std::memory_order_acquire));
+        }
+        std::erase_if(_retired, [oldest] (const Retired& retired) {
+            return retired.generation <= oldest;
+        });
+    }
+
+    void unregister(std::atomic<uint64_t>* slot)
+    {
+        auto lock = std::lock_guard{_mutex};
+        std::erase_if(_slots, [slot] (const auto& other) {
+            return other.get() == slot;
+        });
+        collectLocked();
+    }
+
+    Schema<Config>& _schema;
+    const Config _base;
+    std::atomic<const Config*> _current;
+    std::atomic<uint64_t> _generation = 0;
+
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<std::atomic<uint64_t>>> _slots;
+    std::vector<Retired> _retired;
+    std::unique_ptr<internal::FileWatcher> _watcher;
+};
+
+} // namespace arg
+
+#if !defined(ARG_SEPARATE_COMPILATION)
+#include "arg/impl/reload.ipp"
+#endif
@@ -0,0 +1,443 @@
+#pragma once
+
+#include "arg/adapters.hpp"
+#include "arg/arguments.hpp"
+#include "arg/errors.hpp"
+#include "arg/parser.hpp"
+
+#include <algorithm>
+#include <concepts>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace arg {
+
+namespace internal {
+
+// The struct being filled by the current parse, shared by all adapters of a
+// schema. set[i] tells whether the field with id i was given on this parse.
+// Defaults given on handles are copied into the struct before each parse.
+template <class Config>
+struct Binding {
+    Config* config = nullptr;
+    std::vector<bool> set;
+    std::vector<std::function<void(Config&)>> defaults;
+};
+
+template <class Config>
+class MemberFlagAdapter : public FlagAdapter {
+public:
+    MemberFlagAdapter(
+            Flag&& flag,
+            bool Config::* member,
+            std::shared_ptr<Binding<Config>> binding)
+        : FlagAdapter(std::move(flag))
+        , _member(member)
+        , _binding(std::move(binding))
+    { }
+
+    void raise() override
+    {
+        _binding->config->*_member = true;
+    }
+
+protected:
+    [[nodiscard]] bool stored() const override
+    {
+        return _binding->config->*_member;
+    }
+
+private:
+    bool Config::* _member;
+    std::shared_ptr<Binding<Config>> _binding;
+};
+
+template <class Config, class Count>
+class MemberMultiFlagAdapter : public MultiFlagAdapter {
+public:
+    MemberMultiFlagAdapter(
+            MultiFlag&& multiFlag,
+            Count Config::* member,
+            std::shared_ptr<Binding<Config>> binding)
+        : MultiFlagAdapter(std::move(multiFlag))
+        , _member(member)
+        , _binding(std::move(binding))
+    { }
+
+    void raise() override
+    {
+        ++(_binding->config->*_member);
+    }
+
+protected:
+    [[nodiscard]] size_t stored() const override
+    {
+        return static_cast<size_t>(_binding->config->*_member);
+    }
+
+private:
+    Count Config::* _member;
+    std::shared_ptr<Binding<Config>> _binding;
+};
+
+template <class Config, class T>
+class MemberOptionAdapter : public OptionAdapter<T> {
+public:
+    MemberOptionAdapter(
+            Option<T>&& option,
+            T Config::* member,
+            std::shared_ptr<Binding<Config>> binding)
+        : OptionAdapter<T>(std::move(option))
+        , _member(member)
+        , _binding(std::move(binding))
+        , _id(_binding->set.size())
+    {
+        _binding->set.push_back(false);
+    }
+
+    [[nodiscard]] bool isSet() const override
+    {
+        return _binding->set[_id];
+    }
+
+protected:
+    [[nodiscard]] void* target() const override
+    {
+        return &(_binding->config->*_member);
+    }
+
+    void markSet() override
+    {
+        _binding->set[_id] = true;
+    }
+
+private:
+    T Config::* _member;
+    std::shared_ptr<Binding<Config>> _binding;
+    size_t _id;
+};
+
+template <class Config, class T>
+class MemberListOptionAdapter : public ListOptionAdapter<T> {
+public:
+    MemberListOptionAdapter(
+            ListOption<T>&& listOption,
+            std::vector<T> Config::* member,
+            std::shared_ptr<Binding<Config>> binding)
+        : ListOptionAdapter<T>(std::move(listOption))
+        , _member(member)
+        , _binding(std::move(binding))
+        , _id(_binding->set.size())
+    {
+        _binding->set.push_back(false);
+    }
+
+    [[nodiscard]] bool isSet() const override
+    {
+        return _binding->set[_id];
+    }
+
+protected:
+    [[nodiscard]] void* target() const override
+    {
+        return &(_binding->config->*_member);
+    }
+
+    void markSet() override
+    {
+        _binding->set[_id] = true;
+    }
+
+private:
+    std::vector<T> Config::* _member;
+    std::shared_ptr<Binding<Config>> _binding;
+    size_t _id;
+};
+
+template <class Config, class T>
+class MemberMultiOptionAdapter : public MultiOptionAdapter<T> {
+public:
+    MemberMultiOptionAdapter(
+            MultiOption<T>&& multiOption,
+            std::vector<T> Config::* member,
+            std::shared_ptr<Binding<Config>> binding)
+        : MultiOptionAdapter<T>(std::move(multiOption))
+        , _member(member)
+        , _binding(std::move(binding))
+    { }
+
+protected:
+    [[nodiscard]] void* target() const override
+    {
+        return &(_binding->config->*_member);
+    }
+
+private:
+    std::vector<T> Config::* _member;
+    std::shared_ptr<Binding<Config>> _binding;
+};
+
+template <class Config, class T>
+class MemberValueAdapter : public ValueAdapter<T> {
+public:
+    MemberValueAdapter(
+            Value<T>&& value,
+            T Config::* member,
+            std::shared_ptr<Binding<Config>> binding)
+        : ValueAdapter<T>(std::move(value))
+        , _member(member)
+        , _binding(std::move(binding))
+        , _id(_binding->set.size())
+    {
+        _binding->set.push_back(false);
+    }
+
+    [[nodiscard]] bool isSet() const override
+    {
+        return _binding->set[_id];
+    }
+
+protected:
+    [[nodiscard]] void* target() const override
+    {
+        return &(_binding->config->*_member);
+    }
+
+    void markSet() override
+    {
+        _binding->set[_id] = true;
+    }
+
+private:
+    T Config::* _member;
+    std::shared_ptr<Binding<Config>> _binding;
+    size_t _id;
+};
+
+template <class Config, class T>
+class MemberMultiValueAdapter : public MultiValueAdapter<T> {
+public:
+    MemberMultiValueAdapter(
+            MultiValue<T>&& multiValue,
+            std::vector<T> Config::* member,
+            std::shared_ptr<Binding<Config>> binding)
+        : MultiValueAdapter<T>(std::move(multiValue))
+        , _member(member)
+        , _binding(std::move(binding))
+    { }
+
+protected:
+    [[nodiscard]] void* target() const override
+    {
+        return &(_binding->config->*_member);
+    }
+
+private:
+    std::vector<T> Config::* _member;
+    std::shared_ptr<Binding<Config>> _binding;
+};
+
+} // namespace internal
+
+// Schema maps command-line keys to the members of a plain struct. Parsing
+// writes converted values straight into the struct, so the application can
+// keep a flat copy of its configuration and drop the handles altogether:
+//
+//     struct Config {
+//         int threads = 4;
+//         bool verbose = false;
+//     };
+//
+//     auto schema = arg::Schema<Config>{};
+//     schema.option(&Config::threads).keys("-t", "--threads");
+//     schema.flag(&Config::verbose).keys("-v");
+//     Config config = schema.parse(argc, argv);
+//
+// Defaults are taken from the struct itself; members that are not given on
+// the command line keep their values. A defaultValue given on a handle
+// replaces the member's value before each parse.
+template <class Config>
+class Schema {
+public:
+    Flag flag(bool Config::* member)
+    {
+        auto flag = Flag{};
+        _parser.attach(std::make_unique<internal::MemberFlagAdapter<Config>>(
+            Flag{flag}, member, _binding));
+        return flag;
+    }
+
+    template <std::integral Count>
+    MultiFlag multiFlag(Count Config::* member)
+    {
+        auto multiFlag = MultiFlag{};
+        _parser.attach(
+            std::make_unique<internal::MemberMultiFlagAdapter<Config, Count>>(
+                MultiFlag{multiFlag}, member, _binding));
+        return multiFlag;
+    }
+
+    template <class T>
+    Option<T> option(T Config::* member)
+    {
+        auto option = Option<T>{};
+        _parser.attach(
+            std::make_unique<internal::MemberOptionAdapter<Config, T>>(
+                Option<T>{option}, member, _binding));
+        addDefault(option, member);
+        return option;
+    }
+
+    template <class T>
+    ListOption<T> listOption(std::vector<T> Config::* member)
+    {
+        auto listOption = ListOption<T>{};
+        _parser.attach(
+            std::make_unique<internal::MemberListOptionAdapter<Config, T>>(
+                ListOption<T>{listOption}, member, _binding));
+        addDefault(listOption, member);
+        return listOption;
+    }
+
+    template <class T>
+    MultiOption<T> multiOption(std::vector<T> Config::* member)
+    {
+        auto multiOption = MultiOption<T>{};
+        _parser.attach(
+            std::make_unique<internal::MemberMultiOptionAdapter<Config, T>>(
+                MultiOption<T>{multiOption}, member, _binding));
+        return multiOption;
+    }
+
+    template <class T>
+    Value<T> argument(T Config::* member)
+    {
+        auto value = Value<T>{};
+        _parser.attach(
+            std::make_unique<internal::MemberValueAdapter<Config, T>>(
+                Value<T>{value}, member, _binding));
+        addDefault(value, member);
+        return value;
+    }
+
+    template <class T>
+    MultiValue<T> multiArgument(std::vector<T> Config::* member)
+    {
+        auto multiValue = MultiValue<T>{};
+        _parser.attach(
+            std::make_unique<internal::MemberMultiValueAdapter<Config, T>>(
+                MultiValue<T>{multiValue}, member, _binding));
+        return multiValue;
+    }
+
+    template <class... Args>
+    void helpKeys(Args&&... args)
+    {
+        _parser.helpKeys(std::forward<Args>(args)...);
+    }
+
+    template <class... Keys>
+    void mutuallyExclusive(const Keys&... options)
+    {
+        _parser.mutuallyExclusive(options...);
+    }
+
+    template <class... Keys>
+    void exactlyOne(const Keys&... options)
+    {
+        _parser.exactlyOne(options...);
+    }
+
+    template <class Key, class... Keys>
+    void dependsOn(const Key& option, const Keys&... dependencies)
+    {
+        _parser.dependsOn(option, dependencies...);
+    }
+
+    void printHelp() const
+    {
+        _parser.printHelp();
+    }
+
+    void printHelp(std::ostream& output) const
+    {
+        _parser.printHelp(output);
+    }
+
+    void parseInto(Config& config, int argc, char** argv)
+    {
+        bind(config);
+        _parser.parse(argc, argv);
+        _binding->config = nullptr;
+    }
+
+    void parseInto(Config& config, internal::Range auto&& args)
+    {
+        bind(config);
+        _parser.parse(args);
+        _binding->config = nullptr;
+    }
+
+    // Parses into config without exiting on errors, see Parser::tryParse
+    [[nodiscard]] std::vector<err::Error> tryParseInto(
+        Config& config, internal::Range auto&& args)
+    {
+        bind(config);
+        auto errors = _parser.tryParse(args);
+        _binding->config = nullptr;
+        return errors;
+    }
+
+    Config parse(int argc, char** argv)
+    {
+        auto config = Config{};
+        parseInto(config, argc, argv);
+        return config;
+    }
+
+    Config parse(internal::Range auto&& args)
+    {
+        auto config = Config{};
+        parseInto(config, args);
+        return config;
+    }
+
+    [[nodiscard]] const std::vector<std::string>& leftovers() const
+    {
+        return _parser.leftovers();
+    }
+
+    Parser::Config& config()
+    {
+        return _parser.config;
+    }
+
+private:
+    template <class Handle, class Member>
+    void addDefault(const Handle& handle, Member Config::* member)
+    {
+        _binding->defaults.push_back([handle, member] (Config& config) {
+            if (handle.hasDefault()) {
+                config.*member = *handle;
+            }
+        });
+    }
+
+    void bind(Config& config)
+    {
+        _binding->config = &config;
+        std::fill(_binding->set.begin(), _binding->set.end(), false);
+        for (const auto& setDefault : _binding->defaults) {
+            setDefault(config);
+        }
+    }
+
+    Parser _parser;
+    std::shared_ptr<internal::Binding<Config>> _binding =
+        std::make_shared<internal::Binding<Config>>();
+};
+
+} // namespace arg
@@ -0,0 +1,483 @@
+#pragma once
+
+#include "arg/arguments.hpp"
+#include "arg/config.hpp"
+#include "arg/converters.hpp"
+#include "arg/impl/tokenizer.hpp"
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <span>
+#include <string_view>
+
+namespace arg {
+
+namespace internal {
+
+// A vector whose capacity is fixed at compile time and whose elements live
+// inside it. Going past the capacity is a programming error.
+template <class T, size_t N>
+class InplaceVector {
+public:
+    [[nodiscard]] constexpr size_t size() const
+    {
+        return _size;
+    }
+
+    [[nodiscard]] static constexpr size_t capacity()
+    {
+        return N;
+    }
+
+    [[nodiscard]] constexpr bool empty() const
+    {
+        return _size == 0;
+    }
+
+    [[nodiscard]] constexpr bool full() const
+    {
+        return _size == N;
+    }
+
+    constexpr T& push_back(const T& value)
+    {
+        if (full()) {
+            logicError("InplaceVector is full");
+        }
+        _items[_size] = value;
+        return _items[_size++];
+    }
+
+    constexpr void clear()
+    {
+        _size = 0;
+    }
+
+    constexpr T& operator[](size_t index)
+    {
+        return _items[index];
+    }
+
+    constexpr const T& operator[](size_t index) const
+    {
+        return _items[index];
+    }
+
+    constexpr T* begin()
+    {
+        return _items.data();
+    }
+
+    constexpr T* end()
+    {
+        return _items.data() + _size;
+    }
+
+    constexpr const T* begin() const
+    {
+        return _items.data();
+    }
+
+    constexpr const T* end() const
+    {
+        return _items.data() + _size;
+    }
+
+private:
+    std::array<T, N> _items{};
+    size_t _size = 0;
+};
+
+// Value types that can be read without allocating. Strings are read as
+// views into the arguments, which must outlive them.
+template <class T>
+concept StaticValue =
+    std::same_as<T, std::string_view> || (HasConverter<T> && !Text<T>);
+
+template <StaticValue T>
+bool readStatic(std::string_view input, void* values, size_t index)
+{
+    auto& value = static_cast<T*>(values)[index];
+    if constexpr (std::same_as<T, std::string_view>) {
+        value = input;
+        return true;
+    } else {
+        return read(input, value);
+    }
+}
+
+} // namespace internal
+
+// The outcome of StaticParser::parse. The token points into the arguments
+// that were parsed, or names the missing argument.
+struct StaticResult {
+    enum class Status : uint8_t {
+        Ok,
+        Help,
+        UnknownOption,
+        MissingValue,
+        InvalidValue,
+        UnexpectedValue,
+        UnexpectedArgument,
+        TooManyValues,
+        MissingArgument,
+    };
+
+    Status status = Status::Ok;
+    std::string_view token;
+
+    explicit operator bool() const
+    {
+        return status == Status::Ok;
+    }
+};
+
+inline std::string_view describe(StaticResult::Status status)
+{
+    using Status = StaticResult::Status;
+    switch (status) {
+        case Status::Ok: return "ok";
+        case Status::Help: return "help requested";
+        case Status::UnknownOption: return "unknown option";
+        case Status::MissingValue: return "option value not given";
+        case Status::InvalidValue: return "invalid value";
+        case Status::UnexpectedValue: return "option takes no value";
+        case Status::UnexpectedArgument: return "unexpected argument";
+        case Status::TooManyValues: return "too many values";
+        case Status::MissingArgument: return "argument not given";
+    }
+    return "unknown status";
+}
+
+// Prints "arg: <what>: <token>" without allocating
+inline void print(std::FILE* output, const StaticResult& result)
+{
+    const auto what = describe(result.status);
+    std::fprintf(output, "arg: %.*s: %.*s\n",
+        static_cast<int>(what.size()), what.data(),
+        static_cast<int>(result.token.size()), result.token.data());
+}
+
+// A parser for code that may not allocate, such as embedded targets and
+// bootstrap code that runs before main. Its capacities are template
+// parameters, values go straight into variables the caller owns, and keys
+// and names are views that must outlive the parser, as string literals do.
+// Neither defining options nor parsing calls operator new:
+//
+//     constinit auto parser = arg::StaticParser<8, 2>{};
+//     bool verbose = false;
+//     int jobs = 1;
+//     parser.flag(verbose, "-v", "--verbose");
+//     parser.option(jobs, "-j", "--jobs");
+//     if (auto result = parser.parse(argc, argv); !result) { ... }
+//
+// Options are found by comparing keys one by one, which is the fastest way
+// for the handful of options such a parser holds.
+template <size_t MaxOptions, size_t MaxArguments = 4, size_t MaxKeys = 2>
+class StaticParser {
+public:
+    using Status = StaticResult::Status;
+
+    struct Config {
+        bool allowKeyValueSyntax = true;
+        std::string_view keyValueSeparator = "=";
+        bool allowArgumentPacking = true;
+        std::string_view packPrefix = "-";
+        std::string_view endOfOptions = "--";
+    };
+
+    Config config;
+
+    template <class... Keys>
+    requires (sizeof...(Keys) > 0)
+    void flag(bool& value, Keys... keys)
+    {
+        add(Kind::Flag, &value, nullptr, keys...);
+    }
+
+    // A flag that counts how many times it is given
+    template <std::integral T, class... Keys>
+    requires (sizeof...(Keys) > 0 && !std::same_as<T, bool>)
+    void multiFlag(T& count, Keys... keys)
+    {
+        add(Kind::Count, &count, +[] (void* target) {
+            ++*static_cast<T*>(target);
+        }, keys...);
+    }
+
+    template <internal::StaticValue T, class... Keys>
+    requires (sizeof...(Keys) > 0)
+    void option(T& value, Keys... keys)
+    {
+        auto& option = add(Kind::Value, &value, nullptr, keys...);
+        option.read = internal::readStatic<T>;
+    }
+
+    template <class... Keys>
+    requires (sizeof...(Keys) > 0)
+    void helpKeys(Keys... keys)
+    {
+        add(Kind::Help, nullptr, nullptr, keys...);
+    }
+
+    template <internal::StaticValue T>
+    void argument(T& value, std::string_view name, bool required = true)
+    {
+        _arguments.push_back(StaticArgument{
+            name, &value, internal::readStatic<T>, 1, nullptr, required});
+    }
+
+    // Collects the remaining arguments into buffer, setting count to the
+    // number of values given
+    template <internal::StaticValue T>
+    void multiArgument(
+        std::span<T> buffer, size_t& count, std::string_view name)
+    {
+        _arguments.push_back(StaticArgument{
+            name, buffer.data(), internal::readStatic<T>, buffer.size(),
+            &count, false});
+    }
+
+    // Parses the arguments after the program name
+    StaticResult parse(int argc, char* const* argv)
+    {
+        const auto count = argc > 1 ? static_cast<size_t>(argc - 1) : 0;
+        return parse(std::span<char* const>{argv + (count > 0), count});
+    }
+
+    template <internal::Range Args>
+    StaticResult parse(const Args& args)
+    {
+        const auto tokenizer = internal::TokenizerConfig{
+            config.allowArgumentPacking ?
+                config.packPrefix : std::string_view{},
+            config.allowKeyValueSyntax ?
+                config.keyValueSeparator : std::string_view{}};
+        for (auto& argument : _arguments) {
+            if (argument.count) {
+                *argument.count = 0;
+            }
+        }
+        size_t position = 0;
+        size_t given = 0;
+        bool optionsEnded = false;
+
+        auto it = std::begin(args);
+        const auto end = std::end(args);
+        auto nextValue = [&] (std::string_view& value) {
+            if (it == end) {
+                return false;
+            }
+            value = std::string_view{*it++};
+            return true;
+        };
+
+        while (it != end) {
+            const auto text = std::string_view{*it++};
+
+            if (!optionsEnded) {
+                const auto* option = find(text);
+                if (!option && !config.endOfOptions.empty() &&
+                        text == config.endOfOptions) {
+                    optionsEnded = true;
+                    continue;
+                }
+
+                if (option) {
+                    auto value = std::string_view{};
+                    if (option->kind == Kind::Value && !nextValue(value)) {
+                        return {Status::MissingValue, text};
+                    }
+                    if (auto result = apply(*option, text, value); !result) {
+                        return result;
+                    }
+                    continue;
+                }
+
+                const auto token = internal::classify(text, tokenizer);
+                if (token.kind == internal::Token::Kind::KeyValue) {
+                    if (const auto* option = find(token.key())) {
+                        if (option->kind != Kind::Value &&
+                                option->kind != Kind::Help) {
+                            return {Status::UnexpectedValue, text};
+                        }
+                        auto result = apply(*option, text, token.value());
+                        if (!result) {
+                            return result;
+                        }
+                        continue;
+                    }
+                }
+
+                if (token.prefixed) {
+                    // A run of flags, optionally ending with an option that
+                    // takes the rest of the token, or the next one, as value
+                    const auto keys = text.substr(tokenizer.packPrefix.size());
+                    size_t length = 0;
+                    const StaticOption* last = nullptr;
+                    while (length < keys.size()) {
+                        last = packed(keys[length]);
+                        if (!last) {
+                            break;
+                        }
+                        length++;
+                        if (last->kind == Kind::Value) {
+                            break;
+                        }
+                    }
+
+                    if (last && length > 0) {
+                        for (size_t i = 0; i + 1 < length; i++) {
+                            if (auto result = apply(
+                                    *packed(keys[i]), text, {}); !result) {
+                                return result;
+                            }
+                        }
+                        auto value = keys.substr(length);
+                        if (last->kind == Kind::Value) {
+                            if (value.empty() && !nextValue(value)) {
+                                return {Status::MissingValue, text};
+                            }
+                        } else if (!value.empty()) {
+                            return {Status::UnknownOption, text};
+                        }
+                        if (auto result = apply(*last, text, value); !result) {
+                            return result;
+                        }
+                        continue;
+                    }
+                }
+            }
+
+            if (position == _arguments.size()) {
+                return {Status::UnexpectedArgument, text};
+            }
+            auto& argument = _arguments[position];
+            if (given == argument.capacity) {
+                return {Status::TooManyValues, text};
+            }
+            if (!argument.read(text, argument.values, given)) {
+                return {Status::InvalidValue, text};
+            }
+            given++;
+            if (argument.count) {
+                *argument.count = given;
+            } else {
+                position++;
+                given = 0;
+            }
+        }
+
+        for (size_t i = position; i < _arguments.size(); i++) {
+            if (_arguments[i].required) {
+                return {Status::MissingArgument, _arguments[i].name};
+            }
+        }
+        return {};
+    }
+
+private:
+    enum class Kind : uint8_t {
+        Flag,
+        Count,
+        Value,
+        Help,
+    };
+
+    struct StaticOption {
+        std::array<std::string_view, MaxKeys> keys{};
+        size_t keyCount = 0;
+        Kind kind = Kind::Flag;
+        void* target = nullptr;
+        void (*raise)(void*) = nullptr;
+        bool (*read)(std::string_view, void*, size_t) = nullptr;
+    };
+
+    struct StaticArgument {
+        std::string_view name;
+        void* values = nullptr;
+        bool (*read)(std::string_view, void*, size_t) = nullptr;
+        size_t capacity = 0;
+        size_t* count = nullptr;
+        bool required = false;
+    };
+
+    template <class... Keys>
+    StaticOption& add(
+        Kind kind, void* target, void (*raise)(void*), Keys... keys)
+    {
+        static_assert(
+            sizeof...(Keys) <= MaxKeys, "more keys than the parser allows");
+        auto option = StaticOption{};
+        option.kind = kind;
+        option.target = target;
+        option.raise = raise;
+        ((option.keys[option.keyCount++] = std::string_view{keys}), ...);
+        return _options.push_back(option);
+    }
+
+    // Later definitions take precedence, as in Parser
+    [[nodiscard]] const StaticOption* find(std::string_view key) const
+    {
+        for (size_t i = _options.size(); i-- > 0; ) {
+            const auto& option = _options[i];
+            for (size_t k = 0; k < option.keyCount; k++) {
+                if (option.keys[k] == key) {
+                    return &option;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    [[nodiscard]] const StaticOption* packed(char c) const
+    {
+        const auto prefix = config.packPrefix;
+        for (size_t i = _options.size(); i-- > 0; ) {
+            const auto& option = _options[i];
+            if (option.kind == Kind::Help) {
+                continue;
+            }
+            for (size_t k = 0; k < option.keyCount; k++) {
+                const auto key = option.keys[k];
+                if (key.size() == prefix.size() + 1 && key.back() == c &&
+                        key.starts_with(prefix)) {
+                    return &option;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    StaticResult apply(
+        const StaticOption& option,
+        std::string_view text,
+        std::string_view value)
+    {
+        switch (option.kind) {
+            case Kind::Flag:
+                *static_cast<bool*>(option.target) = true;
+                break;
+            case Kind::Count:
+                option.raise(option.target);
+                break;
+            case Kind::Value:
+                if (!option.read(value, option.target, 0)) {
+                    return {Status::InvalidValue, text};
+                }
+                break;
+            case Kind::Help:
+                return {Status::Help, text};
+        }
+        return {};
+    }
+
+    internal::InplaceVector<StaticOption, MaxOptions> _options;
+    internal::InplaceVector<StaticArgument, MaxArguments> _arguments;
+};
+
+} // namespace arg
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "arg/config.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace arg::internal {
+
+// Process-wide store for the texts of option definitions: keys, help and
+// metavars. Texts are packed into large chunks and deduplicated, so equal
+// texts are stored once, and a definition only keeps views into the pool.
+// Key lists are stored the same way, as tables of views. Nothing is ever
+// freed, which is fine for texts that come from definitions.
+class TextPool {
+public:
+    ARG_DECL std::string_view intern(std::string_view text);
+    ARG_DECL std::span<const std::string_view> intern(
+        std::span<const std::string_view> texts);
+
+    // Total size of the chunks allocated so far
+    [[nodiscard]] ARG_DECL size_t bytes() const;
+
+private:
+    // Open-addressing hash set of records. A record is the size of its data,
+    // padded to `header` bytes, followed by the data.
+    struct Table {
+        explicit Table(size_t header)
+            : header(header)
+        { }
+
+        size_t header;
+        std::vector<const char*> slots;
+        size_t used = 0;
+    };
+
+    ARG_DECL const char* insert(Table& table, std::string_view data);
+    ARG_DECL void grow(Table& table);
+    ARG_DECL char* allocate(size_t size, size_t alignment);
+
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<char[]>> _chunks;
+    char* _next = nullptr;
+    size_t _left = 0;
+    size_t _bytes = 0;
+    Table _texts = Table{alignof(uint32_t)};
+    Table _lists = Table{alignof(std::string_view)};
+};
+
+ARG_DECL TextPool& textPool();
+
+// Counts changes made through handles to what a parser shows or matches:
+// keys, help, sections, metavars, choices and required. Parsers keep
+// derived state such as a loaded image or rendered help, and rebuild or
+// recheck it only when this has moved.
+ARG_DECL void schemaChanged();
+[[nodiscard]] ARG_DECL uint64_t schemaGeneration();
+
+template <class... Args>
+std::span<const std::string_view> internKeys(Args&&... args)
+{
+    if constexpr (sizeof...(Args) == 0) {
+        return {};
+    } else if constexpr (sizeof...(Args) == 1 && (Range<Args> && ...)) {
+        // Keys only known at run time, such as those read from a file
+        std::vector<std::string_view> keys;
+        for (const auto& key : (args, ...)) {
+            keys.emplace_back(key);
+        }
+        return textPool().intern(std::span<const std::string_view>{keys});
+    } else {
+        const std::string_view keys[] = {std::string_view{args}...};
+        return textPool().intern(std::span<const std::string_view>{keys});
+    }
+}
+
+} // namespace arg::internal
+
+#if !defined(ARG_SEPARATE_COMPILATION)
+#include "arg/impl/text.ipp"
+#endif
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "arg/converters.hpp"
+#include "arg/formatters.hpp"
+#include "arg/numbers.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace arg {
+
+// Number of bytes, written with an optional SI or IEC suffix: "512", "64k",
+// "4GiB", "1.5MB". The value must be a whole number of bytes.
+struct ByteSize {
+    uint64_t bytes = 0;
+
+    friend bool operator==(const ByteSize&, const ByteSize&) = default;
+};
+
+// Plain number with an optional SI or IEC multiplier: "10k", "2M", "16Ki".
+template <class T = uint64_t>
+struct Quantity {
+    T value = T{};
+
+    friend bool operator==(const Quantity&, const Quantity&) = default;
+};
+
+// Number of events per period of time: "10k/s", "500/min", "1.5M/h".
+struct Rate {
+    uint64_t count = 0;
+    std::chrono::nanoseconds period = std::chrono::seconds{1};
+
+    [[nodiscard]] double perSecond() const
+    {
+        return static_cast<double>(count) * 1e9 /
+            static_cast<double>(period.count());
+    }
+
+    friend bool operator==(const Rate&, const Rate&) = default;
+};
+
+namespace internal {
+
+inline bool parseRate(std::string_view input, Rate& rate)
+{
+    auto slash = input.find('/');
+    if (slash == std::string_view::npos) {
+        return false;
+    }
+
+    auto count = input.substr(0, slash);
+    auto decimal = Decimal{};
+    if (!parseDecimal(count, decimal) || decimal.negative) {
+        return false;
+    }
+    auto multiplier = Multiplier{};
+    uint64_t value = 0;
+    if (!parseMultiplier(count, multiplier) ||
+            !scaleExact(decimal, multiplier.num, multiplier.den, value)) {
+        return false;
+    }
+
+    auto period = input.substr(slash + 1);
+    int64_t nanoseconds = 0;
+    if (unitLength(period) == period.size()) {
+        auto unit = Multiplier{};
+        if (!parseTimeUnit(period, unit) ||
+                unit.num > static_cast<uint64_t>(
+                    std::numeric_limits<int64_t>::max())) {
+            return false;
+        }
+        nanoseconds = static_cast<int64_t>(unit.num);
+    } else if (!parseDuration<int64_t, std::nano>(period, nanoseconds) ||
+            nanoseconds <= 0) {
+        return false;
+    }
+
+    rate.count = value;
+    rate.period = std::chrono::nanoseconds{nanoseconds};
+    return true;
+}
+
+} // namespace internal
+
+template <>
+struct Converter<ByteSize> {
+    bool operator()(std::string_view input, ByteSize& value) const
+    {
+        return internal::parseByteSize(input, value.bytes);
+    }
+};
+
+template <class T>
+struct Converter<Quantity<T>> {
+    bool operator()(std::string_view input, Quantity<T>& value) const
+    {
+        return internal::parseQuantity(input, value.value);
+    }
+};
+
+template <>
+struct Converter<Rate> {
+    bool operator()(std::string_view input, Rate& value) const
+    {
+        return internal::parseRate(input, value);
+    }
+};
+
+template <>
+struct Formatter<ByteSize> {
+    void operator()(const ByteSize& value, std::string& output) const
+    {
+        internal::toChars(value.bytes, output);
+    }
+};
+
+template <class T>
+struct Formatter<Quantity<T>> {
+    void operator()(const Quantity<T>& value, std::string& output) const
+    {
+        Formatter<T>{}(value.value, output);
+    }
+};
+
+template <>
+struct Formatter<Rate> {
+    void operator()(const Rate& value, std::string& output) const
+    {
+        internal::toChars(value.count, output);
+        output += '/';
+        internal::toChars(value.period.count(), output);
+        output += "ns";
+    }
+};
+
+inline std::ostream& operator<<(std::ostream& output, const ByteSize& size)
+{
+    static constexpr const char* suffixes[] = {
+        "B", "KiB", "MiB", "GiB", "TiB", "PiB", "EiB"};
+
+    auto value = size.bytes;
+    size_t suffix = 0;
+    while (value != 0 && value % 1024 == 0 && suffix + 1 < std::size(suffixes)) {
+        value /= 1024;
+        suffix++;
+    }
+    return output << value << suffixes[suffix];
+}
+
+template <class T>
+std::ostream& operator<<(std::ostream& output, const Quantity<T>& quantity)
+{
+    return output << quantity.value;
+}
+
+inline std::ostream& operator<<(std::ostream& output, const Rate& rate)
+{
+    return output << rate.count << "/" << rate.period.count() << "ns";
+}
+
+} // namespace arg
@@ -0,0 +1,12 @@
+#if !defined(ARG_SEPARATE_COMPILATION)
+#error "arg_core must be compiled with ARG_SEPARATE_COMPILATION defined"
+#endif
+
+#include "arg/impl/cache.ipp"
+#include "arg/impl/errors.ipp"
+#include "arg/impl/events.ipp"
+#include "arg/impl/help.ipp"
+#include "arg/impl/image.ipp"
+#include "arg/impl/parser.ipp"
+#include "arg/impl/reload.ipp"
+#include "arg/impl/text.ipp"
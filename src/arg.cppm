@@ -0,0 +1,89 @@
+module;
+
+#include <arg.hpp>
+
+export module arg;
+
+export namespace arg {
+
+using arg::ArgumentAdapter;
+using arg::Argv;
+using arg::ByteSize;
+using arg::Choices;
+using arg::Converter;
+using arg::Event;
+using arg::EventReader;
+using arg::Flag;
+using arg::FlagAdapter;
+using arg::FlagBits;
+using arg::FlagSet;
+using arg::Formatter;
+using arg::HasConverter;
+using arg::HasFormatter;
+using arg::KeyAdapter;
+using arg::MappedFile;
+using arg::ListOption;
+using arg::ListOptionAdapter;
+using arg::MultiFlag;
+using arg::MultiFlagAdapter;
+using arg::MultiOption;
+using arg::MultiOptionAdapter;
+using arg::MultiValue;
+using arg::MultiValueAdapter;
+using arg::Option;
+using arg::OptionAdapter;
+using arg::Parser;
+using arg::Quantity;
+using arg::Rate;
+using arg::Registered;
+using arg::Reloadable;
+using arg::Schema;
+using arg::StaticParser;
+using arg::StaticResult;
+using arg::StoreAsBytes;
+using arg::Value;
+using arg::ValueAdapter;
+
+using arg::argument;
+using arg::dependsOn;
+using arg::describe;
+using arg::exactlyOne;
+using arg::flag;
+using arg::helpKeys;
+using arg::leftovers;
+using arg::listOption;
+using arg::multiArgument;
+using arg::multiFlag;
+using arg::multiOption;
+using arg::mutuallyExclusive;
+using arg::option;
+using arg::parse;
+using arg::print;
+using arg::printHelp;
+using arg::read;
+using arg::write;
+
+using arg::operator<<;
+using arg::operator>>;
+
+} // namespace arg
+
+export namespace arg::err {
+
+using arg::err::Error;
+using arg::err::FileNotReadable;
+using arg::err::InvalidChoice;
+using arg::err::InvalidValueGiven;
+using arg::err::MissingDependency;
+using arg::err::MutuallyExclusiveOptions;
+using arg::err::OneOfOptionsRequired;
+using arg::err::RequiredOptionNotSet;
+using arg::err::RequiredOptionValueNotGiven;
+using arg::err::UnexpectedArgument;
+using arg::err::UnexpectedOptionValueGiven;
+using arg::err::UnknownHelpSection;
+using arg::err::UnterminatedQuote;
+
+using arg::err::print;
+
+} // namespace arg::err
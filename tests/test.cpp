@@ -1,8 +1,52 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include <arg.hpp>
+#include <arg/impl/shell.hpp>
+#include <arg/impl/simd.hpp>
+#include <generated/test_options.hpp>
 
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <ranges>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// Counts calls to operator new, for tests of code that must not allocate
+namespace {
+std::atomic<size_t> allocations = 0;
+} // namespace
+
+void* operator new(size_t size)
+{
+    allocations++;
+    if (void* memory = std::malloc(size > 0 ? size : 1)) {
+        return memory;
+    }
+#if defined(ARG_EXCEPTIONS)
+    throw std::bad_alloc{};
+#else
+    std::abort();
+#endif
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    std::free(memory);
+}
 
 TEST_CASE("Basic arg test")
 {
@@ -21,3 +65,1302 @@ TEST_CASE("Basic arg test")
     auto z = arg::argument<std::string>()
         .metavar("PATH");
 }
+
+TEST_CASE("Converters")
+{
+    int i = 0;
+    REQUIRE(arg::read("42", i));
+    REQUIRE(i == 42);
+    REQUIRE(arg::read("+7", i));
+    REQUIRE(i == 7);
+    REQUIRE_FALSE(arg::read("12abc", i));
+    REQUIRE_FALSE(arg::read("", i));
+
+    unsigned u = 0;
+    REQUIRE_FALSE(arg::read("-1", u));
+
+    double d = 0;
+    REQUIRE(arg::read("2.5", d));
+    REQUIRE(d == 2.5);
+
+    bool b = false;
+    REQUIRE(arg::read("true", b));
+    REQUIRE(b);
+    REQUIRE(arg::read("0", b));
+    REQUIRE_FALSE(b);
+
+    std::string s;
+    REQUIRE(arg::read("some text", s));
+    REQUIRE(s == "some text");
+
+    std::filesystem::path path;
+    REQUIRE(arg::read("/tmp/file.txt", path));
+    REQUIRE(path.filename() == "file.txt");
+
+    std::chrono::milliseconds ms;
+    REQUIRE(arg::read("250ms", ms));
+    REQUIRE(ms.count() == 250);
+    REQUIRE(arg::read("2s", ms));
+    REQUIRE(ms.count() == 2000);
+    REQUIRE(arg::read("15", ms));
+    REQUIRE(ms.count() == 15);
+    REQUIRE_FALSE(arg::read("1500us", ms));
+    REQUIRE_FALSE(arg::read("10parsecs", ms));
+
+    std::chrono::duration<double> seconds;
+    REQUIRE(arg::read("1.5min", seconds));
+    REQUIRE(seconds.count() == 90.0);
+}
+
+namespace {
+
+enum class Mode {
+    Fast,
+    Safe,
+    Slow,
+};
+
+} // namespace
+
+TEST_CASE("Choices")
+{
+    auto choices = arg::Choices<Mode>{
+        {"slow", Mode::Slow}, {"fast", Mode::Fast}, {"safe", Mode::Safe}};
+    REQUIRE(choices.size() == 3);
+    REQUIRE(*choices.find("fast") == Mode::Fast);
+    REQUIRE(*choices.find("safe") == Mode::Safe);
+    REQUIRE(*choices.find("slow") == Mode::Slow);
+    REQUIRE(choices.find("turbo") == nullptr);
+    REQUIRE(choices.find("") == nullptr);
+    REQUIRE(choices.join(", ") == "slow, fast, safe");
+
+    auto parser = arg::Parser{};
+    auto mode = parser.option<Mode>()
+        .keys("-m", "--mode")
+        .choices({{"fast", Mode::Fast}, {"slow", Mode::Slow}})
+        .defaultValue(Mode::Safe);
+    auto modes = parser.multiOption<Mode>()
+        .keys("--also")
+        .choices({{"fast", Mode::Fast}, {"slow", Mode::Slow}});
+    REQUIRE(mode.metavar() == "{fast,slow}");
+
+    parser.parse(std::vector<std::string>{
+        "--mode", "slow", "--also=fast", "--also", "slow"});
+    REQUIRE(*mode == Mode::Slow);
+    REQUIRE(modes.vector() == std::vector<Mode>{Mode::Fast, Mode::Slow});
+
+    auto help = std::ostringstream{};
+    parser.printHelp(help);
+    REQUIRE(help.str().find("-m, --mode {fast,slow}") != std::string::npos);
+}
+
+TEST_CASE("Units")
+{
+    arg::ByteSize size;
+    REQUIRE(arg::read("512", size));
+    REQUIRE(size.bytes == 512);
+    REQUIRE(arg::read("4GiB", size));
+    REQUIRE(size.bytes == 4ull << 30);
+    REQUIRE(arg::read("64k", size));
+    REQUIRE(size.bytes == 64'000);
+    REQUIRE(arg::read("1.5MB", size));
+    REQUIRE(size.bytes == 1'500'000);
+    REQUIRE(arg::read("15EiB", size));
+    REQUIRE(size.bytes == 15ull << 60);
+    REQUIRE_FALSE(arg::read("16EiB", size));
+    REQUIRE_FALSE(arg::read("1.5B", size));
+    REQUIRE_FALSE(arg::read("-1k", size));
+    REQUIRE_FALSE(arg::read("4GB!", size));
+    REQUIRE_FALSE(arg::read("GiB", size));
+    REQUIRE_FALSE(arg::read("99999999999999999999", size));
+
+    std::chrono::milliseconds ms;
+    REQUIRE(arg::read("1h30m", ms));
+    REQUIRE(ms.count() == 90 * 60 * 1000);
+    REQUIRE(arg::read("1.5s", ms));
+    REQUIRE(ms.count() == 1500);
+    REQUIRE(arg::read("-250ms", ms));
+    REQUIRE(ms.count() == -250);
+    REQUIRE_FALSE(arg::read("1ns", ms));
+    REQUIRE_FALSE(arg::read("1h-30m", ms));
+
+    std::chrono::seconds seconds;
+    REQUIRE(arg::read("1500ms", seconds) == false);
+    REQUIRE(arg::read("2000ms", seconds));
+    REQUIRE(seconds.count() == 2);
+
+    std::chrono::nanoseconds ns;
+    REQUIRE(arg::read("292y", ns) == false);
+    REQUIRE(arg::read("106751d", ns));
+    REQUIRE_FALSE(arg::read("106752d", ns));
+
+    arg::Quantity<> count;
+    REQUIRE(arg::read("10k", count));
+    REQUIRE(count.value == 10'000);
+    REQUIRE(arg::read("16Ki", count));
+    REQUIRE(count.value == 16 * 1024);
+    REQUIRE_FALSE(arg::read("1.5", count));
+
+    arg::Quantity<int> signedCount;
+    REQUIRE(arg::read("-2k", signedCount));
+    REQUIRE(signedCount.value == -2000);
+    REQUIRE_FALSE(arg::read("3G", signedCount));
+
+    arg::Quantity<double> real;
+    REQUIRE(arg::read("2.5M", real));
+    REQUIRE(real.value == 2.5e6);
+
+    arg::Rate rate;
+    REQUIRE(arg::read("10k/s", rate));
+    REQUIRE(rate.count == 10'000);
+    REQUIRE(rate.perSecond() == 10'000.0);
+    REQUIRE(arg::read("30/min", rate));
+    REQUIRE(rate.perSecond() == 0.5);
+    REQUIRE(arg::read("5/100ms", rate));
+    REQUIRE(rate.perSecond() == 50.0);
+    REQUIRE_FALSE(arg::read("10k", rate));
+    REQUIRE_FALSE(arg::read("10/0s", rate));
+}
+
+namespace {
+
+struct Config {
+    int threads = 4;
+    bool verbose = false;
+    size_t verbosity = 0;
+    Mode mode = Mode::Safe;
+    std::chrono::milliseconds timeout{100};
+    std::vector<std::string> tags;
+    std::string input;
+    std::vector<std::string> rest;
+};
+
+} // namespace
+
+TEST_CASE("Schema")
+{
+    auto schema = arg::Schema<Config>{};
+    schema.option(&Config::threads)
+        .keys("-t", "--threads");
+    schema.flag(&Config::verbose)
+        .keys("-v");
+    schema.multiFlag(&Config::verbosity)
+        .keys("-d");
+    schema.option(&Config::mode)
+        .keys("--mode")
+        .choices({{"fast", Mode::Fast}, {"slow", Mode::Slow}})
+        .defaultValue(Mode::Slow);
+    schema.option(&Config::timeout)
+        .keys("--timeout");
+    schema.multiOption(&Config::tags)
+        .keys("--tag");
+    schema.argument(&Config::input)
+        .markRequired();
+    schema.multiArgument(&Config::rest);
+
+    auto config = schema.parse(std::vector<std::string>{
+        "-vddt", "8", "--mode=fast", "--tag", "a", "--tag=b", "in", "x", "y"});
+    REQUIRE(config.threads == 8);
+    REQUIRE(config.verbose);
+    REQUIRE(config.verbosity == 2);
+    REQUIRE(config.mode == Mode::Fast);
+    REQUIRE(config.timeout.count() == 100);
+    REQUIRE(config.tags == std::vector<std::string>{"a", "b"});
+    REQUIRE(config.input == "in");
+    REQUIRE(config.rest == std::vector<std::string>{"x", "y"});
+
+    auto other = schema.parse(std::vector<std::string>{"--timeout", "2s", "in"});
+    REQUIRE(other.threads == 4);
+    REQUIRE_FALSE(other.verbose);
+    REQUIRE(other.timeout.count() == 2000);
+    REQUIRE(other.rest.empty());
+    // A default given on the handle replaces the struct's own
+    REQUIRE(other.mode == Mode::Slow);
+}
+
+TEST_CASE("Tokens")
+{
+    auto text = std::string(40, 'x') + "=value";
+    REQUIRE(arg::internal::simd::find(text, '=') == 40);
+    REQUIRE(arg::internal::simd::find(text, '#') == std::string_view::npos);
+    REQUIRE(arg::internal::simd::find(text, "=v") == 40);
+    REQUIRE(arg::internal::simd::find("a==b", "==") == 1);
+
+    auto parser = arg::Parser{};
+    auto all = parser.flag().keys("-a");
+    auto brief = parser.flag().keys("-b");
+    auto level = parser.option<int>().keys("-l", "--level");
+    auto name = parser.option<std::string>().keys("--name");
+    auto inputs = parser.multiArgument<std::string>();
+
+    parser.parse(std::vector<std::string>{
+        "-abl3", "--name=a=b", "-", "-ax", "--level", "5"});
+    REQUIRE(all);
+    REQUIRE(brief);
+    REQUIRE(*level == 5);
+    REQUIRE(*name == "a=b");
+    REQUIRE(inputs.vector() == std::vector<std::string>{"-", "-ax"});
+
+    // Ranges that make their elements on the fly
+    auto numbers = std::vector<int>{7, 8};
+    auto made = numbers | std::views::transform([] (int n) {
+        return "--name=" + std::string(32, 'n') + std::to_string(n);
+    });
+    parser.parse(made);
+    REQUIRE(*name == std::string(32, 'n') + "8");
+    REQUIRE(parser.tryParse(made).empty());
+}
+
+namespace {
+
+struct Counted {
+    int value = 0;
+};
+
+int countedConversions = 0;
+
+} // namespace
+
+template <>
+struct arg::Converter<Counted> {
+    bool operator()(std::string_view input, Counted& counted) const
+    {
+        countedConversions++;
+        return arg::read(input, counted.value);
+    }
+};
+
+template <>
+struct arg::StoreAsBytes<Counted> : std::true_type {};
+
+TEST_CASE("Parse cache")
+{
+    auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    auto path = (std::filesystem::temp_directory_path() /
+        ("arg_test_cache_" + std::to_string(stamp))).string();
+    std::filesystem::remove(path);
+
+    auto run = [&] (
+            const std::vector<std::string>& args,
+            std::string input,
+            bool required = false,
+            int defaultValue = 0,
+            std::string version = {}) {
+        auto parser = arg::Parser{};
+        parser.config.cacheFile = path;
+        parser.config.cacheVersion = version;
+        parser.cacheInput(input);
+        auto counted = parser.option<Counted>().keys("-c")
+            .defaultValue(Counted{defaultValue});
+        if (required) {
+            counted.markRequired();
+        }
+        auto level = parser.multiFlag().keys("-v");
+        auto ids = parser.listOption<int>().keys("--ids");
+        auto names = parser.multiArgument<std::string>();
+        parser.parse(args);
+        return std::tuple{counted->value, size_t{level}, *ids, names.vector()};
+    };
+
+    auto args = std::vector<std::string>{
+        "-vv", "-c", "7", "--ids=1,2", "--ids=3", "a", "b"};
+    auto expected = std::tuple{
+        7, size_t{2}, std::vector<int>{1, 2, 3},
+        std::vector<std::string>{"a", "b"}};
+
+    REQUIRE(run(args, "config") == expected);
+    REQUIRE(countedConversions == 1);
+    REQUIRE(std::filesystem::exists(path));
+
+    REQUIRE(run(args, "config") == expected);
+    REQUIRE(countedConversions == 1);
+
+    REQUIRE(run(args, "changed config") == expected);
+    REQUIRE(countedConversions == 2);
+
+    args.back() = "c";
+    REQUIRE(std::get<3>(run(args, "changed config")) ==
+        std::vector<std::string>{"a", "c"});
+    REQUIRE(countedConversions == 3);
+
+    // The checks on each option and its default are part of the key
+    REQUIRE(std::get<0>(run(args, "changed config", true)) == 7);
+    REQUIRE(countedConversions == 4);
+    REQUIRE(std::get<0>(run(args, "changed config", true, 5)) == 7);
+    REQUIRE(countedConversions == 5);
+    REQUIRE(std::get<0>(run(args, "changed config", true, 5)) == 7);
+    REQUIRE(countedConversions == 5);
+    REQUIRE(std::get<0>(run(args, "changed config", true, 5, "2")) == 7);
+    REQUIRE(countedConversions == 6);
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("To argv")
+{
+    struct Handles {
+        arg::Parser parser;
+        arg::Flag all = parser.flag().keys("-a", "--all");
+        arg::MultiFlag level = parser.multiFlag().keys("-v");
+        arg::Option<double> ratio = parser.option<double>().keys("--ratio");
+        arg::Option<Mode> mode = parser.option<Mode>()
+            .keys("-m", "--mode")
+            .choices({{"fast", Mode::Fast}, {"slow", Mode::Slow}});
+        arg::MultiOption<std::chrono::milliseconds> delays =
+            parser.multiOption<std::chrono::milliseconds>().keys("--delay");
+        arg::Value<std::string> input = parser.argument<std::string>();
+        arg::MultiValue<int> numbers = parser.multiArgument<int>();
+    };
+
+    auto first = Handles{};
+    first.parser.parse(std::vector<std::string>{
+        "--all", "-vvv", "--ratio", "0.1", "--mode", "slow",
+        "--delay=1s", "--delay", "250", "--", "-a", "-5", "7"});
+
+    auto argv = first.parser.toArgv();
+    REQUIRE(argv.argc() == 11);
+    REQUIRE(argv.argv()[argv.argc()] == nullptr);
+    REQUIRE(argv[1] == "-a");
+    REQUIRE(argv[2] == "-vvv");
+    REQUIRE(argv[3] == "--ratio=0.1");
+    REQUIRE(argv[4] == "-m=slow");
+    REQUIRE(argv[5] == "--delay=1000");
+    REQUIRE(argv[6] == "--delay=250");
+    REQUIRE(argv[7] == "--");
+    REQUIRE(argv[8] == "-a");
+
+    auto second = Handles{};
+    second.parser.parse(argv.args());
+    REQUIRE(second.all);
+    REQUIRE(second.level == 3);
+    REQUIRE(*second.ratio == *first.ratio);
+    REQUIRE(*second.mode == Mode::Slow);
+    REQUIRE(second.delays.vector() == first.delays.vector());
+    REQUIRE(*second.input == "-a");
+    REQUIRE(second.numbers.vector() == std::vector<int>{-5, 7});
+}
+
+TEST_CASE("Reloadable")
+{
+    auto schema = arg::Schema<Config>{};
+    schema.option(&Config::threads).keys("-t");
+    schema.option(&Config::mode)
+        .keys("--mode")
+        .choices({{"fast", Mode::Fast}, {"slow", Mode::Slow}});
+
+    auto base = schema.parse(std::vector<std::string>{"-t", "2"});
+    auto live = arg::Reloadable<Config>{schema, base};
+    auto reader = live.reader();
+    REQUIRE(reader->threads == 2);
+
+    // A reader sees its snapshot until it is quiescent
+    const Config* before = &*reader;
+    REQUIRE(live.reload(std::vector<std::string>{"--mode", "fast"}).empty());
+    REQUIRE(&*reader == before);
+    REQUIRE(reader->mode == Mode::Safe);
+    REQUIRE(live.retired() == 1);
+    REQUIRE(live.reader()->mode == Mode::Fast);
+
+    reader.quiescent();
+    REQUIRE(reader->mode == Mode::Fast);
+    REQUIRE(reader->threads == 2);
+    live.collect();
+    REQUIRE(live.retired() == 0);
+
+    REQUIRE(live.reload(std::vector<std::string>{"-t", "many"}).size() == 1);
+    REQUIRE(reader->mode == Mode::Fast);
+
+    auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    auto path = (std::filesystem::temp_directory_path() /
+        ("arg_test_reload_" + std::to_string(stamp))).string();
+    std::ofstream{path} << "# settings\n-t 16\n";
+    live.watch(path);
+    reader.quiescent();
+    REQUIRE(reader->threads == 16);
+    REQUIRE(reader->mode == Mode::Safe);
+
+    std::ofstream{path} << "-t 32 --mode slow\n";
+    for (int i = 0; i < 500 && reader->threads != 32; i++) {
+        reader.quiescent();
+        std::this_thread::sleep_for(std::chrono::milliseconds{10});
+    }
+    REQUIRE(reader->threads == 32);
+    REQUIRE(reader->mode == Mode::Slow);
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Text pool")
+{
+    auto& pool = arg::internal::textPool();
+    auto text = std::string{"shared help text"};
+    REQUIRE(pool.intern(text).data() == pool.intern("shared help text").data());
+    REQUIRE(pool.intern(text).data() != text.data());
+    REQUIRE(pool.intern("").empty());
+
+    auto first = arg::flag().keys("-q", "--quiet").help(text);
+    auto second = arg::option<int>().keys("-q", std::string{"--quiet"});
+    REQUIRE(first.keys().data() == second.keys().data());
+    REQUIRE(first.keys().size() == 2);
+    REQUIRE(first.keys()[1] == "--quiet");
+    REQUIRE(first.help().data() == pool.intern(text).data());
+
+    auto bytes = pool.bytes();
+    for (int i = 0; i < 100; i++) {
+        arg::Parser{}.option<int>()
+            .keys("-q", "--quiet")
+            .help("shared help text")
+            .metavar("N");
+    }
+    REQUIRE(pool.bytes() == bytes);
+}
+
+ARG_DEFINE_INT(testThreads, "--test-threads", 4, "Number of test threads");
+ARG_DEFINE_BOOL(testDryRun, "--test-dry-run", false, "Do not change anything");
+ARG_DEFINE_STRING(testName, "--test-name",
+    "a default that does not fit into a small string", "Name of the test");
+ARG_DEFINE_DOUBLE(testRatio, "--test-ratio", 0.5, "Ratio");
+
+TEST_CASE("Registered options")
+{
+    REQUIRE(*testThreads == 4);
+    REQUIRE_FALSE(*testDryRun);
+    REQUIRE(*testName == "a default that does not fit into a small string");
+
+    auto parser = arg::Parser{};
+    parser.attachRegistered();
+    parser.attachRegistered();
+    parser.parse(std::vector<std::string>{
+        "--test-threads", "8", "--test-dry-run", "--test-name=x"});
+    REQUIRE(*testThreads == 8);
+    REQUIRE(testThreads.isSet());
+    REQUIRE(*testDryRun);
+    REQUIRE(*testName == "x");
+    REQUIRE(*testRatio == 0.5);
+    REQUIRE_FALSE(testRatio.isSet());
+
+    auto help = std::ostringstream{};
+    parser.printHelp(help);
+    auto text = help.str().substr(help.str().find("Options:"));
+    auto first = text.find("--test-threads");
+    REQUIRE(first != std::string::npos);
+    REQUIRE(text.find("--test-threads", first + 1) == std::string::npos);
+    REQUIRE(first < text.find("--test-ratio"));
+}
+
+TEST_CASE("Command line strings")
+{
+    auto split = [] (std::string_view line) {
+        std::vector<std::string_view> tokens;
+        std::string scratch;
+        auto quote = arg::internal::splitCommandLine(line, tokens, scratch);
+        REQUIRE(quote == std::string_view::npos);
+        return std::vector<std::string>{tokens.begin(), tokens.end()};
+    };
+    using Tokens = std::vector<std::string>;
+
+    REQUIRE(split("") == Tokens{});
+    REQUIRE(split("  a\tbb \n ccc ") == Tokens{"a", "bb", "ccc"});
+    REQUIRE(split("'a b' \"c d\"") == Tokens{"a b", "c d"});
+    REQUIRE(split("a'b'\"c\"d") == Tokens{"abcd"});
+    REQUIRE(split("'' \"\" x") == Tokens{"", "", "x"});
+    REQUIRE(split("a\\ b \\'c\\\\") == Tokens{"a b", "'c\\"});
+    REQUIRE(split("'a\\b' \"a\\b\" \"\\$\\\"\\\\\"") ==
+        Tokens{"a\\b", "a\\b", "$\"\\"});
+    REQUIRE(split("a\\\nb \"c\\\nd\" e\\") == Tokens{"ab", "cd", "e\\"});
+    REQUIRE(split("--name='some long value with spaces in the middle' -v") ==
+        Tokens{"--name=some long value with spaces in the middle", "-v"});
+
+    // Plain and singly quoted arguments are views into the line
+    auto line = std::string_view{"plain 'quoted one' two\\ parts"};
+    std::vector<std::string_view> tokens;
+    std::string scratch;
+    arg::internal::splitCommandLine(line, tokens, scratch);
+    REQUIRE(tokens.size() == 3);
+    REQUIRE(tokens[0].data() == line.data());
+    REQUIRE(tokens[1].data() == line.data() + 7);
+    REQUIRE(tokens[2] == "two parts");
+    REQUIRE(tokens[2].data() == scratch.data());
+
+    tokens.clear();
+    scratch.clear();
+    REQUIRE(arg::internal::splitCommandLine("a 'b", tokens, scratch) == 2);
+    tokens.clear();
+    REQUIRE(arg::internal::splitCommandLine("\"a\\\"", tokens, scratch) == 0);
+
+    auto parser = arg::Parser{};
+    auto name = parser.option<std::string>().keys("--name");
+    auto count = parser.option<int>().keys("-n");
+    auto verbose = parser.flag().keys("-v");
+    parser.parse("-v --name 'John \"Q\" Public' -n\t42");
+    REQUIRE(verbose);
+    REQUIRE(*name == "John \"Q\" Public");
+    REQUIRE(*count == 42);
+
+    auto errors = parser.tryParse("--name \"unterminated");
+    REQUIRE(errors.size() == 1);
+    auto* error = std::get_if<arg::err::UnterminatedQuote>(&errors.front());
+    REQUIRE(error);
+    REQUIRE(error->offset == 7);
+}
+
+TEST_CASE("Events")
+{
+    auto parser = arg::Parser{};
+    auto all = parser.flag().keys("-a");
+    auto level = parser.option<int>().keys("-l", "--level");
+    auto name = parser.option<std::string>().keys("--name");
+    auto input = parser.argument<std::string>();
+    parser.helpKeys("-h");
+
+    auto args = std::vector<std::string_view>{
+        "-al3", "--name=x", "in", "--level", "out", "-h", "--", "-a", "-l"};
+    using Kind = arg::Event::Kind;
+    using Form = arg::Event::Form;
+    auto events = std::vector<arg::Event>{};
+    for (const auto& event : parser.events(args)) {
+        events.push_back(event);
+    }
+
+    REQUIRE(events.size() == 8);
+    REQUIRE(events[0].kind == Kind::Flag);
+    REQUIRE(events[0].form == Form::Packed);
+    REQUIRE(events[0].index == 0);
+    REQUIRE(events[0].key == "a");
+    REQUIRE(events[1].kind == Kind::Option);
+    REQUIRE(events[1].index == 1);
+    REQUIRE(events[1].value == "3");
+    REQUIRE(events[2].kind == Kind::Option);
+    REQUIRE(events[2].form == Form::Joined);
+    REQUIRE(events[2].key == "--name");
+    REQUIRE(events[2].value.data() == args[1].data() + 7);
+    REQUIRE(events[3].kind == Kind::Argument);
+    REQUIRE(events[3].value == "in");
+    REQUIRE(events[4].kind == Kind::Option);
+    REQUIRE(events[4].value == "out");
+    REQUIRE(events[5].kind == Kind::Help);
+    REQUIRE(events[6].kind == Kind::Unexpected);
+    REQUIRE(events[6].value == "-a");
+    REQUIRE(events[7].kind == Kind::Unexpected);
+    REQUIRE(events[7].value == "-l");
+
+    // Nothing is stored by reading events
+    REQUIRE_FALSE(all);
+    REQUIRE_FALSE(level.isSet());
+
+    auto errors = parser.tryParse(std::vector<std::string>{"-a=1", "-l"});
+    REQUIRE(errors.size() == 2);
+    REQUIRE(std::holds_alternative<arg::err::UnexpectedOptionValueGiven>(
+        errors[0]));
+    REQUIRE(std::holds_alternative<arg::err::RequiredOptionValueNotGiven>(
+        errors[1]));
+}
+
+TEST_CASE("Option groups")
+{
+    auto parser = arg::Parser{};
+    auto tcp = parser.flag().keys("--tcp");
+    auto udp = parser.flag().keys("--udp");
+    auto socket = parser.option<std::string>().keys("--unix");
+    auto key = parser.option<std::string>().keys("--tls-key");
+    auto cert = parser.option<std::string>().keys("--tls-cert");
+    auto quiet = parser.flag().keys("-q", "--quiet");
+    auto verbose = parser.multiFlag().keys("-v");
+    parser.exactlyOne(tcp, udp, "--unix");
+    parser.dependsOn("--tls-key", cert);
+    parser.mutuallyExclusive("--quiet", verbose);
+
+    auto check = [&] (std::vector<std::string> args) {
+        return parser.tryParse(args);
+    };
+
+    REQUIRE(check({"--tcp"}).empty());
+    REQUIRE(check({"--unix", "/tmp/s", "--tls-key", "k", "--tls-cert", "c"})
+        .empty());
+    REQUIRE(check({"--udp", "-q"}).empty());
+
+    auto errors = check({"--tcp", "--unix", "/tmp/s"});
+    REQUIRE(errors.size() == 1);
+    auto* exclusive =
+        std::get_if<arg::err::MutuallyExclusiveOptions>(&errors.front());
+    REQUIRE(exclusive);
+    REQUIRE(exclusive->keys == "--tcp, --unix");
+
+    errors = check({"-q"});
+    REQUIRE(errors.size() == 1);
+    auto* none = std::get_if<arg::err::OneOfOptionsRequired>(&errors.front());
+    REQUIRE(none);
+    REQUIRE(none->keys == "--tcp, --udp, --unix");
+
+    errors = check({"--tcp", "--tls-key", "k", "-vq"});
+    REQUIRE(errors.size() == 2);
+    auto* dependency = std::get_if<arg::err::MissingDependency>(&errors[0]);
+    REQUIRE(dependency);
+    REQUIRE(dependency->key == "--tls-key");
+    REQUIRE(dependency->dependency == "--tls-cert");
+    REQUIRE(std::holds_alternative<arg::err::MutuallyExclusiveOptions>(
+        errors[1]));
+
+    // Groups are checked over bit sets, also past one word of options
+    auto wide = arg::Parser{};
+    std::vector<arg::Flag> flags;
+    for (int i = 0; i < 130; i++) {
+        flags.push_back(wide.flag().keys("--f" + std::to_string(i)));
+    }
+    wide.mutuallyExclusive("--f1", "--f70", "--f129");
+    wide.dependsOn("--f0", "--f128");
+    REQUIRE(wide.tryParse(std::vector<std::string>{"--f129", "--f2"}).empty());
+    REQUIRE(wide.tryParse(std::vector<std::string>{"--f70", "--f129"})
+        .size() == 1);
+    REQUIRE(wide.tryParse(std::vector<std::string>{"--f0"}).size() == 1);
+    REQUIRE(wide.tryParse(std::vector<std::string>{"--f0", "--f128"})
+        .empty());
+#if defined(ARG_EXCEPTIONS)
+    REQUIRE_THROWS(wide.exactlyOne("--f5", "--missing"));
+#endif
+
+    // Keys are resolved when the constraint is added, including keys set
+    // after their option was first indexed
+    auto late = wide.flag();
+    wide.dependsOn("--f2", "--f3");
+    late.keys("--late");
+    wide.dependsOn("--late", "--f3");
+    REQUIRE(wide.tryParse(std::vector<std::string>{"--late"}).size() == 1);
+}
+
+TEST_CASE("List options")
+{
+    auto parser = arg::Parser{};
+    auto ids = parser.listOption<int>().keys("--ids");
+    auto names = parser.listOption<std::string>().keys("-n").delimiter(':');
+    auto ratios = parser.listOption<double>().keys("--ratios")
+        .defaultValue({0.5});
+
+    REQUIRE(*ratios == std::vector<double>{0.5});
+
+    std::string many;
+    for (int i = 0; i < 1000; i++) {
+        many += std::to_string(i * 7) + ",";
+    }
+    many.pop_back();
+    parser.parse(std::vector<std::string>{
+        "--ids=" + many, "-n", "a:b::c", "--ids", "-1,+2"});
+    REQUIRE(ids->size() == 1002);
+    REQUIRE((*ids)[999] == 6993);
+    REQUIRE((*ids)[1000] == -1);
+    REQUIRE((*ids)[1001] == 2);
+    REQUIRE(*names == std::vector<std::string>{"a", "b", "", "c"});
+    REQUIRE(*ratios == std::vector<double>{0.5});
+
+    auto argv = parser.toArgv();
+    REQUIRE(argv[argv.size() - 1] == "-n=a:b::c");
+
+    auto errors = parser.tryParse(
+        std::vector<std::string>{"--ids=1,2,x3,4", "--ratios="});
+    REQUIRE(errors.size() == 1);
+    auto* invalid = std::get_if<arg::err::InvalidValueGiven>(&errors.front());
+    REQUIRE(invalid);
+    REQUIRE(invalid->keys == "--ids");
+    REQUIRE(invalid->value == "x3");
+    REQUIRE(invalid->element == 2);
+    REQUIRE(ratios.isSet());
+    REQUIRE(ratios->empty());
+
+    struct Config {
+        std::vector<uint64_t> nodes = {1};
+    };
+    auto schema = arg::Schema<Config>{};
+    schema.listOption(&Config::nodes).keys("--nodes");
+    REQUIRE(schema.parse(std::vector<std::string>{}).nodes ==
+        std::vector<uint64_t>{1});
+    REQUIRE(schema.parse(std::vector<std::string>{"--nodes=3,4"}).nodes ==
+        std::vector<uint64_t>{3, 4});
+}
+
+template <class Handle>
+concept HasUtf8 = requires (Handle handle) { handle.utf8(); };
+
+TEST_CASE("UTF-8 values")
+{
+    using arg::internal::simd::invalidUtf8;
+    constexpr auto npos = std::string_view::npos;
+
+    auto ascii = std::string(40, 'a');
+    REQUIRE(invalidUtf8("") == npos);
+    REQUIRE(invalidUtf8(ascii + "\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80") ==
+        npos);
+    REQUIRE(invalidUtf8(ascii + "\xff") == 40);
+    REQUIRE(invalidUtf8("ab\xc0\xaf") == 2);
+    REQUIRE(invalidUtf8("\xed\xa0\x80") == 0);
+    REQUIRE(invalidUtf8("\xf4\x90\x80\x80") == 0);
+    REQUIRE(invalidUtf8("\xc3\xa9\xe2\x82") == 2);
+    REQUIRE(invalidUtf8(ascii + "\xc3\xa9" + ascii + "\x80" + ascii) == 82);
+
+    // The block check against the plain decoder, on random mixes of pieces
+    // that cross block boundaries
+    const char* pieces[] = {
+        "a", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "\xed\x9f\xbf",
+        "\xf4\x8f\xbf\xbf", "\x80", "\xc1\xbf", "\xe0\x9f\x80", "\xed\xa0\x80",
+        "\xf0\x8f\xbf\xbf", "\xf4\x90\x80\x80", "\xf5", "\xc3", "\xe2\x82"};
+    uint32_t state = 1;
+    for (int round = 0; round < 2000; round++) {
+        std::string input;
+        for (int piece = 0; piece < 24; piece++) {
+            state = state * 1664525 + 1013904223;
+            auto index = (state >> 16) % std::size(pieces);
+            input += pieces[round % 4 == 0 ? index % 6 : index];
+        }
+        REQUIRE(invalidUtf8(input) ==
+            arg::internal::simd::utf8::firstInvalid(input, 0));
+    }
+
+    STATIC_REQUIRE(HasUtf8<arg::Option<std::string>>);
+    STATIC_REQUIRE(!HasUtf8<arg::Option<int>>);
+
+    auto parser = arg::Parser{};
+    auto name = parser.option<std::string>().keys("--name").utf8();
+    auto raw = parser.option<std::string>().keys("--raw");
+    auto tags = parser.listOption<std::string>().keys("--tags").utf8();
+    auto path = parser.argument<std::filesystem::path>().metavar("PATH").utf8();
+
+    parser.parse(std::vector<std::string>{
+        "--name=na\xc3\xafve", "--raw=\xff", "--tags=a,\xc3\xa9", "dir/x"});
+    REQUIRE(*name == "na\xc3\xafve");
+    REQUIRE(*raw == "\xff");
+    REQUIRE(*tags == std::vector<std::string>{"a", "\xc3\xa9"});
+    REQUIRE(*path == "dir/x");
+
+    auto errors = parser.tryParse(std::vector<std::string>{
+        "--name", ascii + "\xe2\x28\xa1", "--tags=ok,\xfe", "x\xc1"});
+    REQUIRE(errors.size() == 3);
+    auto offset = [&errors] (size_t i) {
+        auto* invalid = std::get_if<arg::err::InvalidValueGiven>(&errors[i]);
+        REQUIRE(invalid);
+        return invalid->offset;
+    };
+    REQUIRE(offset(0) == 40);
+    REQUIRE(offset(1) == 3);
+    REQUIRE(offset(2) == 1);
+    REQUIRE(*name == "na\xc3\xafve");
+
+    auto output = std::ostringstream{};
+    arg::err::print(output, errors[1]);
+    REQUIRE(output.str() ==
+        "invalid value for option --tags: ok,\xfe (invalid UTF-8 at byte 3)\n");
+}
+
+TEST_CASE("Parser images")
+{
+    struct Defined {
+        arg::Parser parser;
+        arg::Flag all = parser.flag().keys("-a", "--all");
+        arg::Option<int> level = parser.option<int>().keys("-l", "--level");
+        arg::Option<std::string> name =
+            parser.option<std::string>().keys("--name").help("Name to use");
+        arg::MultiValue<std::string> inputs =
+            parser.multiArgument<std::string>().metavar("INPUT");
+
+        Defined()
+        {
+            parser.helpKeys("-h", "--help");
+        }
+
+        auto parse(std::vector<std::string> args)
+        {
+            auto errors = parser.tryParse(args);
+            return std::tuple{
+                errors.size(), bool{all}, level.isSet() ? *level : -1,
+                name.isSet() ? *name : "", inputs.vector()};
+        }
+
+        std::string help()
+        {
+            auto output = std::ostringstream{};
+            parser.printHelp(output);
+            return output.str();
+        }
+    };
+
+    auto plain = Defined{};
+    const auto image = plain.parser.image();
+
+    auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    auto path = (std::filesystem::temp_directory_path() /
+        ("arg_test_image_" + std::to_string(stamp))).string();
+    REQUIRE(plain.parser.saveImage(path));
+
+    auto mapped = Defined{};
+    REQUIRE(mapped.parser.loadImage(path));
+    auto embedded = Defined{};
+    REQUIRE(embedded.parser.useImage(image));
+
+    const std::vector<std::string> commandLines[] = {
+        {"-al3", "--name=x", "in", "out"},
+        {"--level", "5", "-a", "--", "-l"},
+        {"-la"},
+        {"--all=1", "-x", "-h"},
+    };
+    for (const auto& args : commandLines) {
+        auto expected = plain.parse(args);
+        REQUIRE(mapped.parse(args) == expected);
+        REQUIRE(embedded.parse(args) == expected);
+    }
+    REQUIRE(mapped.help() == plain.help());
+    REQUIRE(mapped.help().find("--name VALUE       Name to use") !=
+        std::string::npos);
+
+    // Images only load into parsers with the same options
+    auto other = Defined{};
+    auto verbose = other.parser.flag().keys("-v");
+    REQUIRE_FALSE(other.parser.loadImage(path));
+    auto renamed = Defined{};
+    renamed.name.help("Another name");
+    REQUIRE_FALSE(renamed.parser.useImage(image));
+    auto moved = Defined{};
+    moved.name.section("naming");
+    REQUIRE_FALSE(moved.parser.useImage(image));
+    REQUIRE_FALSE(renamed.parser.useImage(image.substr(0, image.size() - 1)));
+    REQUIRE_FALSE(renamed.parser.useImage("argi"));
+    REQUIRE_FALSE(renamed.parser.loadImage(path + ".missing"));
+
+    // Options added after loading make the parser index them again
+    auto extended = Defined{};
+    REQUIRE(extended.parser.useImage(image));
+    auto quiet = extended.parser.flag().keys("-q");
+    REQUIRE(std::get<0>(extended.parse({"-qa"})) == 0);
+    REQUIRE(quiet);
+
+    // So do keys and help changed on existing handles
+    auto rekeyed = Defined{};
+    REQUIRE(rekeyed.parser.useImage(image));
+    rekeyed.level.keys("-L");
+    REQUIRE(rekeyed.parse({"-L", "2"}) ==
+        std::tuple{size_t{0}, false, 2, std::string{},
+            std::vector<std::string>{}});
+    auto redocumented = Defined{};
+    REQUIRE(redocumented.parser.useImage(image));
+    redocumented.name.help("Another name");
+    REQUIRE(redocumented.help().find("Another name") != std::string::npos);
+
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("Help")
+{
+    auto parser = arg::Parser{};
+    parser.config.helpWidth = 50;
+    auto all = parser.flag().keys("-a", "--all")
+        .help("Process every file, including the hidden ones");
+    auto level = parser.option<int>().keys("-l", "--level");
+    auto host = parser.option<std::string>().keys("--host")
+        .section("network").help("Host to connect to");
+    auto port = parser.option<int>().keys("-p", "--port").metavar("PORT")
+        .section("network").help("Port");
+    auto inputs = parser.multiArgument<std::string>().metavar("INPUT")
+        .help("Files to read");
+    parser.helpKeys("-h", "--help");
+
+    auto help = [&] (std::string_view section = {}) {
+        auto output = std::ostringstream{};
+        parser.printHelp(output, section);
+        return output.str();
+    };
+
+    const auto usage =
+        "usage: <program> [ -a ] [ -l VALUE ]\n"
+        "    [ --host VALUE ] [ -p PORT ] { INPUT }\n";
+    const auto network =
+        "\n"
+        "network options:\n"
+        "  --host VALUE      Host to connect to\n"
+        "  -p, --port PORT   Port\n";
+    REQUIRE(help() == std::string{usage} +
+        "\n"
+        "Options:\n"
+        "  -a, --all         Process every file, including\n"
+        "                    the hidden ones\n"
+        "  -l, --level VALUE\n" +
+        network +
+        "\n"
+        "Positional arguments:\n"
+        "  INPUT             Files to read\n");
+    REQUIRE(help("network") == std::string{usage} + network);
+    REQUIRE(help("unknown") == help());
+
+    // Added options are rendered into the next help
+    auto quiet = parser.flag().keys("-q").section("output");
+    REQUIRE(help("output").ends_with("output options:\n  -q\n"));
+
+    auto errors = parser.tryParse(std::vector<std::string>{"--help=disk"});
+    REQUIRE(errors.size() == 1);
+    auto* unknown = std::get_if<arg::err::UnknownHelpSection>(&errors[0]);
+    REQUIRE(unknown);
+    REQUIRE(unknown->section == "disk");
+    REQUIRE(unknown->sections == "network, output");
+    REQUIRE(parser.tryParse(std::vector<std::string>{"-h=network"}).empty());
+}
+
+TEST_CASE("Flag sets")
+{
+    auto parser = arg::Parser{};
+    auto features = arg::FlagSet{};
+    std::vector<arg::FlagSet::Member> members;
+    for (int i = 0; i < 150; i++) {
+        members.push_back(
+            parser.flag(features).keys("--feature-" + std::to_string(i)));
+    }
+    auto fast = parser.flag(features).keys("-f", "--fast").help("Go fast");
+    auto safe = parser.flag(features).keys("-s");
+    auto level = parser.option<int>().keys("-l");
+    REQUIRE(features.size() == 152);
+    REQUIRE(fast.bit() == 150);
+
+    const auto both = features.mask({fast.bit(), safe.bit()});
+    auto before = features.bits();
+    parser.parse(std::vector<std::string>{
+        "--feature-3", "-fsl", "2", "--feature-70", "--feature-149"});
+
+    REQUIRE(fast);
+    REQUIRE(features[safe.bit()]);
+    REQUIRE(members[3]);
+    REQUIRE_FALSE(members[4]);
+    REQUIRE(*level == 2);
+    REQUIRE(features.all(both));
+    REQUIRE(features.any(features.mask({4, 70})));
+    REQUIRE_FALSE(features.all(features.mask({4, 70})));
+    REQUIRE(features.count() == 5);
+
+    auto set = std::vector<size_t>(features.begin(), features.end());
+    REQUIRE(set == std::vector<size_t>{3, 70, 149, 150, 151});
+    REQUIRE(features.diff(before) == features.bits());
+    REQUIRE((features.bits() - both).count() == 3);
+
+    auto other = arg::FlagBits{features.size()};
+    other.set(3);
+    other.set(5);
+    auto changed = features.diff(other);
+    REQUIRE(std::vector<size_t>(changed.begin(), changed.end()) ==
+        std::vector<size_t>{5, 70, 149, 150, 151});
+
+    auto help = std::ostringstream{};
+    parser.printHelp(help);
+    REQUIRE(help.str().find("-f, --fast") != std::string::npos);
+    // Flags of a set round-trip through toArgv like plain flags
+    auto argv = parser.toArgv();
+    auto tokens = std::vector<std::string_view>{};
+    for (size_t i = 1; i < argv.size(); i++) {
+        tokens.push_back(argv[i]);
+    }
+    const auto parsed = features.bits();
+    for (auto bit : parsed) {
+        features.set(bit, false);
+    }
+    parser.parse(tokens);
+    REQUIRE(features.bits() == parsed);
+
+    // Flags of two sets can be added in any order, and a set outlives the
+    // handles it was built through
+    auto modes = arg::FlagSet{};
+    auto second = arg::Parser{};
+    auto dry = second.flag(modes).keys("-n");
+    auto slow = second.flag(features).keys("--slow");
+    auto loud = second.flag(modes).keys("-v");
+    REQUIRE(loud.bit() == 1);
+    second.parse(std::vector<std::string>{"-v", "--slow"});
+    REQUIRE_FALSE(dry);
+    REQUIRE(loud);
+    REQUIRE(slow);
+    REQUIRE(features.count() == parsed.count() + 1);
+}
+
+TEST_CASE("Static parser")
+{
+    static constinit auto parser = arg::StaticParser<8, 2>{};
+    bool verbose = false;
+    bool force = false;
+    int level = 0;
+    int jobs = 1;
+    double ratio = 0;
+    std::string_view name;
+    std::string_view input;
+    std::array<std::string_view, 3> rest;
+    size_t restCount = 0;
+
+    const auto before = allocations.load();
+    parser.flag(verbose, "-v", "--verbose");
+    parser.flag(force, "-f");
+    parser.multiFlag(level, "-l");
+    parser.option(jobs, "-j", "--jobs");
+    parser.option(ratio, "--ratio");
+    parser.option(name, "-n", "--name");
+    parser.helpKeys("-h", "--help");
+    parser.argument(input, "INPUT");
+    parser.multiArgument(
+        std::span<std::string_view>{rest}, restCount, "REST");
+
+    char program[] = "program";
+    char packed[] = "-vllj4";
+    char ratioValue[] = "--ratio=0.5";
+    char nameKey[] = "--name";
+    char nameValue[] = "alpha";
+    char first[] = "in.txt";
+    char end[] = "--";
+    char dashed[] = "-f";
+    char* argv[] = {program, packed, ratioValue, nameKey, nameValue, first,
+        end, dashed, nullptr};
+    auto result = parser.parse(8, argv);
+    const auto after = allocations.load();
+
+    REQUIRE(after == before);
+    REQUIRE(result);
+    REQUIRE(verbose);
+    REQUIRE_FALSE(force);
+    REQUIRE(level == 2);
+    REQUIRE(jobs == 4);
+    REQUIRE(ratio == 0.5);
+    REQUIRE(name == "alpha");
+    REQUIRE(input == "in.txt");
+    REQUIRE(restCount == 1);
+    REQUIRE(rest[0] == "-f");
+
+    using Status = arg::StaticResult::Status;
+    auto parse = [] (std::initializer_list<std::string_view> args) {
+        return parser.parse(args);
+    };
+    REQUIRE(parse({"in", "-j"}).status == Status::MissingValue);
+    REQUIRE(parse({"in", "-j", "four"}).status == Status::InvalidValue);
+    REQUIRE(parse({"in", "-j", "four"}).token == "-j");
+    REQUIRE(parse({"in", "-v=1"}).status == Status::UnexpectedValue);
+    REQUIRE(parse({"in", "--help"}).status == Status::Help);
+    REQUIRE(parse({"in", "a", "b", "c", "d"}).status == Status::TooManyValues);
+    REQUIRE(parse({"in", "a", "b", "c", "d"}).token == "d");
+    REQUIRE(parse({"-v"}).status == Status::MissingArgument);
+    REQUIRE(parse({"-v"}).token == "INPUT");
+    REQUIRE(parse({"-x", "b"}));
+    REQUIRE(input == "-x");
+    REQUIRE(restCount == 1);
+
+    auto small = arg::StaticParser<1, 0>{};
+    small.flag(force, "-f");
+    const auto x = std::array<std::string_view, 1>{"x"};
+    REQUIRE(small.parse(x).status == Status::UnexpectedArgument);
+#if defined(ARG_EXCEPTIONS)
+    REQUIRE_THROWS(small.flag(verbose, "-v"));
+#endif
+}
+
+TEST_CASE("Generated parsers")
+{
+    using generated::TestOptions;
+    using generated::TestOptionsParser;
+
+    // The same options, defined at run time
+    auto parser = arg::Parser{};
+    parser.config.helpWidth = 60;
+    parser.programName("test");
+    parser.helpKeys("-h", "--help");
+    auto verbose = parser.flag().keys("-v", "--verbose").help("Print more");
+    auto level = parser.multiFlag().keys("-l")
+        .help("Raise the level, once per use");
+    auto jobs = parser.option<int>().keys("-j", "--jobs").metavar("N")
+        .help("Jobs to run at once");
+    auto ratio = parser.option<double>().keys("--ratio").markRequired();
+    auto timeout = parser.option<std::chrono::milliseconds>()
+        .keys("-t", "--timeout").section("Network")
+        .help("Time to wait for \"each\" reply");
+    auto tags = parser.multiOption<std::string>().keys("--tag")
+        .section("Filtering").help("Only run tests with this tag");
+    auto input = parser.argument<std::string>().metavar("INPUT")
+        .markRequired().help("File to read");
+    auto rest = parser.multiArgument<std::string>().metavar("REST");
+
+    auto runtimeHelp = std::ostringstream{};
+    parser.printHelp(runtimeHelp);
+    REQUIRE(TestOptionsParser::help == runtimeHelp.str());
+
+    auto generate = [] (std::string_view commandLine, TestOptions& options) {
+        auto args = std::vector<std::string_view>{};
+        auto scratch = std::string{};
+        arg::internal::splitCommandLine(commandLine, args, scratch);
+        auto help = std::string_view{};
+        auto errors = TestOptionsParser::tryParse(args, options, help);
+        auto output = std::ostringstream{};
+        for (const auto& error : errors) {
+            arg::err::print(output, error);
+        }
+        return std::pair{output.str(), std::string{help}};
+    };
+    auto expected = [&] (std::string_view commandLine) {
+        auto errors = parser.tryParse(commandLine);
+        auto output = std::ostringstream{};
+        for (const auto& error : errors) {
+            arg::err::print(output, error);
+        }
+        return output.str();
+    };
+
+    auto options = TestOptions{};
+    REQUIRE(options.jobs == 1);
+    REQUIRE(options.timeout == std::chrono::milliseconds{250});
+    auto [errors, help] = generate(
+        "-vll -j4 --ratio=0.5 in.txt --tag a -t 2s --tag=b x -- -v",
+        options);
+    REQUIRE(errors.empty());
+    REQUIRE(help.empty());
+    REQUIRE(options.verbose);
+    REQUIRE(options.level == 2);
+    REQUIRE(options.jobs == 4);
+    REQUIRE(options.ratio == 0.5);
+    REQUIRE(options.timeout == std::chrono::seconds{2});
+    REQUIRE(options.tags == std::vector<std::string>{"a", "b"});
+    REQUIRE(options.input == "in.txt");
+    REQUIRE(options.rest == std::vector<std::string>{"x", "-v"});
+
+    // Errors are the same as those of the runtime parser
+    for (auto commandLine : {
+            "",
+            "in --ratio",
+            "in --ratio x -j",
+            "in --ratio 1 -j two --jobs=three -jfour",
+            "in --ratio 1 -v=1 --nope",
+            "in --ratio 1 --timeout=5 --timeout 1parsec",
+            "--help=Nowhere"}) {
+        options = TestOptions{};
+        CHECK(generate(commandLine, options).first == expected(commandLine));
+    }
+
+    options = TestOptions{};
+    help = generate("-h", options).second;
+    REQUIRE(help == TestOptionsParser::help);
+    help = generate("--help=Network", options).second;
+    runtimeHelp.str({});
+    parser.printHelp(runtimeHelp, "Network");
+    REQUIRE(help == runtimeHelp.str());
+}
+
+TEST_CASE("Mapped files")
+{
+    auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+    auto path = (std::filesystem::temp_directory_path() /
+        ("arg_test_mapped_" + std::to_string(stamp))).string();
+    std::ofstream{path, std::ios::binary} << "weights\n";
+
+    auto parser = arg::Parser{};
+    auto weights = parser.option<arg::MappedFile>().keys("--weights");
+    auto rules = parser.multiOption<arg::MappedFile>().keys("--rules");
+    parser.parse(std::vector<std::string>{
+        "--weights=@" + path, "--rules", path, "--rules", "@/no/such/file"});
+    weights->access(arg::MappedFile::Access::Random);
+
+    // Nothing is read until the contents are asked for
+    REQUIRE(weights->path() == path);
+    REQUIRE(weights->access() == arg::MappedFile::Access::Random);
+    REQUIRE_FALSE(weights->mapped());
+    REQUIRE(weights->data() == "weights\n");
+    REQUIRE(weights->mapped());
+
+    auto copy = *weights;
+    REQUIRE(copy.mapped());
+    REQUIRE(copy.data().data() == weights->data().data());
+
+    REQUIRE(rules.vector().size() == 2);
+    REQUIRE(rules.vector()[0].size() == 8);
+    REQUIRE(rules.vector()[1].path() == "/no/such/file");
+    REQUIRE(rules.vector()[1].empty());
+    REQUIRE_FALSE(rules.vector()[1].readable());
+    REQUIRE(rules.vector()[1].error() == ENOENT);
+    REQUIRE(weights->readable());
+
+    // An empty file is readable, unlike a missing one
+    std::ofstream{path + ".empty"};
+    auto empty = arg::MappedFile{path + ".empty"};
+    REQUIRE(empty.empty());
+    REQUIRE(empty.readable());
+    std::filesystem::remove(path + ".empty");
+
+    auto argv = parser.toArgv();
+    REQUIRE(argv[1] == "--weights=@" + path);
+
+    auto errors = parser.tryParse(std::vector<std::string>{"--weights=@"});
+    REQUIRE(errors.size() == 1);
+    std::filesystem::remove(path);
+}
+
+// Parse time must grow linearly on inputs built to hit the slow paths. Each
+// shape is timed at a size and at eight times that size; the larger run may
+// take up to three times longer than linear growth allows, while quadratic
+// work would take 64 times longer.
+TEST_CASE("Adversarial inputs")
+{
+    // Timing of these shapes at scale is in arg_bench; here they only have
+    // to parse correctly
+    struct Fixture {
+        arg::Parser parser;
+        arg::MultiFlag verbose = parser.multiFlag().keys("-v");
+        arg::Option<std::string> name =
+            parser.option<std::string>().keys("-n", "--name");
+        arg::MultiOption<Mode> modes = parser.multiOption<Mode>()
+            .keys("--mode").choices({
+                {"fast", Mode::Fast}, {"safe", Mode::Safe},
+                {"slow", Mode::Slow}});
+        arg::MultiValue<std::string> rest =
+            parser.multiArgument<std::string>();
+
+        bool parse(std::vector<std::string> args)
+        {
+            return parser.tryParse(args).empty();
+        }
+    };
+    const size_t n = 1 << 12;
+
+    SECTION("one long pack") {
+        auto f = Fixture{};
+        REQUIRE(f.parse({"-" + std::string(n, 'v')}));
+        REQUIRE(*f.verbose == n);
+    }
+    SECTION("packs that fail at their last character") {
+        auto f = Fixture{};
+        const auto pack = "-" + std::string(255, 'v') + "x";
+        REQUIRE(f.parse(std::vector<std::string>(16, pack)));
+        REQUIRE(*f.verbose == 0);
+        REQUIRE(f.rest.vector() == std::vector<std::string>(16, pack));
+    }
+    SECTION("long keys and values made of separators") {
+        auto f = Fixture{};
+        REQUIRE(f.parse({"--name=" + std::string(n, '=')}));
+        REQUIRE(*f.name == std::string(n, '='));
+        REQUIRE(f.parse({"-n" + std::string(n, '-')}));
+        REQUIRE(*f.name == std::string(n, '-'));
+        const auto unknown = "--" + std::string(n, 'x') + "=" +
+            std::string(n, '=');
+        REQUIRE(f.parse({unknown, "--", std::string(n, '-')}));
+        REQUIRE(f.rest.vector() ==
+            std::vector<std::string>{unknown, std::string(n, '-')});
+    }
+    SECTION("many short tokens") {
+        auto f = Fixture{};
+        auto args = std::vector<std::string>{};
+        for (size_t i = 0; i < n; i++) {
+            args.insert(args.end(), {"-vv", "--mode=fast", "-n", "name"});
+        }
+        REQUIRE(f.parse(args));
+        REQUIRE(*f.verbose == 2 * n);
+        REQUIRE(f.modes.vector() == std::vector<Mode>(n, Mode::Fast));
+        REQUIRE(*f.name == "name");
+    }
+
+    // Options and constraints grow with the arguments
+    SECTION("many options and constraints") {
+        auto wide = arg::Parser{};
+        auto args = std::vector<std::string>{};
+        for (size_t i = 0; i < n; i++) {
+            auto key = "--o" + std::to_string(i);
+            std::ignore = wide.flag().keys(key);
+            if (i > 0) {
+                wide.dependsOn(key, "--o" + std::to_string(i - 1));
+                wide.mutuallyExclusive(key, "--o0");
+                args.push_back(key);
+            }
+        }
+        REQUIRE(wide.tryParse(args).size() == 1);
+    }
+}
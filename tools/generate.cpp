@@ -0,0 +1,1342 @@
+// arg_generate: turns a JSON schema into a header with a parser made for it.
+//
+//     arg_generate schema.json gen.hpp
+//
+// The schema names a struct to parse into and its fields:
+//
+//     {
+//         "namespace": "app",
+//         "struct": "Options",
+//         "program": "app",
+//         "helpKeys": ["-h", "--help"],
+//         "includes": ["<chrono>"],
+//         "options": [
+//             {"name": "verbose", "keys": ["-v"], "type": "flag"},
+//             {"name": "level", "keys": ["-l"], "type": "count"},
+//             {"name": "jobs", "keys": ["-j", "--jobs"], "type": "int",
+//                 "default": "1", "metavar": "N", "help": "Jobs to run"},
+//             {"name": "tags", "keys": ["--tag"], "type": "std::string",
+//                 "multi": true, "section": "Filtering"}
+//         ],
+//         "arguments": [
+//             {"name": "input", "type": "std::string", "required": true},
+//             {"name": "rest", "type": "std::string", "multi": true}
+//         ]
+//     }
+//
+// Types are C++ types read with arg::read, or "flag" and "count". A multi
+// field is a std::vector of its type. "helpWidth", "packPrefix",
+// "keyValueSeparator" and "endOfOptions" work as in Parser::Config.
+//
+// The generated parser finds keys with a minimal perfect hash, dispatches on
+// option ids with switches, stores values straight into the struct and
+// prints help that was rendered here, by arg::Parser itself. It includes
+// only arg/converters.hpp and arg/errors.hpp.
+
+#include <arg/parser.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct Json {
+    enum class Kind {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object,
+    };
+
+    [[nodiscard]] const Json* find(std::string_view key) const
+    {
+        for (const auto& [name, value] : members) {
+            if (name == key) {
+                return &value;
+            }
+        }
+        return nullptr;
+    }
+
+    Kind kind = Kind::Null;
+    bool boolean = false;
+    // A string, or a number as it was written
+    std::string text;
+    std::vector<Json> items;
+    std::vector<std::pair<std::string, Json>> members;
+};
+
+// Reads the JSON of a schema. Numbers are kept as text; \u escapes are
+// encoded as UTF-8.
+class JsonReader {
+public:
+    explicit JsonReader(std::string_view text)
+        : _text(text)
+    { }
+
+    bool read(Json& value)
+    {
+        if (!readValue(value, 0)) {
+            return false;
+        }
+        skipSpace();
+        return _position == _text.size() || fail("trailing characters");
+    }
+
+    [[nodiscard]] const std::string& error() const
+    {
+        return _error;
+    }
+
+private:
+    bool fail(std::string_view message)
+    {
+        auto line = 1 + std::count(
+            _text.begin(), _text.begin() + static_cast<std::ptrdiff_t>(
+                std::min(_position, _text.size())), '\n');
+        _error = "line " + std::to_string(line) + ": " + std::string{message};
+        return false;
+    }
+
+    void skipSpace()
+    {
+        while (_position < _text.size() &&
+                std::string_view{" \t\r\n"}.find(_text[_position]) !=
+                    std::string_view::npos) {
+            _position++;
+        }
+    }
+
+    bool consume(std::string_view word)
+    {
+        if (_text.substr(_position).starts_with(word)) {
+            _position += word.size();
+            return true;
+        }
+        return false;
+    }
+
+    bool readValue(Json& value, int depth)
+    {
+        if (depth > 64) {
+            return fail("nested too deeply");
+        }
+        skipSpace();
+        if (_position == _text.size()) {
+            return fail("unexpected end of input");
+        }
+        const char c = _text[_position];
+        if (c == '{') {
+            return readObject(value, depth);
+        }
+        if (c == '[') {
+            return readArray(value, depth);
+        }
+        if (c == '"') {
+            value.kind = Json::Kind::String;
+            return readString(value.text);
+        }
+        for (bool boolean : {true, false}) {
+            if (consume(boolean ? "true" : "false")) {
+                value.kind = Json::Kind::Bool;
+                value.boolean = boolean;
+                return true;
+            }
+        }
+        if (consume("null")) {
+            value.kind = Json::Kind::Null;
+            return true;
+        }
+        const auto start = _position;
+        while (_position < _text.size() &&
+                std::string_view{"+-.0123456789eE"}.find(_text[_position]) !=
+                    std::string_view::npos) {
+            _position++;
+        }
+        if (_position == start) {
+            return fail("unexpected character");
+        }
+        value.kind = Json::Kind::Number;
+        value.text = _text.substr(start, _position - start);
+        return true;
+    }
+
+    bool readObject(Json& value, int depth)
+    {
+        value.kind = Json::Kind::Object;
+        _position++;
+        skipSpace();
+        if (consume("}")) {
+            return true;
+        }
+        for (;;) {
+            skipSpace();
+            auto name = std::string{};
+            if (!consume("\"")) {
+                return fail("expected a member name");
+            }
+            _position--;
+            if (!readString(name)) {
+                return false;
+            }
+            skipSpace();
+            if (!consume(":")) {
+                return fail("expected ':'");
+            }
+            auto member = Json{};
+            if (!readValue(member, depth + 1)) {
+                return false;
+            }
+            value.members.emplace_back(std::move(name), std::move(member));
+            skipSpace();
+            if (consume("}")) {
+                return true;
+            }
+            if (!consume(",")) {
+                return fail("expected ',' or '}'");
+            }
+        }
+    }
+
+    bool readArray(Json& value, int depth)
+    {
+        value.kind = Json::Kind::Array;
+        _position++;
+        skipSpace();
+        if (consume("]")) {
+            return true;
+        }
+        for (;;) {
+            auto item = Json{};
+            if (!readValue(item, depth + 1)) {
+                return false;
+            }
+            value.items.push_back(std::move(item));
+            skipSpace();
+            if (consume("]")) {
+                return true;
+            }
+            if (!consume(",")) {
+                return fail("expected ',' or ']'");
+            }
+        }
+    }
+
+    bool readString(std::string& output)
+    {
+        _position++;
+        while (_position < _text.size()) {
+            const char c = _text[_position++];
+            if (c == '"') {
+                return true;
+            }
+            if (c != '\\') {
+                output += c;
+                continue;
+            }
+            if (_position == _text.size()) {
+                break;
+            }
+            const char escaped = _text[_position++];
+            switch (escaped) {
+                case '"': output += '"'; break;
+                case '\\': output += '\\'; break;
+                case '/': output += '/'; break;
+                case 'b': output += '\b'; break;
+                case 'f': output += '\f'; break;
+                case 'n': output += '\n'; break;
+                case 'r': output += '\r'; break;
+                case 't': output += '\t'; break;
+                case 'u': {
+                    uint32_t code = 0;
+                    if (!readHex(code)) {
+                        return fail("bad \\u escape");
+                    }
+                    appendUtf8(output, code);
+                    break;
+                }
+                default:
+                    return fail("bad escape");
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool readHex(uint32_t& code)
+    {
+        if (_text.size() - _position < 4) {
+            return false;
+        }
+        for (int i = 0; i < 4; i++) {
+            const char c = _text[_position++];
+            code <<= 4;
+            if (c >= '0' && c <= '9') {
+                code |= static_cast<uint32_t>(c - '0');
+            } else if (c >= 'a' && c <= 'f') {
+                code |= static_cast<uint32_t>(c - 'a' + 10);
+            } else if (c >= 'A' && c <= 'F') {
+                code |= static_cast<uint32_t>(c - 'A' + 10);
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void appendUtf8(std::string& output, uint32_t code)
+    {
+        if (code < 0x80) {
+            output += static_cast<char>(code);
+        } else if (code < 0x800) {
+            output += static_cast<char>(0xc0 | (code >> 6));
+            output += static_cast<char>(0x80 | (code & 0x3f));
+        } else {
+            output += static_cast<char>(0xe0 | (code >> 12));
+            output += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+            output += static_cast<char>(0x80 | (code & 0x3f));
+        }
+    }
+
+    std::string_view _text;
+    size_t _position = 0;
+    std::string _error;
+};
+
+struct Field {
+    std::string name;
+    std::string type;
+    std::vector<std::string> keys;
+    std::string defaultValue;
+    std::string metavar = "VALUE";
+    std::string help;
+    std::string section;
+    bool multi = false;
+    bool required = false;
+
+    [[nodiscard]] bool flag() const
+    {
+        return type == "flag";
+    }
+
+    [[nodiscard]] bool count() const
+    {
+        return type == "count";
+    }
+
+    [[nodiscard]] bool hasValue() const
+    {
+        return !flag() && !count();
+    }
+
+    [[nodiscard]] std::string cppType() const
+    {
+        if (flag()) {
+            return "bool";
+        }
+        if (count()) {
+            return "size_t";
+        }
+        return multi ? "std::vector<" + type + ">" : type;
+    }
+
+    [[nodiscard]] std::string keyString() const
+    {
+        auto result = std::string{};
+        for (const auto& key : keys) {
+            if (!result.empty()) {
+                result += ", ";
+            }
+            result += key;
+        }
+        return result;
+    }
+};
+
+struct Schema {
+    std::string nameSpace;
+    std::string structName = "Options";
+    std::string program = "<program>";
+    size_t helpWidth = 80;
+    std::string packPrefix = "-";
+    std::string keyValueSeparator = "=";
+    std::string endOfOptions = "--";
+    std::vector<std::string> helpKeys;
+    std::vector<std::string> includes;
+    std::vector<Field> options;
+    std::vector<Field> arguments;
+};
+
+bool isIdentifier(std::string_view name)
+{
+    auto isAlpha = [] (char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    };
+    return !name.empty() && isAlpha(name.front()) &&
+        std::all_of(name.begin(), name.end(), [&] (char c) {
+            return isAlpha(c) || (c >= '0' && c <= '9');
+        });
+}
+
+// Reads a schema, reporting the first thing that is wrong with it
+class SchemaReader {
+public:
+    bool read(const Json& json, Schema& schema)
+    {
+        if (json.kind != Json::Kind::Object) {
+            return fail("schema is not an object");
+        }
+        if (!text(json, "namespace", schema.nameSpace) ||
+                !text(json, "struct", schema.structName) ||
+                !text(json, "program", schema.program) ||
+                !text(json, "packPrefix", schema.packPrefix) ||
+                !text(json, "keyValueSeparator", schema.keyValueSeparator) ||
+                !text(json, "endOfOptions", schema.endOfOptions) ||
+                !texts(json, "helpKeys", schema.helpKeys) ||
+                !texts(json, "includes", schema.includes)) {
+            return false;
+        }
+        if (const auto* width = json.find("helpWidth")) {
+            if (width->kind != Json::Kind::Number ||
+                    !arg::read(width->text, schema.helpWidth)) {
+                return fail("helpWidth is not a number");
+            }
+        }
+        if (!isIdentifier(schema.structName)) {
+            return fail("struct is not an identifier");
+        }
+        return fields(json, "options", true, schema.options) &&
+            fields(json, "arguments", false, schema.arguments);
+    }
+
+    [[nodiscard]] const std::string& error() const
+    {
+        return _error;
+    }
+
+private:
+    bool fail(std::string message)
+    {
+        _error = std::move(message);
+        return false;
+    }
+
+    bool text(const Json& json, std::string_view name, std::string& value)
+    {
+        const auto* member = json.find(name);
+        if (!member) {
+            return true;
+        }
+        if (member->kind == Json::Kind::Number) {
+            value = member->text;
+            return true;
+        }
+        if (member->kind != Json::Kind::String) {
+            return fail(std::string{name} + " is not a string");
+        }
+        value = member->text;
+        return true;
+    }
+
+    bool flag(const Json& json, std::string_view name, bool& value)
+    {
+        const auto* member = json.find(name);
+        if (!member) {
+            return true;
+        }
+        if (member->kind != Json::Kind::Bool) {
+            return fail(std::string{name} + " is not true or false");
+        }
+        value = member->boolean;
+        return true;
+    }
+
+    bool texts(
+        const Json& json,
+        std::string_view name,
+        std::vector<std::string>& values)
+    {
+        const auto* member = json.find(name);
+        if (!member) {
+            return true;
+        }
+        if (member->kind != Json::Kind::Array) {
+            return fail(std::string{name} + " is not an array");
+        }
+        for (const auto& item : member->items) {
+            if (item.kind != Json::Kind::String || item.text.empty()) {
+                return fail(std::string{name} + " holds a non-string");
+            }
+            values.push_back(item.text);
+        }
+        return true;
+    }
+
+    bool fields(
+        const Json& json,
+        std::string_view name,
+        bool keyed,
+        std::vector<Field>& fields)
+    {
+        const auto* member = json.find(name);
+        if (!member) {
+            return true;
+        }
+        if (member->kind != Json::Kind::Array) {
+            return fail(std::string{name} + " is not an array");
+        }
+        for (const auto& item : member->items) {
+            auto field = Field{};
+            if (item.kind != Json::Kind::Object) {
+                return fail(std::string{name} + " holds a non-object");
+            }
+            if (!text(item, "name", field.name) ||
+                    !text(item, "type", field.type) ||
+                    !text(item, "default", field.defaultValue) ||
+                    !text(item, "metavar", field.metavar) ||
+                    !text(item, "help", field.help) ||
+                    !text(item, "section", field.section) ||
+                    !texts(item, "keys", field.keys) ||
+                    !flag(item, "multi", field.multi) ||
+                    !flag(item, "required", field.required)) {
+                return false;
+            }
+            if (!isIdentifier(field.name)) {
+                return fail("field name is not an identifier: " + field.name);
+            }
+            if (field.type.empty()) {
+                return fail(field.name + " has no type");
+            }
+            if (keyed && field.keys.empty()) {
+                return fail(field.name + " has no keys");
+            }
+            if (!keyed && (!field.hasValue() || !field.keys.empty())) {
+                return fail(field.name + " is an argument with keys");
+            }
+            if (!field.hasValue() && (field.multi || field.required)) {
+                return fail(field.name + " is a flag that is multi or " +
+                    "required");
+            }
+            if (field.multi && field.required) {
+                return fail(field.name + " is multi and required");
+            }
+            if (!keyed && !item.find("metavar")) {
+                field.metavar = field.name;
+                std::transform(
+                    field.metavar.begin(), field.metavar.end(),
+                    field.metavar.begin(), [] (char c) {
+                        return c >= 'a' && c <= 'z' ?
+                            static_cast<char>(c - 'a' + 'A') : c;
+                    });
+            }
+            fields.push_back(std::move(field));
+        }
+        return true;
+    }
+
+    std::string _error;
+};
+
+// Help as arg::Parser renders it for the same options, in full and by
+// section
+struct RenderedHelp {
+    std::string full;
+    std::vector<std::pair<std::string, std::string>> sections;
+};
+
+RenderedHelp renderHelp(const Schema& schema)
+{
+    auto parser = arg::Parser{};
+    parser.config.helpWidth = schema.helpWidth;
+    parser.programName(schema.program);
+    auto sections = std::vector<std::string>{};
+    for (const auto& field : schema.options) {
+        if (!field.section.empty() &&
+                std::find(sections.begin(), sections.end(), field.section) ==
+                    sections.end()) {
+            sections.push_back(field.section);
+        }
+        if (field.flag()) {
+            parser.flag().keys(field.keys).help(field.help)
+                .section(field.section);
+        } else if (field.count()) {
+            parser.multiFlag().keys(field.keys).help(field.help)
+                .section(field.section);
+        } else if (field.multi) {
+            parser.multiOption<std::string>().keys(field.keys)
+                .metavar(field.metavar).help(field.help)
+                .section(field.section);
+        } else {
+            auto option = parser.option<std::string>().keys(field.keys)
+                .metavar(field.metavar).help(field.help)
+                .section(field.section);
+            if (field.required) {
+                option.markRequired();
+            }
+        }
+    }
+    for (const auto& field : schema.arguments) {
+        if (field.multi) {
+            parser.multiArgument<std::string>()
+                .metavar(field.metavar).help(field.help);
+        } else {
+            auto argument = parser.argument<std::string>()
+                .metavar(field.metavar).help(field.help);
+            if (field.required) {
+                argument.markRequired();
+            }
+        }
+    }
+
+    auto help = RenderedHelp{};
+    auto output = std::ostringstream{};
+    parser.printHelp(output);
+    help.full = output.str();
+    for (const auto& section : sections) {
+        output.str({});
+        parser.printHelp(output, section);
+        help.sections.emplace_back(section, output.str());
+    }
+    return help;
+}
+
+// The hash of the generated parser, repeated there
+uint32_t hash(std::string_view key, uint32_t seed)
+{
+    auto h = uint32_t{2166136261} ^ seed;
+    for (char c : key) {
+        h = (h ^ static_cast<unsigned char>(c)) * 16777619;
+    }
+    h ^= h >> 16;
+    h *= 0x7feb352d;
+    h ^= h >> 15;
+    return h;
+}
+
+// A minimal perfect hash over keys, by hash and displace: keys are put into
+// buckets by their hash with seed 0, and each bucket gets the seed that
+// sends all of its keys to free slots. Buckets of one key store their slot
+// directly, as -slot - 1.
+bool perfectHash(
+    const std::vector<std::string>& keys,
+    std::vector<int32_t>& displacements,
+    std::vector<uint32_t>& slots)
+{
+    const auto n = static_cast<uint32_t>(keys.size());
+    displacements.assign(n, 0);
+    slots.assign(n, 0);
+    if (n == 0) {
+        return true;
+    }
+
+    auto buckets = std::vector<std::vector<uint32_t>>(n);
+    for (uint32_t k = 0; k < n; k++) {
+        buckets[hash(keys[k], 0) % n].push_back(k);
+    }
+    auto order = std::vector<uint32_t>(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&] (auto a, auto b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    auto used = std::vector<bool>(n);
+    auto taken = std::vector<uint32_t>{};
+    size_t next = 0;
+    for (auto b : order) {
+        const auto& bucket = buckets[b];
+        if (bucket.empty()) {
+            break;
+        }
+        if (bucket.size() == 1) {
+            while (used[next]) {
+                next++;
+            }
+            used[next] = true;
+            slots[bucket.front()] = static_cast<uint32_t>(next);
+            displacements[b] = -static_cast<int32_t>(next) - 1;
+            continue;
+        }
+
+        bool placed = false;
+        for (uint32_t seed = 1; seed < (1u << 24) && !placed; seed++) {
+            taken.clear();
+            placed = true;
+            for (auto k : bucket) {
+                const auto slot = hash(keys[k], seed) % n;
+                if (used[slot] || std::find(
+                        taken.begin(), taken.end(), slot) != taken.end()) {
+                    placed = false;
+                    break;
+                }
+                taken.push_back(slot);
+            }
+            if (placed) {
+                for (size_t i = 0; i < bucket.size(); i++) {
+                    used[taken[i]] = true;
+                    slots[bucket[i]] = taken[i];
+                }
+                displacements[b] = static_cast<int32_t>(seed);
+            }
+        }
+        if (!placed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A C++ string literal for text, split after each line break
+std::string literal(std::string_view text, std::string_view indent)
+{
+    auto result = std::string{"\""};
+    for (size_t i = 0; i < text.size(); i++) {
+        const auto c = static_cast<unsigned char>(text[i]);
+        switch (c) {
+            case '"': result += "\\\""; break;
+            case '\\': result += "\\\\"; break;
+            case '\t': result += "\\t"; break;
+            case '\n':
+                result += "\\n";
+                if (i + 1 < text.size()) {
+                    result += "\"\n";
+                    result += indent;
+                    result += '"';
+                }
+                break;
+            default:
+                if (c < 0x20 || c == 0x7f) {
+                    char escaped[5];
+                    std::snprintf(escaped, sizeof(escaped), "\\%03o", c);
+                    result += escaped;
+                } else {
+                    result += static_cast<char>(c);
+                }
+        }
+    }
+    return result + '"';
+}
+
+std::string characterLiteral(char c)
+{
+    const auto code = static_cast<unsigned char>(c);
+    if (c == '\'' || c == '\\') {
+        return std::string{"'\\"} + c + "'";
+    }
+    if (code < 0x20 || code >= 0x7f) {
+        char escaped[7];
+        std::snprintf(escaped, sizeof(escaped), "'\\%03o'", code);
+        return escaped;
+    }
+    return std::string{"'"} + c + "'";
+}
+
+// Items of an array initializer, as many to a line as fit in 80 columns
+template <class T, class F>
+std::string table(const std::vector<T>& items, F&& format)
+{
+    auto result = std::string{};
+    size_t column = 0;
+    for (const auto& item : items) {
+        const auto text = format(item) + ",";
+        if (column > 0 && column + 1 + text.size() > 80) {
+            result += "\n";
+            column = 0;
+        }
+        if (column == 0) {
+            result += "        ";
+            column = 8;
+        } else {
+            result += " ";
+            column++;
+        }
+        result += text;
+        column += text.size();
+    }
+    return items.empty() ? result : result + "\n";
+}
+
+// Replaces each @name@ in text with its value
+std::string fill(
+    std::string_view text,
+    const std::unordered_map<std::string_view, std::string>& values)
+{
+    auto result = std::string{};
+    for (;;) {
+        const auto start = text.find('@');
+        if (start == std::string_view::npos) {
+            return result + std::string{text};
+        }
+        const auto end = text.find('@', start + 1);
+        result += text.substr(0, start);
+        result += values.at(text.substr(start + 1, end - start - 1));
+        text.remove_prefix(end + 1);
+    }
+}
+
+// The parts of the generated parser that do not depend on the schema
+constexpr std::string_view parserTemplate = R"(
+class @parser@ {
+public:
+    static constexpr std::string_view programName = @program@;
+
+    static constexpr std::string_view help =
+        @help@;
+
+    // Reads the arguments that follow the program name into options, with
+    // the same rules and errors as arg::Parser. When a help key is given,
+    // help is set to the text to print.
+    static std::vector<arg::err::Error> tryParse(
+        std::span<const std::string_view> args,
+        @struct@& options,
+        std::string_view& help)
+    {
+        std::vector<arg::err::Error> errors;
+        std::array<bool, optionCount> given{};
+        std::array<bool, argumentCount> argumentGiven{};
+        size_t position = 0;
+        bool optionsEnded = false;
+        help = {};
+
+        auto invalid = [&] (std::string_view keys, std::string_view value) {
+            errors.emplace_back(arg::err::InvalidValueGiven{
+                std::string{keys}, std::string{value},
+                std::nullopt, std::nullopt});
+        };
+
+        for (size_t i = 0; i < args.size(); i++) {
+            const auto token = args[i];
+            if (!optionsEnded) {
+                auto id = find(token);
+                if (id < 0 && !endOfOptions.empty() && token == endOfOptions) {
+                    optionsEnded = true;
+                    continue;
+                }
+                if (id == helpId) {
+                    help = @parser@::help;
+                    continue;
+                }
+                if (id >= 0) {
+                    if (!hasValue[id]) {
+                        given[id] = true;
+                        raise(id, options);
+                    } else if (i + 1 == args.size()) {
+                        errors.emplace_back(
+                            arg::err::RequiredOptionValueNotGiven{
+                                std::string{token}});
+                    } else if (read(id, args[++i], options)) {
+                        given[id] = true;
+                    } else {
+                        invalid(keyStrings[id], args[i]);
+                    }
+                    continue;
+                }
+
+                const auto separator = keyValueSeparator.empty() ?
+                    std::string_view::npos : token.find(keyValueSeparator);
+                if (separator != std::string_view::npos) {
+                    const auto key = token.substr(0, separator);
+                    const auto value =
+                        token.substr(separator + keyValueSeparator.size());
+                    id = find(key);
+                    if (id == helpId) {
+                        help = section(value);
+                        if (help.empty()) {
+                            help = @parser@::help;
+                            errors.emplace_back(arg::err::UnknownHelpSection{
+                                std::string{value}, std::string{sections}});
+                        }
+                        continue;
+                    }
+                    if (id >= 0 && !hasValue[id]) {
+                        errors.emplace_back(
+                            arg::err::UnexpectedOptionValueGiven{
+                                std::string{key}, std::string{value}});
+                        continue;
+                    }
+                    if (id >= 0) {
+                        if (read(id, value, options)) {
+                            given[id] = true;
+                        } else {
+                            invalid(key, value);
+                        }
+                        continue;
+                    }
+                }
+
+                if (!packPrefix.empty() && token.starts_with(packPrefix)) {
+                    // A run of flags, optionally ending with an option that
+                    // takes the rest of the token, or the next one, as value
+                    const auto chars = token.substr(packPrefix.size());
+                    size_t length = 0;
+                    int last = -1;
+                    while (length < chars.size()) {
+                        last = packed(chars[length]);
+                        if (last < 0) {
+                            break;
+                        }
+                        length++;
+                        if (hasValue[last]) {
+                            break;
+                        }
+                    }
+                    if (last >= 0 && length > 0) {
+                        for (size_t k = 0; k + 1 < length; k++) {
+                            // Flags, as the scan above found
+                            if (const auto id = packed(chars[k]); id >= 0) {
+                                given[id] = true;
+                                raise(id, options);
+                            }
+                        }
+                        if (!hasValue[last]) {
+                            given[last] = true;
+                            raise(last, options);
+                            continue;
+                        }
+                        const auto key = std::string{packPrefix} +
+                            chars[length - 1];
+                        auto value = chars.substr(length);
+                        if (value.empty() && i + 1 == args.size()) {
+                            errors.emplace_back(
+                                arg::err::RequiredOptionValueNotGiven{key});
+                            continue;
+                        }
+                        if (value.empty()) {
+                            value = args[++i];
+                        }
+                        if (read(last, value, options)) {
+                            given[last] = true;
+                        } else {
+                            invalid(key, value);
+                        }
+                        continue;
+                    }
+                }
+            }
+
+            if (position == argumentCount) {
+                errors.emplace_back(
+                    arg::err::UnexpectedArgument{std::string{token}});
+                continue;
+            }
+            if (readArgument(position, token, options)) {
+                argumentGiven[position] = true;
+            } else {
+                invalid(metavars[position], token);
+            }
+            if (!multiArgument[position]) {
+                position++;
+            }
+        }
+
+        if (help.empty()) {
+            for (size_t id = 0; id < optionCount; id++) {
+                if (required[id] && !given[id]) {
+                    errors.emplace_back(arg::err::RequiredOptionNotSet{
+                        std::string{keyStrings[id]}});
+                }
+            }
+            for (size_t k = 0; k < argumentCount; k++) {
+                if (argumentRequired[k] && !argumentGiven[k]) {
+                    errors.emplace_back(arg::err::RequiredOptionNotSet{
+                        std::string{metavars[k]}});
+                }
+            }
+        }
+        return errors;
+    }
+
+    // Parses like arg::Parser::parse: on errors, prints them and the help
+    // and exits with EXIT_FAILURE; on a help key, prints the help and exits
+    // with EXIT_SUCCESS
+    static @struct@ parse(std::span<const std::string_view> args)
+    {
+        auto options = @struct@{};
+        auto help = std::string_view{};
+        auto errors = tryParse(args, options, help);
+        if (!errors.empty()) {
+            for (const auto& error : errors) {
+                arg::err::print(std::cerr, error);
+            }
+            std::cerr << @parser@::help;
+            std::exit(EXIT_FAILURE);
+        }
+        if (!help.empty()) {
+            std::cout << help;
+            std::exit(EXIT_SUCCESS);
+        }
+        return options;
+    }
+
+    static @struct@ parse(int argc, char** argv)
+    {
+        std::vector<std::string_view> args;
+        for (int i = 1; i < argc; i++) {
+            args.emplace_back(argv[i]);
+        }
+        return parse(args);
+    }
+
+private:
+    static constexpr size_t optionCount = @optionCount@;
+    static constexpr size_t argumentCount = @argumentCount@;
+    static constexpr uint32_t keyCount = @keyCount@;
+    static constexpr int helpId = @helpId@;
+
+    static constexpr std::string_view packPrefix = @packPrefix@;
+    static constexpr std::string_view keyValueSeparator = @separator@;
+    static constexpr std::string_view endOfOptions = @endOfOptions@;
+
+    // Keys in the slots of the perfect hash, and the option of each
+    static constexpr std::array<std::string_view, keyCount> keys = {
+@keys@    };
+    static constexpr std::array<int, keyCount> owners = {
+@owners@    };
+    static constexpr std::array<int32_t, keyCount> displacements = {
+@displacements@    };
+
+    static constexpr std::array<bool, optionCount> hasValue = {
+@hasValue@    };
+    static constexpr std::array<bool, optionCount> required = {
+@required@    };
+    static constexpr std::array<std::string_view, optionCount> keyStrings = {
+@keyStrings@    };
+
+    static constexpr std::array<std::string_view, argumentCount> metavars = {
+@metavars@    };
+    static constexpr std::array<bool, argumentCount> multiArgument = {
+@multiArgument@    };
+    static constexpr std::array<bool, argumentCount> argumentRequired = {
+@argumentRequired@    };
+
+    static constexpr std::string_view sections = @sections@;
+
+    static constexpr uint32_t hash(std::string_view key, uint32_t seed)
+    {
+        auto h = uint32_t{2166136261} ^ seed;
+        for (char c : key) {
+            h = (h ^ static_cast<unsigned char>(c)) * 16777619;
+        }
+        h ^= h >> 16;
+        h *= 0x7feb352d;
+        h ^= h >> 15;
+        return h;
+    }
+
+    // Id of the option that key belongs to, helpId, or -1
+    static constexpr int find([[maybe_unused]] std::string_view key)
+    {
+@find@    }
+
+    // Id of the option that the pack prefix and c make a key of, or -1
+    static constexpr int packed(char c)
+    {
+        switch (c) {
+@packed@            default: return -1;
+        }
+    }
+
+    // Usage and one section of the help, or nothing for an unknown section
+    static constexpr std::string_view section(
+        [[maybe_unused]] std::string_view name)
+    {
+@section@        return {};
+    }
+
+    static void raise(
+        [[maybe_unused]] int id, [[maybe_unused]] @struct@& options)
+    {
+@raise@    }
+
+    static bool read(
+        [[maybe_unused]] int id,
+        [[maybe_unused]] std::string_view value,
+        [[maybe_unused]] @struct@& options)
+    {
+@read@        return false;
+    }
+
+    static bool readArgument(
+        [[maybe_unused]] size_t position,
+        [[maybe_unused]] std::string_view value,
+        [[maybe_unused]] @struct@& options)
+    {
+@readArgument@        return false;
+    }
+
+    template <class T>
+    static bool add(std::string_view value, std::vector<T>& values)
+    {
+        auto item = T{};
+        if (!arg::read(value, item)) {
+            return false;
+        }
+        values.push_back(std::move(item));
+        return true;
+    }
+};
+)";
+
+std::string generate(const Schema& schema, std::string_view source)
+{
+    const auto help = renderHelp(schema);
+    const auto helpId = static_cast<int>(schema.options.size());
+
+    // Keys in the order they first appear, each with the option it ends up
+    // with: as in arg::Parser, later options and then help keys win
+    auto keys = std::vector<std::string>{};
+    auto owners = std::vector<int>{};
+    auto define = [&] (const std::string& key, int owner) {
+        auto it = std::find(keys.begin(), keys.end(), key);
+        if (it == keys.end()) {
+            keys.push_back(key);
+            owners.push_back(owner);
+        } else {
+            owners[static_cast<size_t>(it - keys.begin())] = owner;
+        }
+    };
+    auto pack = std::vector<std::pair<char, int>>{};
+    for (size_t id = 0; id < schema.options.size(); id++) {
+        for (const auto& key : schema.options[id].keys) {
+            define(key, static_cast<int>(id));
+            if (!schema.packPrefix.empty() &&
+                    key.size() == schema.packPrefix.size() + 1 &&
+                    key.starts_with(schema.packPrefix)) {
+                auto it = std::find_if(pack.begin(), pack.end(),
+                    [&] (const auto& entry) {
+                        return entry.first == key.back();
+                    });
+                if (it == pack.end()) {
+                    pack.emplace_back(key.back(), static_cast<int>(id));
+                } else {
+                    it->second = static_cast<int>(id);
+                }
+            }
+        }
+    }
+    for (const auto& key : schema.helpKeys) {
+        define(key, helpId);
+    }
+
+    auto displacements = std::vector<int32_t>{};
+    auto slots = std::vector<uint32_t>{};
+    if (!perfectHash(keys, displacements, slots)) {
+        return {};
+    }
+    auto slotKeys = std::vector<std::string>(keys.size());
+    auto slotOwners = std::vector<int>(keys.size());
+    for (size_t k = 0; k < keys.size(); k++) {
+        slotKeys[slots[k]] = keys[k];
+        slotOwners[slots[k]] = owners[k];
+    }
+
+    auto lit = [] (std::string_view text) { return literal(text, ""); };
+    auto boolean = [] (bool value) {
+        return std::string{value ? "true" : "false"};
+    };
+
+    auto find = std::string{};
+    if (keys.empty()) {
+        find = "        return -1;\n";
+    } else {
+        find =
+            "        const auto d = displacements[hash(key, 0) % keyCount];\n"
+            "        const auto slot = d < 0 ?\n"
+            "            static_cast<uint32_t>(-d - 1) :\n"
+            "            hash(key, static_cast<uint32_t>(d)) % keyCount;\n"
+            "        return keys[slot] == key ? owners[slot] : -1;\n";
+    }
+
+    auto packed = std::string{};
+    for (const auto& [c, id] : pack) {
+        packed += "            case " + characterLiteral(c) + ": return " +
+            std::to_string(id) + ";\n";
+    }
+
+    auto section = std::string{};
+    auto sectionNames = std::string{};
+    for (const auto& [name, text] : help.sections) {
+        section += "        if (name == " + lit(name) + ") {\n" +
+            "            return " + literal(text, "                ") +
+            ";\n        }\n";
+        if (!sectionNames.empty()) {
+            sectionNames += ", ";
+        }
+        sectionNames += name;
+    }
+
+    auto raise = std::string{};
+    auto read = std::string{};
+    for (size_t id = 0; id < schema.options.size(); id++) {
+        const auto& field = schema.options[id];
+        const auto label = "            case " + std::to_string(id) + ":";
+        if (field.flag()) {
+            raise += label + " options." + field.name + " = true; break;\n";
+        } else if (field.count()) {
+            raise += label + " ++options." + field.name + "; break;\n";
+        } else if (field.multi) {
+            read += label + " return add(value, options." + field.name +
+                ");\n";
+        } else {
+            read += label + " return arg::read(value, options." +
+                field.name + ");\n";
+        }
+    }
+    auto readArgument = std::string{};
+    for (size_t k = 0; k < schema.arguments.size(); k++) {
+        const auto& field = schema.arguments[k];
+        readArgument += "            case " + std::to_string(k) + ": return " +
+            (field.multi ? "add(value, options." + field.name + ")" :
+                "arg::read(value, options." + field.name + ")") + ";\n";
+    }
+    auto wrapSwitch = [] (std::string_view on, std::string cases) {
+        return cases.empty() ? std::string{} :
+            "        switch (" + std::string{on} + ") {\n" + cases +
+            "        }\n";
+    };
+
+    auto values = std::unordered_map<std::string_view, std::string>{
+        {"parser", schema.structName + "Parser"},
+        {"struct", schema.structName},
+        {"program", lit(schema.program)},
+        {"help", literal(help.full, "        ")},
+        {"optionCount", std::to_string(schema.options.size())},
+        {"argumentCount", std::to_string(schema.arguments.size())},
+        {"keyCount", std::to_string(keys.size())},
+        {"helpId", std::to_string(helpId)},
+        {"packPrefix", lit(schema.packPrefix)},
+        {"separator", lit(schema.keyValueSeparator)},
+        {"endOfOptions", lit(schema.endOfOptions)},
+        {"keys", table(slotKeys, lit)},
+        {"owners", table(slotOwners, [] (int id) {
+            return std::to_string(id);
+        })},
+        {"displacements", table(displacements, [] (int32_t d) {
+            return std::to_string(d);
+        })},
+        {"hasValue", table(schema.options, [&] (const Field& field) {
+            return boolean(field.hasValue());
+        })},
+        {"required", table(schema.options, [&] (const Field& field) {
+            return boolean(field.required);
+        })},
+        {"keyStrings", table(schema.options, [&] (const Field& field) {
+            return lit(field.keyString());
+        })},
+        {"metavars", table(schema.arguments, [&] (const Field& field) {
+            return lit(field.metavar);
+        })},
+        {"multiArgument", table(schema.arguments, [&] (const Field& field) {
+            return boolean(field.multi);
+        })},
+        {"argumentRequired", table(schema.arguments, [&] (const Field& field) {
+            return boolean(field.required);
+        })},
+        {"sections", lit(sectionNames)},
+        {"find", find},
+        {"packed", packed},
+        {"section", section},
+        {"raise", wrapSwitch("id", raise)},
+        {"read", wrapSwitch("id", read)},
+        {"readArgument", wrapSwitch("position", readArgument)},
+    };
+
+    auto output = std::string{};
+    output += "// Generated by arg_generate from " + std::string{source} +
+        ". Do not edit.\n\n";
+    output += "#pragma once\n\n";
+    output += "#include <arg/converters.hpp>\n#include <arg/errors.hpp>\n\n";
+    for (const auto& header : {"<array>", "<cstddef>", "<cstdint>",
+            "<cstdlib>", "<iostream>", "<optional>", "<span>", "<string>",
+            "<string_view>", "<utility>", "<vector>"}) {
+        output += "#include " + std::string{header} + "\n";
+    }
+    for (const auto& header : schema.includes) {
+        output += "#include " + header + "\n";
+    }
+    output += "\n";
+    if (!schema.nameSpace.empty()) {
+        output += "namespace " + schema.nameSpace + " {\n\n";
+    }
+
+    output += "struct " + schema.structName + " {\n";
+    for (const auto* fields : {&schema.options, &schema.arguments}) {
+        for (const auto& field : *fields) {
+            output += "    " + field.cppType() + " " + field.name;
+            if (!field.defaultValue.empty()) {
+                output += "{" + field.defaultValue + "}";
+            } else if (field.flag()) {
+                output += " = false";
+            } else if (field.count()) {
+                output += " = 0";
+            } else {
+                output += "{}";
+            }
+            output += ";\n";
+        }
+    }
+    output += "};\n";
+    output += fill(parserTemplate, values);
+    if (!schema.nameSpace.empty()) {
+        output += "\n} // namespace " + schema.nameSpace + "\n";
+    }
+    return output;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        std::cerr << "usage: arg_generate SCHEMA OUTPUT\n";
+        return 2;
+    }
+    const auto schemaPath = std::string{argv[1]};
+    auto fail = [&] (std::string_view message) {
+        std::cerr << "arg_generate: " << schemaPath << ": " << message << "\n";
+        return 1;
+    };
+
+    auto input = std::ifstream{schemaPath, std::ios::binary};
+    if (!input) {
+        return fail("cannot read the schema");
+    }
+    const auto text = std::string{
+        std::istreambuf_iterator<char>{input},
+        std::istreambuf_iterator<char>{}};
+
+    auto json = Json{};
+    auto jsonReader = JsonReader{text};
+    if (!jsonReader.read(json)) {
+        return fail(jsonReader.error());
+    }
+    auto schema = Schema{};
+    auto schemaReader = SchemaReader{};
+    if (!schemaReader.read(json, schema)) {
+        return fail(schemaReader.error());
+    }
+
+    const auto output = generate(schema, std::filesystem::path{schemaPath}
+        .filename().string());
+    if (output.empty()) {
+        return fail("no perfect hash found for the keys");
+    }
+
+    auto file = std::ofstream{argv[2], std::ios::binary};
+    if (!(file << output) || !file.flush()) {
+        return fail(std::string{"cannot write "} + argv[2]);
+    }
+    return 0;
+}